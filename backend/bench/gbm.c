@@ -0,0 +1,89 @@
+#include "gbm.h"
+
+#include <math.h>
+
+#define TRADING_DAYS 252.0
+#define TWO_PI 6.283185307179586
+
+#define GBM_S0 100.0
+#define GBM_MU 0.07
+#define GBM_SIGMA 0.25
+
+// 2024-12-31 as days since 1970-01-01
+#define GBM_LAST_DAY 20088
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in (0, 1)
+static double uniform(struct gbm *g)
+{
+    return ((double)(splitmix64(&g->state) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+static double normal(struct gbm *g)
+{
+    if (g->has_spare) {
+        g->has_spare = 0;
+        return g->spare;
+    }
+
+    double u = uniform(g);
+    double v = uniform(g);
+    double r = sqrt(-2.0 * log(u));
+
+    g->spare = r * sin(TWO_PI * v);
+    g->has_spare = 1;
+    return r * cos(TWO_PI * v);
+}
+
+void gbm_init(struct gbm *g, uint64_t seed, double s0, double mu, double sigma)
+{
+    double dt = 1.0 / TRADING_DAYS;
+
+    g->state = seed;
+    g->price = s0;
+    g->drift = (mu - 0.5 * sigma * sigma) * dt;
+    g->vol = sigma * sqrt(dt);
+    g->spare = 0.0;
+    g->has_spare = 0;
+}
+
+double gbm_next(struct gbm *g)
+{
+    g->price *= exp(g->drift + g->vol * normal(g));
+    return g->price;
+}
+
+uint64_t gbm_rand(struct gbm *g)
+{
+    return splitmix64(&g->state);
+}
+
+void gbm_fill(double *prices, size_t count, uint64_t seed)
+{
+    struct gbm g;
+    gbm_init(&g, seed, GBM_S0, GBM_MU, GBM_SIGMA);
+
+    for (size_t i = 0; i < count; i++)
+        prices[i] = i == 0 ? g.price : gbm_next(&g);
+}
+
+struct market_series *gbm_series(const char *symbol, size_t count,
+                                 uint64_t seed)
+{
+    struct market_series *s = market_series_create(symbol, count);
+    if (!s)
+        return NULL;
+
+    gbm_fill(s->prices, count, seed);
+    for (size_t i = 0; i < count; i++)
+        s->dates[i] = GBM_LAST_DAY - (int32_t)(count - 1 - i);
+
+    return s;
+}
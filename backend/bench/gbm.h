@@ -0,0 +1,52 @@
+#ifndef STOCKC_BENCH_GBM_H
+#define STOCKC_BENCH_GBM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stockc/market_series.h"
+
+/*
+ * Deterministic synthetic prices: geometric Brownian motion driven by
+ * a seeded splitmix64 generator, so every run (and every machine)
+ * benchmarks the same series.
+ *
+ *   S[t+1] = S[t] * exp((mu - sigma^2 / 2) dt + sigma sqrt(dt) Z)
+ *
+ * with mu and sigma annualized and dt one trading day.
+ */
+
+struct gbm {
+    uint64_t state;
+    double price;
+    double drift;       // (mu - sigma^2 / 2) dt
+    double vol;         // sigma sqrt(dt)
+    double spare;       // second Box-Muller normal
+    int has_spare;
+};
+
+void gbm_init(struct gbm *g, uint64_t seed, double s0, double mu, double sigma);
+
+/*
+ * Advance one day and return the new price.
+ */
+double gbm_next(struct gbm *g);
+
+/*
+ * Uniform 64-bit value from the same generator (for picking keys).
+ */
+uint64_t gbm_rand(struct gbm *g);
+
+/*
+ * Fill prices[0..count) starting from s0 (prices[0] == s0).
+ */
+void gbm_fill(double *prices, size_t count, uint64_t seed);
+
+/*
+ * Series of `count` consecutive days ending 2024-12-31, with
+ * gbm_fill prices. Returns a new reference, or NULL on failure.
+ */
+struct market_series *gbm_series(const char *symbol, size_t count,
+                                 uint64_t seed);
+
+#endif
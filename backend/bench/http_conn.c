@@ -0,0 +1,319 @@
+#include "http_conn.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+// ------------------------------------------------------------
+// Socket helpers
+// ------------------------------------------------------------
+
+static int open_socket(const char *host, int port)
+{
+    char port_str[16];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, port_str, &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static int write_all(int fd, const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w <= 0)
+            return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/*
+ * Read more bytes into the buffer, compacting consumed data first.
+ * Returns bytes read, 0 on EOF, -1 on error.
+ */
+static ssize_t fill(struct http_conn *c)
+{
+    if (c->off > 0) {
+        memmove(c->buf, c->buf + c->off, c->len - c->off);
+        c->len -= c->off;
+        c->off = 0;
+    }
+
+    if (c->len == sizeof(c->buf))
+        return -1;      // header line longer than the buffer
+
+    ssize_t r = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+    if (r > 0)
+        c->len += (size_t)r;
+    return r;
+}
+
+/*
+ * Find the end of the next CRLF-terminated line starting at c->off,
+ * reading as needed. Returns the line length (without CRLF), -1 on
+ * EOF/error.
+ */
+static long next_line(struct http_conn *c)
+{
+    for (;;) {
+        char *start = c->buf + c->off;
+        char *nl = memchr(start, '\n', c->len - c->off);
+        if (nl) {
+            long n = (long)(nl - start);
+            if (n > 0 && start[n - 1] == '\r')
+                n--;
+            return n;
+        }
+        if (fill(c) <= 0)
+            return -1;
+    }
+}
+
+static void consume_line(struct http_conn *c)
+{
+    char *nl = memchr(c->buf + c->off, '\n', c->len - c->off);
+    c->off = (size_t)(nl - c->buf) + 1;
+}
+
+/*
+ * Discard exactly n body bytes.
+ */
+static int skip_bytes(struct http_conn *c, size_t n)
+{
+    while (n > 0) {
+        if (c->off == c->len && fill(c) <= 0)
+            return -1;
+
+        size_t avail = c->len - c->off;
+        size_t take = avail < n ? avail : n;
+        c->off += take;
+        n -= take;
+    }
+    return 0;
+}
+
+static int header_is(const char *line, long len, const char *name)
+{
+    size_t n = strlen(name);
+    return (size_t)len > n && strncasecmp(line, name, n) == 0
+        && line[n] == ':';
+}
+
+static const char *header_value(const char *line, const char *name)
+{
+    const char *v = line + strlen(name) + 1;
+    while (*v == ' ' || *v == '\t')
+        v++;
+    return v;
+}
+
+
+// ------------------------------------------------------------
+// Response parsing
+// ------------------------------------------------------------
+
+static int read_chunked(struct http_conn *c, size_t *body_bytes)
+{
+    for (;;) {
+        if (next_line(c) < 0)
+            return -1;
+
+        size_t size = strtoul(c->buf + c->off, NULL, 16);
+        consume_line(c);
+
+        if (size == 0)
+            break;
+
+        if (skip_bytes(c, size) != 0 || next_line(c) < 0)
+            return -1;
+        consume_line(c);    // CRLF after the chunk
+
+        *body_bytes += size;
+    }
+
+    // Trailers up to the blank line
+    for (;;) {
+        long n = next_line(c);
+        if (n < 0)
+            return -1;
+        consume_line(c);
+        if (n == 0)
+            return 0;
+    }
+}
+
+static int read_response(struct http_conn *c, int *status, size_t *body_bytes)
+{
+    long n = next_line(c);
+    if (n < 0)
+        return -1;
+
+    if (n < 12 || strncmp(c->buf + c->off, "HTTP/1.", 7) != 0)
+        return -1;
+
+    *status = atoi(c->buf + c->off + 9);
+    *body_bytes = 0;
+    consume_line(c);
+
+    long content_length = -1;
+    int chunked = 0;
+    int close_after = 0;
+
+    for (;;) {
+        n = next_line(c);
+        if (n < 0)
+            return -1;
+        if (n == 0) {
+            consume_line(c);
+            break;
+        }
+
+        char *line = c->buf + c->off;
+        char saved = line[n];
+        line[n] = '\0';
+
+        if (header_is(line, n, "Content-Length"))
+            content_length = atol(header_value(line, "Content-Length"));
+        else if (header_is(line, n, "Transfer-Encoding"))
+            chunked = strstr(header_value(line, "Transfer-Encoding"), "chunked") != NULL;
+        else if (header_is(line, n, "Connection"))
+            close_after = strncasecmp(header_value(line, "Connection"), "close", 5) == 0;
+
+        line[n] = saved;
+        consume_line(c);
+    }
+
+    int rc = 0;
+
+    if (*status == 204 || *status == 304 || *status / 100 == 1) {
+        // no body
+    } else if (chunked) {
+        rc = read_chunked(c, body_bytes);
+    } else if (content_length >= 0) {
+        rc = skip_bytes(c, (size_t)content_length);
+        *body_bytes = (size_t)content_length;
+    } else {
+        // Body runs to EOF
+        *body_bytes = c->len - c->off;
+        c->off = c->len;
+        ssize_t r;
+        while ((r = fill(c)) > 0) {
+            *body_bytes += c->len - c->off;
+            c->off = c->len;
+        }
+        close_after = 1;
+        rc = r < 0 ? -1 : 0;
+    }
+
+    if (rc != 0 || close_after)
+        http_conn_close(c);
+
+    return rc;
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+void http_conn_init(struct http_conn *c, const char *host, int port)
+{
+    memset(c, 0, sizeof(*c));
+    c->host = host;
+    c->port = port;
+    c->fd = -1;
+}
+
+void http_conn_close(struct http_conn *c)
+{
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+    c->off = 0;
+}
+
+int http_conn_get(struct http_conn *c, const char *path,
+                  int *status, size_t *body_bytes)
+{
+    char req[1024];
+    int req_len = snprintf(req, sizeof(req),
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s:%d\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n",
+        path, c->host, c->port);
+
+    if (req_len < 0 || (size_t)req_len >= sizeof(req))
+        return -1;
+
+    // A reused connection may have been closed by the server while
+    // idle; that shows up as a failed write or an immediate EOF, and
+    // is retried once on a fresh connection.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int reused = c->fd >= 0;
+
+        if (!reused) {
+            c->fd = open_socket(c->host, c->port);
+            if (c->fd < 0)
+                return -1;
+            c->connects++;
+        }
+
+        if (write_all(c->fd, req, (size_t)req_len) != 0) {
+            http_conn_close(c);
+            if (reused)
+                continue;
+            return -1;
+        }
+
+        if (c->off == c->len) {
+            ssize_t r = fill(c);
+            if (r <= 0) {
+                http_conn_close(c);
+                if (reused)
+                    continue;
+                return -1;
+            }
+        }
+
+        return read_response(c, status, body_bytes);
+    }
+
+    return -1;
+}
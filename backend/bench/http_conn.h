@@ -0,0 +1,37 @@
+#ifndef STOCKC_BENCH_HTTP_CONN_H
+#define STOCKC_BENCH_HTTP_CONN_H
+
+#include <stddef.h>
+
+/*
+ * Minimal blocking HTTP/1.1 keep-alive client for the bench tools.
+ *
+ * One connection, one request at a time. Understands Content-Length,
+ * chunked and read-until-close bodies; body bytes are counted and
+ * discarded. When the server closes the connection (CivetWeb does
+ * unless enable_keep_alive is on) the next request reconnects.
+ */
+
+struct http_conn {
+    const char *host;
+    int port;
+    int fd;                     // -1 when not connected
+    char buf[16384];
+    size_t len;                 // bytes in buf
+    size_t off;                 // consumed prefix of buf
+    unsigned long connects;     // successful connects, including the first
+};
+
+void http_conn_init(struct http_conn *c, const char *host, int port);
+
+void http_conn_close(struct http_conn *c);
+
+/*
+ * GET `path` and read the whole response.
+ * Returns 0 on success with *status and *body_bytes filled,
+ * -1 on connection or protocol failure.
+ */
+int http_conn_get(struct http_conn *c, const char *path,
+                  int *status, size_t *body_bytes);
+
+#endif
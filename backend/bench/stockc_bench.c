@@ -0,0 +1,449 @@
+/*
+ * stockc_bench: microbenchmarks for the hot paths.
+ *
+ *   stockc_bench [filter] [min-seconds]
+ *
+ * Runs every benchmark whose name contains `filter`; each is repeated
+ * with growing iteration counts until one run takes at least
+ * min-seconds (default 0.5). Inputs come from the seeded GBM generator,
+ * so numbers are comparable across runs and machines.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civetweb.h"
+#include "stockc/market_history_columnar.h"
+#include "stockc/market_history_json.h"
+#include "stockc/market_metrics.h"
+#include "../src/cache/history_cache.h"
+#include "../src/http/responses.h"
+#include "../src/memory/arena.h"
+
+#include "gbm.h"
+#include "http_conn.h"
+
+#define CACHE_SYMBOLS 256
+#define CACHE_SERIES_POINTS 252
+#define CACHE_SET_EVERY 16      // one set per 16 ops, the rest gets
+
+typedef void (*bench_fn)(void *ctx, size_t iters);
+
+static const char *filter = NULL;
+static double min_seconds = 0.5;
+static volatile double sink;
+
+
+// ------------------------------------------------------------
+// Harness
+// ------------------------------------------------------------
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, bench_fn fn, void *ctx)
+{
+    if (filter && !strstr(name, filter))
+        return;
+
+    size_t iters = 1;
+    double elapsed;
+
+    for (;;) {
+        double start = now_seconds();
+        fn(ctx, iters);
+        elapsed = now_seconds() - start;
+
+        if (elapsed >= min_seconds)
+            break;
+
+        double scale = elapsed > 0.0 ? 1.2 * min_seconds / elapsed : 100.0;
+        if (scale < 2.0)
+            scale = 2.0;
+        if (scale > 100.0)
+            scale = 100.0;
+        iters = (size_t)((double)iters * scale);
+    }
+
+    printf("%-36s %12zu iters %14.1f ns/op %14.0f ops/s\n",
+           name, iters, elapsed * 1e9 / (double)iters,
+           (double)iters / elapsed);
+    fflush(stdout);
+}
+
+
+// ------------------------------------------------------------
+// market_calculate_metrics
+// ------------------------------------------------------------
+
+struct metrics_ctx {
+    double *prices;
+    size_t count;
+};
+
+static void bench_metrics(void *arg, size_t iters)
+{
+    struct metrics_ctx *ctx = arg;
+    struct market_metrics m;
+
+    for (size_t i = 0; i < iters; i++) {
+        market_calculate_metrics(ctx->prices, ctx->count, &m);
+        sink += m.sharpe;
+    }
+}
+
+static void run_metrics(void)
+{
+    static const size_t sizes[] = { 100, 1000, 10000, 100000, 1000000 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        struct metrics_ctx ctx;
+        ctx.count = sizes[i];
+        ctx.prices = malloc(ctx.count * sizeof(double));
+        if (!ctx.prices)
+            continue;
+
+        gbm_fill(ctx.prices, ctx.count, 42);
+
+        char name[64];
+        snprintf(name, sizeof(name), "metrics/%zu", ctx.count);
+        run(name, bench_metrics, &ctx);
+
+        free(ctx.prices);
+    }
+}
+
+
+// ------------------------------------------------------------
+// market_build_history_with_metrics
+// ------------------------------------------------------------
+
+static void bench_history_json(void *arg, size_t iters)
+{
+    const struct market_series *series = arg;
+
+    for (size_t i = 0; i < iters; i++) {
+        char *json = market_build_history_with_metrics(series, 0);
+        sink += json ? (double)json[0] : 0.0;
+        arena_reset();      // as the server does after each request
+    }
+}
+
+// Stand-in for the socket: chunks are dropped as they leave
+static int discard_chunk(struct json_sink *out, int last)
+{
+    (void)last;
+    sink += (double)out->len;
+    return 0;
+}
+
+static void bench_history_stream(void *arg, size_t iters)
+{
+    const struct market_series *series = arg;
+    static char buf[CHUNKED_RESPONSE_BYTES];
+
+    for (size_t i = 0; i < iters; i++) {
+        struct json_sink out;
+        json_sink_init_stream(&out, buf, sizeof(buf), discard_chunk, NULL);
+        market_write_history(&out, series, 0, NULL, 0, NULL, 0);
+        json_sink_finish(&out);
+    }
+}
+
+static void bench_history_columnar(void *arg, size_t iters)
+{
+    const struct market_series *series = arg;
+
+    for (size_t i = 0; i < iters; i++) {
+        size_t len = 0;
+        void *bin = market_build_history_columnar(series, 0, NULL, 0, 0,
+                                                  1, 0, &len);
+        sink += bin ? (double)len : 0.0;
+        arena_reset();
+    }
+}
+
+static void run_history_json(void)
+{
+    static const size_t sizes[] = { 5, 100, 5000 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        struct market_series *series = gbm_series("BENCH", sizes[i], 7);
+        if (!series)
+            continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "history_json/%zu", sizes[i]);
+        run(name, bench_history_json, series);
+
+        // Cached series carry the metrics index
+        market_series_build_index(series);
+        snprintf(name, sizeof(name), "history_json_indexed/%zu", sizes[i]);
+        run(name, bench_history_json, series);
+
+        snprintf(name, sizeof(name), "history_stream/%zu", sizes[i]);
+        run(name, bench_history_stream, series);
+
+        snprintf(name, sizeof(name), "history_columnar/%zu", sizes[i]);
+        run(name, bench_history_columnar, series);
+
+        market_series_release(series);
+    }
+}
+
+
+// ------------------------------------------------------------
+// history_cache under contention
+// ------------------------------------------------------------
+
+struct cache_ctx {
+    int threads;
+    char symbols[CACHE_SYMBOLS][16];
+    struct market_series *series[CACHE_SYMBOLS];
+};
+
+struct cache_worker {
+    struct cache_ctx *ctx;
+    size_t ops;
+    uint64_t seed;
+    pthread_t thread;
+};
+
+static void *cache_worker_main(void *arg)
+{
+    struct cache_worker *w = arg;
+    struct cache_ctx *ctx = w->ctx;
+
+    struct gbm rng;
+    gbm_init(&rng, w->seed, 1.0, 0.0, 0.0);
+
+    for (size_t i = 0; i < w->ops; i++) {
+        size_t k = (size_t)(gbm_rand(&rng) % CACHE_SYMBOLS);
+
+        if (i % CACHE_SET_EVERY == 0) {
+            history_cache_set(ctx->symbols[k], ctx->series[k]);
+            continue;
+        }
+
+        int expired = 0;
+        struct market_series *s =
+            history_cache_get_stale(ctx->symbols[k], NULL, &expired);
+        market_series_release(s);
+    }
+
+    return NULL;
+}
+
+static void bench_cache(void *arg, size_t iters)
+{
+    struct cache_ctx *ctx = arg;
+    struct cache_worker workers[64];
+    int n = ctx->threads;
+
+    for (int t = 0; t < n; t++) {
+        workers[t].ctx = ctx;
+        workers[t].ops = iters / (size_t)n + (t == 0 ? iters % (size_t)n : 0);
+        workers[t].seed = 1000 + (uint64_t)t;
+        pthread_create(&workers[t].thread, NULL, cache_worker_main, &workers[t]);
+    }
+
+    for (int t = 0; t < n; t++)
+        pthread_join(workers[t].thread, NULL);
+}
+
+static void run_cache(void)
+{
+    static const int thread_counts[] = { 1, 2, 4, 8 };
+
+    struct cache_ctx *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return;
+
+    history_cache_init();
+
+    for (size_t k = 0; k < CACHE_SYMBOLS; k++) {
+        snprintf(ctx->symbols[k], sizeof(ctx->symbols[k]), "SYM%03zu", k);
+        ctx->series[k] = gbm_series(ctx->symbols[k], CACHE_SERIES_POINTS, k);
+        if (!ctx->series[k])
+            goto out;
+
+        // Index up front, so workers never build it on a shared series
+        market_series_build_index(ctx->series[k]);
+        history_cache_set(ctx->symbols[k], ctx->series[k]);
+    }
+
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        ctx->threads = thread_counts[i];
+
+        char name[64];
+        snprintf(name, sizeof(name), "history_cache/threads=%d", ctx->threads);
+        run(name, bench_cache, ctx);
+    }
+
+out:
+    for (size_t k = 0; k < CACHE_SYMBOLS; k++)
+        market_series_release(ctx->series[k]);
+    free(ctx);
+}
+
+
+// ------------------------------------------------------------
+// send_json_response (loopback round trip)
+// ------------------------------------------------------------
+
+struct response_body {
+    char *json;
+};
+
+static int response_handler(struct mg_connection *conn, void *cbdata)
+{
+    const struct response_body *body = cbdata;
+    send_json_response(conn, 200, body->json);
+    return 1;
+}
+
+/*
+ * JSON array of n {"date","price"} points, shaped like a history body.
+ */
+static char *make_body(size_t target_bytes)
+{
+    char *out = malloc(target_bytes + 64);
+    if (!out)
+        return NULL;
+
+    struct gbm g;
+    gbm_init(&g, 3, 100.0, 0.07, 0.25);
+
+    size_t len = 0;
+    out[len++] = '[';
+
+    while (len + 48 < target_bytes) {
+        len += (size_t)sprintf(out + len, "%s{\"date\":\"2024-01-01\",\"price\":%.2f}",
+                               len > 1 ? "," : "", gbm_next(&g));
+    }
+
+    out[len++] = ']';
+    out[len] = '\0';
+    return out;
+}
+
+struct response_ctx {
+    struct http_conn conn;
+    const char *path;
+};
+
+static void bench_response(void *arg, size_t iters)
+{
+    struct response_ctx *ctx = arg;
+
+    for (size_t i = 0; i < iters; i++) {
+        int status = 0;
+        size_t bytes = 0;
+        if (http_conn_get(&ctx->conn, ctx->path, &status, &bytes) != 0
+            || status != 200) {
+            fprintf(stderr, "request to %s failed\n", ctx->path);
+            return;
+        }
+        sink += (double)bytes;
+    }
+}
+
+static void run_response(void)
+{
+    static const size_t sizes[] = { 64, 4096, 131072 };
+    enum { SIZE_COUNT = sizeof(sizes) / sizeof(sizes[0]) };
+
+    // Only start a server if some size is selected
+    int wanted = 0;
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "send_json_response/%zu", sizes[i]);
+        if (!filter || strstr(name, filter))
+            wanted = 1;
+    }
+    if (!wanted)
+        return;
+
+    const char *options[] = {
+        "listening_ports", "127.0.0.1:0",
+        "num_threads", "2",
+        "enable_keep_alive", "yes",
+        // Matches a server sending each response in one write; with
+        // split writes, Nagle plus delayed ACK added ~40 ms per response
+        "tcp_nodelay", "1",
+        0
+    };
+
+    struct mg_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+
+    struct mg_context *server = mg_start(&callbacks, NULL, options);
+    if (!server) {
+        fprintf(stderr, "send_json_response: failed to start server\n");
+        return;
+    }
+
+    struct mg_server_port port;
+    if (mg_get_server_ports(server, 1, &port) < 1) {
+        fprintf(stderr, "send_json_response: no listening port\n");
+        mg_stop(server);
+        return;
+    }
+
+    struct response_body bodies[SIZE_COUNT];
+    char paths[SIZE_COUNT][32];
+
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        bodies[i].json = make_body(sizes[i]);
+        snprintf(paths[i], sizeof(paths[i]), "/bench/%zu", sizes[i]);
+        if (bodies[i].json)
+            mg_set_request_handler(server, paths[i], response_handler, &bodies[i]);
+    }
+
+    struct response_ctx ctx;
+
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        if (!bodies[i].json)
+            continue;
+
+        http_conn_init(&ctx.conn, "127.0.0.1", port.port);
+        ctx.path = paths[i];
+
+        char name[64];
+        snprintf(name, sizeof(name), "send_json_response/%zu", sizes[i]);
+        run(name, bench_response, &ctx);
+
+        http_conn_close(&ctx.conn);
+    }
+
+    mg_stop(server);
+
+    for (size_t i = 0; i < SIZE_COUNT; i++)
+        free(bodies[i].json);
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && argv[1][0] != '\0')
+        filter = argv[1];
+    if (argc > 2 && atof(argv[2]) > 0.0)
+        min_seconds = atof(argv[2]);
+
+    mg_init_library(0);
+
+    run_metrics();
+    run_history_json();
+    run_cache();
+    run_response();
+
+    mg_exit_library();
+    return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * stockc_check: regression checks for the metrics fast paths.
+ *
+ *   stockc_check
+ *
+ * Compares the metrics index, the multi-window pass and rolling
+ * statistics against market_calculate_metrics on seeded GBM series
+ * (one with a flat stretch), and checks the
+ * correlation matrix's diagonal and range. Prints each mismatch and
+ * exits non-zero if there was any. Run by ctest.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stockc/market_correlation.h"
+#include "stockc/market_metrics.h"
+#include "stockc/market_rolling.h"
+
+#include "gbm.h"
+
+#define SERIES_POINTS 5000
+#define SHORT_WINDOWS 2000      // random windows of 2-5 prices
+#define LONG_WINDOWS 200        // random windows of 64-5000 prices
+#define REL_TOLERANCE 1e-8
+#define CORRELATION_SERIES 40   // more than one tile of rows
+#define FLAT_START 2000         // flat stretch in the last series
+#define FLAT_POINTS 100
+
+static int failures = 0;
+
+static int close_enough(double got, double want, double rel)
+{
+    if (got == want)
+        return 1;
+
+    double scale = fabs(want) > 1.0 ? fabs(want) : 1.0;
+    return fabs(got - want) <= rel * scale;
+}
+
+static void compare(const char *what,
+                    size_t start,
+                    size_t count,
+                    const struct market_metrics *got,
+                    const struct market_metrics *want,
+                    double rel)
+{
+    if (close_enough(got->sharpe, want->sharpe, rel) &&
+        close_enough(got->sortino, want->sortino, rel) &&
+        close_enough(got->max_drawdown, want->max_drawdown, rel) &&
+        close_enough(got->cagr, want->cagr, rel))
+        return;
+
+    printf("%s [%zu, +%zu): sharpe %.17g vs %.17g, sortino %.17g vs %.17g, "
+           "drawdown %.17g vs %.17g, cagr %.17g vs %.17g\n",
+           what, start, count,
+           got->sharpe, want->sharpe, got->sortino, want->sortino,
+           got->max_drawdown, want->max_drawdown, got->cagr, want->cagr);
+    failures++;
+}
+
+static void check_index(const double *prices, struct gbm *rng)
+{
+    struct market_metrics_index *ix =
+        market_metrics_index_build(prices, SERIES_POINTS);
+    if (!ix) {
+        printf("index: build failed\n");
+        failures++;
+        return;
+    }
+
+    for (int i = 0; i < SHORT_WINDOWS + LONG_WINDOWS; i++) {
+        size_t count = i < SHORT_WINDOWS
+            ? 2 + (size_t)(gbm_rand(rng) % 4)
+            : 64 + (size_t)(gbm_rand(rng) % (SERIES_POINTS - 63));
+        size_t start = (size_t)(gbm_rand(rng) % (SERIES_POINTS - count + 1));
+
+        struct market_metrics got, want;
+        if (market_metrics_index_query(ix, start, count, &got) != 0 ||
+            market_calculate_metrics(prices + start, count, &want) != 0) {
+            printf("index [%zu, +%zu): query failed\n", start, count);
+            failures++;
+            continue;
+        }
+
+        // Short windows are computed directly and must match exactly
+        compare("index", start, count, &got, &want,
+                count <= 5 ? 0.0 : REL_TOLERANCE);
+    }
+
+    market_metrics_index_free(ix);
+}
+
+static void check_windows(const double *prices, struct gbm *rng)
+{
+    static const size_t windows[] = { 2, 3, 4, 5 };
+    const size_t n = sizeof(windows) / sizeof(windows[0]);
+
+    for (int i = 0; i < SHORT_WINDOWS / 4; i++) {
+        size_t end = 5 + (size_t)(gbm_rand(rng) % (SERIES_POINTS - 4));
+        struct market_metrics got[4];
+
+        if (market_calculate_metrics_windows(prices, end, windows, n,
+                                             got) != 0) {
+            printf("windows [0, %zu): failed\n", end);
+            failures++;
+            continue;
+        }
+
+        for (size_t w = 0; w < n; w++) {
+            struct market_metrics want;
+            market_calculate_metrics(prices + end - windows[w], windows[w],
+                                     &want);
+            compare("windows", end - windows[w], windows[w],
+                    &got[w], &want, REL_TOLERANCE);
+        }
+    }
+}
+
+static void check_rolling(const double *prices)
+{
+    static const size_t windows[] = { 2, 3, 4, 5, 8, 64, 65, 252, 1000 };
+    const size_t n = sizeof(windows) / sizeof(windows[0]);
+
+    double *sharpe = malloc(SERIES_POINTS * sizeof(*sharpe));
+    double *drawdown = malloc(SERIES_POINTS * sizeof(*drawdown));
+    if (!sharpe || !drawdown) {
+        free(sharpe);
+        free(drawdown);
+        failures++;
+        return;
+    }
+
+    for (size_t w = 0; w < n; w++) {
+        size_t window = windows[w];
+        long points = market_calculate_rolling(prices, SERIES_POINTS, window,
+                                               NULL, sharpe, drawdown);
+        if (points != (long)(SERIES_POINTS - window + 1)) {
+            printf("rolling window %zu: failed\n", window);
+            failures++;
+            continue;
+        }
+
+        for (size_t k = 0; k < (size_t)points; k++) {
+            struct market_metrics want;
+            market_calculate_metrics(prices + k, window, &want);
+
+            double peak = prices[k];
+            for (size_t t = k + 1; t < k + window; t++)
+                peak = prices[t] > peak ? prices[t] : peak;
+            double dd = (prices[k + window - 1] - peak) / peak;
+
+            // Short windows are computed directly and must match exactly
+            double rel = window <= 64 ? 0.0 : REL_TOLERANCE;
+            if (!close_enough(sharpe[k], want.sharpe, rel) ||
+                !close_enough(drawdown[k], dd, 0.0)) {
+                printf("rolling [%zu, +%zu): sharpe %.17g vs %.17g, "
+                       "drawdown %.17g vs %.17g\n",
+                       k, window, sharpe[k], want.sharpe, drawdown[k], dd);
+                failures++;
+            }
+        }
+    }
+
+    free(sharpe);
+    free(drawdown);
+}
+
+static void check_correlation(void)
+{
+    struct market_series *series[CORRELATION_SERIES];
+    double out[MARKET_PACKED_SIZE(CORRELATION_SERIES)];
+    const size_t n = CORRELATION_SERIES;
+
+    for (size_t i = 0; i < n; i++)
+        series[i] = gbm_series("CHK", 300, 100 + i);
+
+    size_t points = 0;
+    if (market_correlation_matrix((const struct market_series *const *)series,
+                                  n, 252, 1, out, &points) != 0 ||
+        points != 252) {
+        printf("correlation: failed (%zu points)\n", points);
+        failures++;
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = i; j < n; j++) {
+                double c = out[MARKET_PACKED_INDEX(n, i, j)];
+                if (i == j ? c != 1.0 : !(c >= -1.0 && c <= 1.0)) {
+                    printf("correlation (%zu, %zu): %.17g\n", i, j, c);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+        market_series_release(series[i]);
+}
+
+int main(void)
+{
+    double *prices = malloc(SERIES_POINTS * sizeof(*prices));
+    if (!prices)
+        return 1;
+
+    struct gbm rng;
+    gbm_init(&rng, 2024, 100.0, 0.0, 0.25);
+
+    for (uint64_t seed = 1; seed <= 4; seed++) {
+        gbm_fill(prices, SERIES_POINTS, seed);
+        check_index(prices, &rng);
+        check_windows(prices, &rng);
+        check_rolling(prices);
+    }
+
+    // Near-flat prices: zero variance that sliding sums must not miss
+    for (size_t i = FLAT_START + 1; i < FLAT_START + FLAT_POINTS; i++)
+        prices[i] = prices[FLAT_START];
+    check_rolling(prices);
+
+    free(prices);
+
+    check_correlation();
+
+    if (failures > 0) {
+        printf("%d mismatches\n", failures);
+        return 1;
+    }
+
+    printf("checks passed\n");
+    return 0;
+}
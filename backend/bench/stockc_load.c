@@ -0,0 +1,259 @@
+/*
+ * stockc_load: closed-loop load driver for a running stockc server.
+ *
+ *   stockc_load [-h host] [-p port] [-c connections] [-d seconds]
+ *               [-w warmup-seconds] [path ...]
+ *
+ * Each connection is a thread issuing keep-alive GETs back to back,
+ * cycling through the given paths (default /api/market/quote?symbol=AAPL).
+ * Requests completed during the warmup are not counted. Reports
+ * throughput and p50/p90/p99/p99.9 latency over the measured window.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "http_conn.h"
+
+#define DEFAULT_PATH "/api/market/quote?symbol=AAPL"
+#define MAX_CONNECTIONS 4096
+
+enum phase {
+    PHASE_WARMUP,
+    PHASE_MEASURE,
+    PHASE_STOP
+};
+
+static _Atomic int phase = PHASE_WARMUP;
+
+struct client {
+    pthread_t thread;
+    const char *host;
+    int port;
+    char **paths;
+    int path_count;
+    int first_path;
+
+    // Measured window only
+    uint64_t *latencies_ns;
+    size_t count;
+    size_t cap;
+    unsigned long long errors;
+    unsigned long long non_2xx;
+    unsigned long long bytes;
+    unsigned long connects;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int record(struct client *c, uint64_t ns)
+{
+    if (c->count == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 4096;
+        uint64_t *grown = realloc(c->latencies_ns, cap * sizeof(*grown));
+        if (!grown)
+            return -1;
+        c->latencies_ns = grown;
+        c->cap = cap;
+    }
+
+    c->latencies_ns[c->count++] = ns;
+    return 0;
+}
+
+static void *client_main(void *arg)
+{
+    struct client *c = arg;
+    struct http_conn conn;
+    http_conn_init(&conn, c->host, c->port);
+
+    int next = c->first_path;
+    unsigned long warm_connects = 0;
+
+    for (;;) {
+        int p = atomic_load_explicit(&phase, memory_order_relaxed);
+        if (p == PHASE_STOP)
+            break;
+
+        const char *path = c->paths[next];
+        next = (next + 1) % c->path_count;
+
+        int status = 0;
+        size_t body = 0;
+
+        uint64_t start = now_ns();
+        int rc = http_conn_get(&conn, path, &status, &body);
+        uint64_t elapsed = now_ns() - start;
+
+        if (p == PHASE_WARMUP) {
+            warm_connects = conn.connects;
+            if (rc != 0)
+                usleep(1000);
+            continue;
+        }
+
+        if (rc != 0) {
+            c->errors++;
+            usleep(1000);   // don't spin on a dead server
+            continue;
+        }
+
+        if (status < 200 || status >= 300)
+            c->non_2xx++;
+
+        c->bytes += body;
+        if (record(c, elapsed) != 0)
+            c->errors++;
+    }
+
+    c->connects = conn.connects - warm_connects;
+    http_conn_close(&conn);
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const uint64_t *sorted, size_t n, double q)
+{
+    if (n == 0)
+        return 0.0;
+
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return (double)sorted[i] / 1e6;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "usage: %s [-h host] [-p port] [-c connections] [-d seconds]\n"
+        "          [-w warmup-seconds] [path ...]\n",
+        argv0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *host = "127.0.0.1";
+    int port = 8080;
+    int connections = 64;
+    double duration = 10.0;
+    double warmup = 1.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:c:d:w:")) != -1) {
+        switch (opt) {
+            case 'h': host = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'c': connections = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'w': warmup = atof(optarg); break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (port <= 0 || connections <= 0 || connections > MAX_CONNECTIONS
+        || duration <= 0.0 || warmup < 0.0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    static char *default_paths[] = { DEFAULT_PATH };
+    char **paths = optind < argc ? argv + optind : default_paths;
+    int path_count = optind < argc ? argc - optind : 1;
+
+    struct client *clients = calloc((size_t)connections, sizeof(*clients));
+    if (!clients) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("stockc_load: %s:%d, %d connections, %.1fs (+%.1fs warmup), %d path(s)\n",
+           host, port, connections, duration, warmup, path_count);
+
+    for (int i = 0; i < connections; i++) {
+        clients[i].host = host;
+        clients[i].port = port;
+        clients[i].paths = paths;
+        clients[i].path_count = path_count;
+        clients[i].first_path = i % path_count;
+
+        if (pthread_create(&clients[i].thread, NULL, client_main, &clients[i]) != 0) {
+            fprintf(stderr, "failed to start client %d\n", i);
+            connections = i;
+            break;
+        }
+    }
+
+    usleep((useconds_t)(warmup * 1e6));
+    uint64_t start = now_ns();
+    atomic_store(&phase, PHASE_MEASURE);
+
+    usleep((useconds_t)(duration * 1e6));
+    atomic_store(&phase, PHASE_STOP);
+    uint64_t end = now_ns();
+
+    size_t total = 0;
+    unsigned long long errors = 0, non_2xx = 0, bytes = 0;
+    unsigned long connects = 0;
+
+    for (int i = 0; i < connections; i++) {
+        pthread_join(clients[i].thread, NULL);
+        total += clients[i].count;
+        errors += clients[i].errors;
+        non_2xx += clients[i].non_2xx;
+        bytes += clients[i].bytes;
+        connects += clients[i].connects;
+    }
+
+    uint64_t *all = malloc((total ? total : 1) * sizeof(*all));
+    if (!all) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t n = 0;
+    double sum_ms = 0.0;
+    for (int i = 0; i < connections; i++) {
+        for (size_t j = 0; j < clients[i].count; j++) {
+            all[n++] = clients[i].latencies_ns[j];
+            sum_ms += (double)clients[i].latencies_ns[j] / 1e6;
+        }
+        free(clients[i].latencies_ns);
+    }
+    qsort(all, n, sizeof(*all), compare_u64);
+
+    double seconds = (double)(end - start) / 1e9;
+
+    printf("requests     %zu (%llu errors, %llu non-2xx, %lu connects)\n",
+           n, errors, non_2xx, connects);
+    printf("throughput   %.0f req/s, %.2f MB/s\n",
+           (double)n / seconds, (double)bytes / seconds / 1e6);
+    printf("latency ms   avg %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+           n ? sum_ms / (double)n : 0.0,
+           percentile_ms(all, n, 0.50),
+           percentile_ms(all, n, 0.90),
+           percentile_ms(all, n, 0.99),
+           percentile_ms(all, n, 0.999),
+           n ? (double)all[n - 1] / 1e6 : 0.0);
+
+    free(all);
+    free(clients);
+    return n > 0 ? 0 : 1;
+}
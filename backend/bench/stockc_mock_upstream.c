@@ -0,0 +1,553 @@
+/*
+ * stockc_mock_upstream: local Alpha Vantage stand-in for offline,
+ * reproducible load tests. Point the server at it with
+ *
+ *   ALPHAVANTAGE_BASE_URL=http://127.0.0.1:18099/query
+ *
+ * Serves GLOBAL_QUOTE and TIME_SERIES_DAILY (compact, or
+ * outputsize=full) from GBM prices seeded by the symbol, so every run
+ * sees the same data and a symbol's quote agrees with its history.
+ * With -r, a recorded <FUNCTION>_<SYMBOL>.json in that directory is
+ * served verbatim instead.
+ *
+ * Fault injection:
+ *   -l/-j    added latency and uniform jitter, milliseconds
+ *   -e       fraction of calls answered 503
+ *   -m/-D    per-minute / per-day quotas; calls over quota get the
+ *            "Note" / "Information" bodies Alpha Vantage sends
+ *   BAD*     symbols get an "Error Message" (unknown ticker)
+ *   NOTE*    symbols always get a rate-limit "Note"
+ *   FAIL*    symbols always get a 503
+ *
+ * GET /stats returns call counters as JSON.
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "civetweb.h"
+#include "stockc/market_series.h"
+
+#include "gbm.h"
+
+#define MOCK_LAST_DAY 20088         // 2024-12-31, a Tuesday
+
+#define MINUTE_LIMIT_MESSAGE \
+    "Thank you for using Alpha Vantage! Our standard API call frequency " \
+    "is 5 calls per minute and 500 calls per day."
+
+#define DAY_LIMIT_MESSAGE \
+    "Thank you for using Alpha Vantage! Our standard API rate limit is " \
+    "25 requests per day. Please subscribe to any of the premium plans."
+
+struct mock_config {
+    int port;
+    int threads;
+    int latency_ms;
+    int jitter_ms;
+    double error_rate;
+    long per_minute;
+    long per_day;
+    int compact_days;
+    int full_days;
+    const char *record_dir;
+    uint64_t seed;
+};
+
+static struct mock_config config = {
+    .port = 18099,
+    .threads = 64,
+    .compact_days = 100,
+    .full_days = 5000,
+    .seed = 1,
+};
+
+static struct {
+    _Atomic unsigned long long calls;
+    _Atomic unsigned long long quotes;
+    _Atomic unsigned long long daily;
+    _Atomic unsigned long long notes;
+    _Atomic unsigned long long errors;
+    _Atomic unsigned long long faults;
+} stats;
+
+static pthread_mutex_t quota_lock = PTHREAD_MUTEX_INITIALIZER;
+static time_t minute_start, day_start;
+static long minute_calls, day_calls;
+
+static _Thread_local struct gbm thread_rng;
+static _Thread_local int thread_rng_ready;
+static _Atomic uint64_t thread_seeds = 1;
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+/*
+ * Growable response body.
+ */
+struct body {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+static int appendf(struct body *b, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static int appendf(struct body *b, const char *fmt, ...)
+{
+    for (;;) {
+        size_t avail = b->cap - b->len;
+
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data ? b->data + b->len : NULL, avail, fmt, ap);
+        va_end(ap);
+
+        if (n < 0)
+            return -1;
+        if ((size_t)n < avail) {
+            b->len += (size_t)n;
+            return 0;
+        }
+
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + (size_t)n + 1)
+            cap *= 2;
+
+        char *grown = realloc(b->data, cap);
+        if (!grown)
+            return -1;
+        b->data = grown;
+        b->cap = cap;
+    }
+}
+
+static double random_unit(void)
+{
+    if (!thread_rng_ready) {
+        gbm_init(&thread_rng, atomic_fetch_add(&thread_seeds, 1) * 7919,
+                 1.0, 0.0, 0.0);
+        thread_rng_ready = 1;
+    }
+    return (double)(gbm_rand(&thread_rng) >> 11) * 0x1.0p-53;
+}
+
+static uint64_t symbol_seed(const char *symbol)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)symbol; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h ^ config.seed;
+}
+
+static int valid_symbol(const char *s)
+{
+    size_t n = strlen(s);
+    if (n == 0 || n >= 16)
+        return 0;
+
+    for (; *s; s++) {
+        if (!isalnum((unsigned char)*s) && *s != '.' && *s != '-' && *s != '^')
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * The symbol's full close path, oldest first, scaled so the newest
+ * close lands on a symbol-specific price between 20 and 500 (a long
+ * raw GBM path can wander far from realistic levels).
+ */
+static double *symbol_closes(const char *symbol, size_t total)
+{
+    double *closes = malloc(total * sizeof(double));
+    if (!closes)
+        return NULL;
+
+    uint64_t seed = symbol_seed(symbol);
+    gbm_fill(closes, total, seed);
+
+    double anchor = 20.0 + (double)(seed % 48000) / 100.0;
+    double scale = anchor / closes[total - 1];
+    for (size_t i = 0; i < total; i++)
+        closes[i] *= scale;
+
+    return closes;
+}
+
+static int is_weekend(int32_t day)
+{
+    int weekday = (int)((day % 7 + 7 + 4) % 7);     // 0 = Sunday
+    return weekday == 0 || weekday == 6;
+}
+
+/*
+ * Trading days (weekdays) ending at MOCK_LAST_DAY, oldest first.
+ */
+static void fill_trading_days(int32_t *days, size_t count)
+{
+    int32_t day = MOCK_LAST_DAY;
+
+    for (size_t i = count; i-- > 0; ) {
+        while (is_weekend(day))
+            day--;
+        days[i] = day--;
+    }
+}
+
+/*
+ * Returns 0 if the call is within quota, 1 if over the per-minute
+ * quota, 2 if over the per-day quota.
+ */
+static int take_quota(void)
+{
+    if (config.per_minute <= 0 && config.per_day <= 0)
+        return 0;
+
+    time_t now = time(NULL);
+    int over = 0;
+
+    pthread_mutex_lock(&quota_lock);
+
+    if (now - minute_start >= 60) {
+        minute_start = now;
+        minute_calls = 0;
+    }
+    if (now - day_start >= 86400) {
+        day_start = now;
+        day_calls = 0;
+    }
+
+    if (config.per_day > 0 && day_calls >= config.per_day) {
+        over = 2;
+    } else if (config.per_minute > 0 && minute_calls >= config.per_minute) {
+        over = 1;
+    } else {
+        minute_calls++;
+        day_calls++;
+    }
+
+    pthread_mutex_unlock(&quota_lock);
+    return over;
+}
+
+
+// ------------------------------------------------------------
+// Payloads
+// ------------------------------------------------------------
+
+static int daily_body(struct body *b, const char *symbol, int full)
+{
+    size_t total = (size_t)config.full_days;
+    size_t count = full ? total : (size_t)config.compact_days;
+    if (count > total)
+        count = total;
+
+    double *closes = symbol_closes(symbol, total);
+    int32_t *days = malloc(count * sizeof(int32_t));
+    if (!closes || !days) {
+        free(closes);
+        free(days);
+        return -1;
+    }
+
+    // Compact output is the newest slice of the full path
+    fill_trading_days(days, count);
+
+    char last[11];
+    market_date_format(days[count - 1], last);
+
+    appendf(b,
+        "{\"Meta Data\":{"
+        "\"1. Information\":\"Daily Prices (open, high, low, close) and Volumes\","
+        "\"2. Symbol\":\"%s\","
+        "\"3. Last Refreshed\":\"%s\","
+        "\"4. Output Size\":\"%s\","
+        "\"5. Time Zone\":\"US/Eastern\"},"
+        "\"Time Series (Daily)\":{",
+        symbol, last, full ? "Full size" : "Compact");
+
+    struct gbm volume_rng;
+    gbm_init(&volume_rng, symbol_seed(symbol) + 1, 1.0, 0.0, 0.0);
+
+    // Upstream order: newest first
+    for (size_t i = count; i-- > 0; ) {
+        size_t at = total - count + i;
+        double close = closes[at];
+        double open = at > 0 ? closes[at - 1] : close;
+        double high = (open > close ? open : close) * 1.005;
+        double low = (open < close ? open : close) * 0.995;
+        unsigned long volume = 1000000ul + (unsigned long)(gbm_rand(&volume_rng) % 9000000ul);
+
+        char date[11];
+        market_date_format(days[i], date);
+
+        appendf(b,
+            "%s\"%s\":{\"1. open\":\"%.4f\",\"2. high\":\"%.4f\","
+            "\"3. low\":\"%.4f\",\"4. close\":\"%.4f\",\"5. volume\":\"%lu\"}",
+            i + 1 < count ? "," : "", date, open, high, low, close, volume);
+    }
+
+    appendf(b, "}}");
+
+    free(days);
+    free(closes);
+    return b->data ? 0 : -1;
+}
+
+static int quote_body(struct body *b, const char *symbol)
+{
+    size_t total = (size_t)config.full_days;
+    if (total < 2)
+        return -1;
+
+    double *closes = symbol_closes(symbol, total);
+    if (!closes)
+        return -1;
+
+    double price = closes[total - 1];
+    double prev = closes[total - 2];
+
+    char last[11];
+    market_date_format(MOCK_LAST_DAY, last);
+
+    appendf(b,
+        "{\"Global Quote\":{"
+        "\"01. symbol\":\"%s\","
+        "\"02. open\":\"%.4f\","
+        "\"03. high\":\"%.4f\","
+        "\"04. low\":\"%.4f\","
+        "\"05. price\":\"%.4f\","
+        "\"06. volume\":\"1000000\","
+        "\"07. latest trading day\":\"%s\","
+        "\"08. previous close\":\"%.4f\","
+        "\"09. change\":\"%.4f\","
+        "\"10. change percent\":\"%.4f%%\"}}",
+        symbol, prev,
+        (prev > price ? prev : price) * 1.005,
+        (prev < price ? prev : price) * 0.995,
+        price, last, prev, price - prev, (price / prev - 1.0) * 100.0);
+
+    free(closes);
+    return b->data ? 0 : -1;
+}
+
+/*
+ * Recorded payload, if -r is set and one exists for the call.
+ * Returns 0 and fills b on success, -1 otherwise.
+ */
+static int recorded_body(struct body *b, const char *function, const char *symbol)
+{
+    if (!config.record_dir)
+        return -1;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s_%s.json",
+             config.record_dir, function, symbol);
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    char chunk[8192];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        appendf(b, "%.*s", (int)n, chunk);
+
+    fclose(f);
+    return b->data ? 0 : -1;
+}
+
+
+// ------------------------------------------------------------
+// Handlers
+// ------------------------------------------------------------
+
+static void send_body(struct mg_connection *conn, int status,
+                      const char *text, const char *data, size_t len)
+{
+    mg_printf(conn,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %zu\r\n"
+        "\r\n",
+        status, text, len);
+    mg_write(conn, data, len);
+}
+
+static void send_message(struct mg_connection *conn, const char *key,
+                         const char *message)
+{
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "{\"%s\":\"%s\"}", key, message);
+    send_body(conn, 200, "OK", buf, (size_t)n);
+}
+
+static int query_handler(struct mg_connection *conn, void *cbdata)
+{
+    (void)cbdata;
+
+    const struct mg_request_info *req = mg_get_request_info(conn);
+    const char *qs = req->query_string ? req->query_string : "";
+    size_t qs_len = strlen(qs);
+
+    char function[32] = "", symbol[32] = "", outputsize[16] = "";
+    mg_get_var(qs, qs_len, "function", function, sizeof(function));
+    mg_get_var(qs, qs_len, "symbol", symbol, sizeof(symbol));
+    mg_get_var(qs, qs_len, "outputsize", outputsize, sizeof(outputsize));
+
+    atomic_fetch_add(&stats.calls, 1);
+
+    int delay_ms = config.latency_ms;
+    if (config.jitter_ms > 0)
+        delay_ms += (int)(random_unit() * config.jitter_ms);
+    if (delay_ms > 0)
+        usleep((useconds_t)delay_ms * 1000);
+
+    if (strncmp(symbol, "FAIL", 4) == 0 ||
+        (config.error_rate > 0.0 && random_unit() < config.error_rate)) {
+        atomic_fetch_add(&stats.faults, 1);
+        send_body(conn, 503, "Service Unavailable", "", 0);
+        return 1;
+    }
+
+    int quota = take_quota();
+    if (quota != 0 || strncmp(symbol, "NOTE", 4) == 0) {
+        atomic_fetch_add(&stats.notes, 1);
+        if (quota == 2)
+            send_message(conn, "Information", DAY_LIMIT_MESSAGE);
+        else
+            send_message(conn, "Note", MINUTE_LIMIT_MESSAGE);
+        return 1;
+    }
+
+    int quote = strcmp(function, "GLOBAL_QUOTE") == 0;
+    int daily = strcmp(function, "TIME_SERIES_DAILY") == 0;
+
+    if ((!quote && !daily) || !valid_symbol(symbol) ||
+        strncmp(symbol, "BAD", 3) == 0) {
+        atomic_fetch_add(&stats.errors, 1);
+        send_message(conn, "Error Message",
+                     "Invalid API call. Please retry or visit the documentation "
+                     "(https://www.alphavantage.co/documentation/) for "
+                     "TIME_SERIES_DAILY.");
+        return 1;
+    }
+
+    atomic_fetch_add(quote ? &stats.quotes : &stats.daily, 1);
+
+    struct body b = { 0 };
+    int rc = recorded_body(&b, function, symbol);
+    if (rc != 0) {
+        rc = quote ? quote_body(&b, symbol)
+                   : daily_body(&b, symbol, strcmp(outputsize, "full") == 0);
+    }
+
+    if (rc != 0)
+        send_body(conn, 500, "Internal Server Error", "", 0);
+    else
+        send_body(conn, 200, "OK", b.data, b.len);
+
+    free(b.data);
+    return 1;
+}
+
+static int stats_handler(struct mg_connection *conn, void *cbdata)
+{
+    (void)cbdata;
+
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf),
+        "{\"calls\":%llu,\"quotes\":%llu,\"daily\":%llu,"
+        "\"notes\":%llu,\"errors\":%llu,\"faults\":%llu}",
+        atomic_load(&stats.calls), atomic_load(&stats.quotes),
+        atomic_load(&stats.daily), atomic_load(&stats.notes),
+        atomic_load(&stats.errors), atomic_load(&stats.faults));
+
+    send_body(conn, 200, "OK", buf, (size_t)n);
+    return 1;
+}
+
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+        "usage: %s [-p port] [-t threads] [-l latency-ms] [-j jitter-ms]\n"
+        "          [-e error-rate] [-m per-minute] [-D per-day]\n"
+        "          [-n compact-days] [-N full-days] [-r record-dir] [-s seed]\n",
+        argv0);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "p:t:l:j:e:m:D:n:N:r:s:")) != -1) {
+        switch (opt) {
+            case 'p': config.port = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'l': config.latency_ms = atoi(optarg); break;
+            case 'j': config.jitter_ms = atoi(optarg); break;
+            case 'e': config.error_rate = atof(optarg); break;
+            case 'm': config.per_minute = atol(optarg); break;
+            case 'D': config.per_day = atol(optarg); break;
+            case 'n': config.compact_days = atoi(optarg); break;
+            case 'N': config.full_days = atoi(optarg); break;
+            case 'r': config.record_dir = optarg; break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (config.port <= 0 || config.threads <= 0 || config.compact_days <= 0 ||
+        config.full_days < 2 || config.latency_ms < 0 || config.jitter_ms < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    char port_str[32], threads_str[16];
+    snprintf(port_str, sizeof(port_str), "127.0.0.1:%d", config.port);
+    snprintf(threads_str, sizeof(threads_str), "%d", config.threads);
+
+    const char *options[] = {
+        "listening_ports", port_str,
+        "num_threads", threads_str,
+        "enable_keep_alive", "yes",
+        "tcp_nodelay", "1",
+        0
+    };
+
+    struct mg_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+
+    mg_init_library(0);
+
+    struct mg_context *ctx = mg_start(&callbacks, NULL, options);
+    if (!ctx) {
+        fprintf(stderr, "Failed to start mock upstream on %s\n", port_str);
+        return 1;
+    }
+
+    mg_set_request_handler(ctx, "/query", query_handler, NULL);
+    mg_set_request_handler(ctx, "/stats", stats_handler, NULL);
+
+    printf("stockc_mock_upstream listening on http://%s/query\n", port_str);
+    fflush(stdout);
+
+    for (;;)
+        pause();
+}
@@ -1,15 +1,52 @@
 #pragma once
 
 #include "stockc/market.h"
+#include "stockc/market_series.h"
+#include "stockc/upstream_governor.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Fetch live market data from Alpha Vantage.
-// Returns 0 on success, non-zero on failure.
+// Every call first takes a token from the upstream governor, at the
+// given priority. Calls it refuses return -7 without going upstream.
+
+// Fetch live market data from Alpha Vantage (interactive priority).
+// Returns 0 on success, non-zero on failure (same codes as below).
 int alpha_vantage_get_quote(const char *symbol, struct stock_quote *out);
 
+// Fetch daily closing prices as a chronological series.
+// On success *out receives a new series (release with
+// market_series_release).
+// Returns 0 on success, non-zero on failure: -100 when the API answers
+// with a rate-limit Note/Information, -101 when it answers with an
+// Error Message (e.g. unknown symbol).
+int alpha_vantage_get_daily_history(
+    const char *symbol,
+    enum upstream_priority priority,
+    struct market_series **out
+);
+
+// Completion for alpha_vantage_get_daily_history_async. Runs on the
+// upstream engine thread (or the governor thread, for a fetch it
+// refused after queueing); on success (rc == 0) the callback owns
+// `series`. Must not block.
+typedef void (*alpha_vantage_history_callback)(
+    int rc,
+    struct market_series *series,
+    void *user
+);
+
+// Non-blocking variant of alpha_vantage_get_daily_history driven by
+// the upstream engine. Returns 0 if the fetch was queued (cb is then
+// called exactly once), non-zero if it could not be started.
+int alpha_vantage_get_daily_history_async(
+    const char *symbol,
+    enum upstream_priority priority,
+    alpha_vantage_history_callback cb,
+    void *user
+);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
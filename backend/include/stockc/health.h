@@ -0,0 +1,8 @@
+#pragma once
+
+#include "civetweb.h"
+
+/**
+ * Registers /health (liveness) and /metrics (Prometheus text format).
+ */
+void register_health_routes(struct mg_context *ctx);
@@ -13,13 +13,46 @@ struct http_response {
     size_t size;     // bytes in body (excluding null terminator)
 };
 
-// Performs a GET request.
+// Response body being received, for http_client_write_body.
+// Start zeroed; ptr is malloc'd and null-terminated once non-empty.
+struct http_body {
+    char *ptr;
+    size_t len;
+    size_t cap;
+};
+
+// CURLOPT_WRITEFUNCTION appending to the struct http_body passed as
+// CURLOPT_WRITEDATA. Shared by http_get and the upstream engine.
+size_t http_client_write_body(void *contents, size_t size, size_t nmemb,
+                              void *userp);
+
+// Upstream connection reuse counters (process-wide), covering both
+// http_get and the upstream engine's transfers.
+struct http_client_stats {
+    unsigned long long requests;            // transfers attempted
+    unsigned long long connections_new;     // transfers that had to connect
+    unsigned long long connections_reused;  // transfers on a kept-alive connection
+    unsigned long long errors;              // transport/setup failures
+};
+
+// Initializes libcurl and the shared DNS / TLS session cache. Call
+// once at startup before worker threads issue requests.
+// Returns 0 on success.
+int http_client_global_init(void);
+
+// Performs a GET request on this thread's pooled handle.
 // Returns 0 on success (even if status != 200), non-zero on transport/setup error.
 // Caller must call http_response_free().
 int http_get(const char *url, long timeout_ms, struct http_response *out);
 
 void http_response_free(struct http_response *res);
 
+// Count one finished transfer: ok = 0 for a transport failure,
+// otherwise `connects` is its CURLINFO_NUM_CONNECTS.
+void http_client_record_transfer(int ok, long connects);
+
+void http_client_get_stats(struct http_client_stats *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Output buffer for the streaming JSON writers.
+ *
+ * A sink either owns a growing buffer in the request arena that ends
+ * up holding the whole document (json_sink_init_arena), or a fixed
+ * buffer handed to `flush` whenever it fills and once more at the end
+ * (json_sink_init_stream), so memory stays bounded however large the
+ * document is.
+ *
+ * Write errors are sticky: once a flush or allocation fails every
+ * later write is dropped and json_sink_finish returns -1.
+ */
+struct json_sink {
+    char *buf;
+    size_t len;
+    size_t cap;
+
+    // Consumes buf[0..len); returns 0 on success. The sink resets len.
+    // `last` is set on the final call.
+    int (*flush)(struct json_sink *sink, int last);
+    void *user;
+
+    int error;
+};
+
+/**
+ * Growing sink in the calling thread's request arena.
+ */
+void json_sink_init_arena(struct json_sink *sink, size_t initial_cap);
+
+/**
+ * Bounded sink over `buf` (cap bytes), drained through `flush`.
+ */
+void json_sink_init_stream(struct json_sink *sink,
+                           char *buf,
+                           size_t cap,
+                           int (*flush)(struct json_sink *, int),
+                           void *user);
+
+/**
+ * Make room for `n` contiguous bytes (n <= the stream cap) and return
+ * where to write them, or NULL after an error. Follow with
+ * json_sink_commit.
+ */
+char *json_sink_reserve(struct json_sink *sink, size_t n);
+
+static inline void json_sink_commit(struct json_sink *sink, char *end)
+{
+    sink->len = (size_t)(end - sink->buf);
+}
+
+void json_sink_write(struct json_sink *sink, const char *data, size_t n);
+
+static inline void json_sink_puts(struct json_sink *sink, const char *s)
+{
+    json_sink_write(sink, s, strlen(s));
+}
+
+/**
+ * Shortest round-trip form of `value`, exactly as yyjson writes it
+ * (e.g. 286.5, 1.0, -0.0314558). Non-finite values become null.
+ */
+void json_sink_real(struct json_sink *sink, double value);
+
+void json_sink_int(struct json_sink *sink, long long value);
+
+/**
+ * `s` as a quoted JSON string, escaped as needed.
+ */
+void json_sink_string(struct json_sink *sink, const char *s);
+
+/**
+ * Final flush (stream sinks) or NUL-terminate (arena sinks).
+ * Returns 0, or -1 if anything failed.
+ */
+int json_sink_finish(struct json_sink *sink);
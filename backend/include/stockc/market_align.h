@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stockc/market_series.h"
+
+/**
+ * Date alignment across several series (merge join).
+ *
+ * Walks k chronological series in lockstep and stops only on dates
+ * every series has, advancing each cursor directly to the furthest
+ * date seen (leapfrog), so alignment is O(total points) and nothing
+ * is copied: each step exposes one index per series.
+ *
+ *     struct market_align a;
+ *     if (market_align_init(&a, series, k, days) == 0) {
+ *         while (market_align_next(&a))
+ *             use(a.date, a.pos);   // series[i]->prices[a.pos[i]]
+ *         market_align_free(&a);
+ *     }
+ */
+struct market_align {
+    const struct market_series *const *series;
+    size_t k;
+    size_t count;       // common dates the walk will visit
+    size_t visited;
+    int32_t date;       // current common date
+    size_t *pos;        // current index into each series
+};
+
+/**
+ * Prepare a forward walk over the trailing `days` dates common to all
+ * `k` series (0 = every common date). a->count holds how many there
+ * are. Returns 0 on success, -1 on failure (no series, allocation).
+ */
+int market_align_init(struct market_align *a,
+                      const struct market_series *const *series,
+                      size_t k,
+                      size_t days);
+
+/**
+ * Advance to the next common date. Returns 1 while positioned on one,
+ * 0 once the walk is finished.
+ */
+int market_align_next(struct market_align *a);
+
+void market_align_free(struct market_align *a);
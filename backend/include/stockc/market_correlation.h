@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "stockc/market_series.h"
+
+/**
+ * Pairwise return covariance / correlation across many series.
+ *
+ * Series are aligned on the dates they all share; returns are taken
+ * between consecutive common dates. Covariance is the population
+ * covariance (same convention as the variance in market_metrics);
+ * correlation is 0 for any series whose returns have no variance, and
+ * exactly 1 on the diagonal otherwise.
+ *
+ * Results use a packed upper-triangle layout, row-major, diagonal
+ * included: element (i, j) with i <= j is at
+ * MARKET_PACKED_INDEX(n, i, j), n * (n + 1) / 2 values in total.
+ */
+
+#define MARKET_PACKED_INDEX(n, i, j) \
+    ((i) * (n) - (i) * ((i) - 1) / 2 + ((j) - (i)))
+
+#define MARKET_PACKED_SIZE(n) ((n) * ((n) + 1) / 2)
+
+/**
+ * Compute the matrix over the trailing `days` common dates (0 = all)
+ * of `n` series into `out` (MARKET_PACKED_SIZE(n) doubles); with
+ * `correlation` zero the covariance is returned instead.
+ *
+ * Rows are processed in cache-sized tiles on the shared compute pool.
+ * *points (if non-NULL) receives the number of aligned dates used; with
+ * fewer than 3 the matrix is all zeros.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int market_correlation_matrix(
+    const struct market_series *const *series,
+    size_t n,
+    size_t days,
+    int correlation,
+    double *out,
+    size_t *points
+);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "stockc/market_series.h"
+
 /**
  * Development fallback market history JSON.
  *
@@ -10,3 +12,10 @@
  * }
  */
 const char *market_demo_history_json(void);
+
+/**
+ * The same fallback history, parsed once into a chronological series.
+ * Returns a new reference (release with market_series_release), or
+ * NULL if parsing failed.
+ */
+struct market_series *market_demo_history_series(void);
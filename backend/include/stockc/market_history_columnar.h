@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stockc/market_series.h"
+
+/**
+ * Columnar binary history, served as application/x-stockc-columnar.
+ *
+ * Same content as the history JSON document, laid out so a client can
+ * view each section as a typed array without parsing. All integers
+ * and floats are little-endian; every section starts on an 8-byte
+ * boundary (zero padding in between).
+ *
+ *   offset  size  header (MARKET_COLUMNAR_HEADER_BYTES)
+ *        0     4  magic "SKCH"
+ *        4     2  u16 version (MARKET_COLUMNAR_VERSION)
+ *        6     1  u8  source: 0 live, 1 cache, 2 demo
+ *        7     1  u8  decimals: 0 = prices are f64, otherwise prices
+ *                     are i32 in units of 10^-decimals
+ *        8     4  u32 point count
+ *       12     4  u32 metrics count
+ *       16     8  i64 fetchedAt, Unix seconds
+ *       24    16  symbol, NUL-padded
+ *       40     4  u32 offset of the dates section (header length)
+ *       44     4  reserved, 0
+ *
+ *   dates    i32[count]   days since 1970-01-01, oldest first
+ *   prices   f64[count] or i32[count], same order as dates
+ *   metrics  count x 40 bytes:
+ *              i32 window (as requested; without windows, the
+ *                  requested days, 0 = full series)
+ *              u32 reserved
+ *              f64 sharpe, sortino, maxDrawdown, cagr
+ *
+ * Points are chronological, unlike the JSON series. Readers should
+ * find the dates through the header's offset, so fields can be added
+ * to the header without a new version; any other layout change bumps
+ * the version.
+ */
+
+#define MARKET_COLUMNAR_CONTENT_TYPE "application/x-stockc-columnar"
+#define MARKET_COLUMNAR_VERSION 1
+#define MARKET_COLUMNAR_HEADER_BYTES 48
+#define MARKET_COLUMNAR_METRICS_BYTES 40
+#define MARKET_COLUMNAR_DECIMALS_MAX 8
+
+/**
+ * Encode the history of `series` (trailing `days`, 0 = all; metrics as
+ * market_history_metrics) into the request arena.
+ *
+ * - decimals: 0 for f64 prices, 1..MARKET_COLUMNAR_DECIMALS_MAX for
+ *   fixed point. Falls back to f64 (and says so in the header) if any
+ *   price does not fit an i32 at that scale.
+ * - source: the header's source code
+ * - series may be NULL: an empty document with only the header
+ *
+ * Returns the encoded bytes with their length in *out_len, or NULL on
+ * failure.
+ */
+void *market_build_history_columnar(
+    const struct market_series *series,
+    int days,
+    const int *windows,
+    size_t window_count,
+    int decimals,
+    uint8_t source,
+    long long fetched_at,
+    size_t *out_len
+);
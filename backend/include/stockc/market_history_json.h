@@ -2,17 +2,158 @@
 
 #include <stddef.h>
 
+#include "stockc/json_sink.h"
+#include "stockc/market_correlation.h"
 #include "stockc/market_metrics.h"
+#include "stockc/market_rolling.h"
+#include "stockc/market_series.h"
+
+/*
+ * Every builder below returns its string from the calling thread's
+ * request arena: it stays valid until the arena is reset at the end
+ * of the request and must not be freed.
+ */
 
 /**
  * Build a history JSON string with metrics injected.
  *
- * - history_json: raw history JSON (symbol + series)
- * - returns a newly allocated JSON string (caller must free)
+ * - series: chronological price series (symbol + dates + prices)
+ * - days: trailing window to emit and measure (0 = full series)
+ * - returns the JSON string (request arena, see above)
+ *
+ * Output series is reverse-chronological:
+ * { "symbol": ..., "series": [ {"date", "price"}, ... ], "metrics": {...} }
  *
  * Returns NULL on failure.
  */
 char *market_build_history_with_metrics(
-    const char *history_json,
+    const struct market_series *series,
     int days
 );
+
+/**
+ * Like market_build_history_with_metrics, but "metrics" holds one
+ * object per trailing window, keyed by the window as given:
+ *
+ * { ..., "metrics": { "5": {...}, "21": {...}, "0": {...} } }
+ *
+ * A window of 0 (or longer than the series) covers the whole series.
+ * The emitted series is still chosen by `days`. All windows come from
+ * the series index, or from one pass over the prices without one.
+ * At most 16 windows; window_count == 0 gives the single-object form.
+ *
+ * Returns NULL on failure.
+ */
+char *market_build_history_with_windows(
+    const struct market_series *series,
+    int days,
+    const int *windows,
+    size_t window_count
+);
+
+/**
+ * Most metric windows a history document can carry.
+ */
+#define MARKET_HISTORY_WINDOWS_MAX 16
+
+/**
+ * Metrics as the history document reports them: with windows, one set
+ * per trailing window in the order given; without, one set for the
+ * trailing `days` slice (zeros if the slice has a single point).
+ * `out` needs room for max(window_count, 1) sets.
+ *
+ * Returns the number of sets written, 0 if the series is too short to
+ * have metrics, or -1 on bad arguments or a failed computation.
+ */
+int market_history_metrics(
+    const struct market_series *series,
+    int days,
+    const int *windows,
+    size_t window_count,
+    struct market_metrics *out
+);
+
+/**
+ * Stream the history document for `series` into `out`, formatting
+ * straight from the series arrays; no DOM is built. The output matches
+ * market_build_history_with_windows byte for byte. Metrics are computed
+ * after the series is written, so a stream sink starts flushing before
+ * any metrics work.
+ *
+ * With `source` set, the document starts with the response metadata:
+ * { "source": ..., "fetchedAt": ..., "symbol": ..., "series": ... }
+ * and a NULL series then gives { "source", "fetchedAt", "series": [] }.
+ *
+ * Returns 0 on success, -1 on bad arguments (nothing written), a failed
+ * metrics computation (the document is still closed, without metrics)
+ * or a sink error.
+ */
+int market_write_history(
+    struct json_sink *out,
+    const struct market_series *series,
+    int days,
+    const int *windows,
+    size_t window_count,
+    const char *source,
+    long long fetched_at
+);
+
+/**
+ * Build a rolling-statistics JSON string.
+ *
+ * - window: prices per rolling window (>= 2)
+ * - days: trailing points to emit (0 = every point with a full window)
+ * - stats: MARKET_ROLLING_* flags selecting the fields
+ *
+ * Output series is reverse-chronological, one entry per window end:
+ * { "symbol": ..., "window": N, "series": [ {"date", "vol", "sharpe",
+ *   "drawdown"}, ... ] }
+ *
+ * Returns NULL on failure.
+ */
+char *market_build_rolling_json(
+    const struct market_series *series,
+    int days,
+    size_t window,
+    unsigned stats
+);
+
+/**
+ * Build a correlation/covariance matrix JSON string.
+ *
+ * - symbols, sources: per-row symbol and data source labels
+ * - points: aligned dates the matrix was computed over
+ * - stat: key for the matrix ("correlation" or "covariance")
+ * - packed: MARKET_PACKED_SIZE(n) values, upper triangle row-major
+ *
+ * { "symbols": [...], "sources": [...], "points": N,
+ *   "layout": "upper", "<stat>": [ ... ] }
+ *
+ * Returns NULL on failure.
+ */
+char *market_build_correlation_json(
+    const char *const *symbols,
+    const char *const *sources,
+    size_t n,
+    size_t points,
+    const char *stat,
+    const double *packed
+);
+
+/**
+ * Build a portfolio JSON string from a value series made by
+ * market_portfolio_series, with metrics over the whole series.
+ *
+ * { "positions": [ {"symbol", "weight", "source"}, ... ],
+ *   "series": [ {"date", "value"}, ... ], "metrics": {...} }
+ *
+ * Weights are reported normalized; the series is
+ * reverse-chronological. Returns NULL on failure.
+ */
+char *market_build_portfolio_json(
+    const struct market_series *portfolio,
+    const char *const *symbols,
+    const double *weights,
+    const char *const *sources,
+    size_t n
+);
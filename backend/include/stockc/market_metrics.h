@@ -15,7 +15,9 @@ struct market_metrics {
  * Calculate risk/return metrics from a price series.
  *
  * prices must be in chronological order (oldest -> newest).
- * count must be >= 2.
+ * count must be >= 2. Runs the widest SIMD kernel the CPU supports
+ * (AVX2, SSE2, or scalar); sums may differ from a scalar loop in the
+ * last few ulps.
  *
  * Returns 0 on success, -1 on failure.
  */
@@ -23,4 +25,85 @@ int market_calculate_metrics(
     const double *prices,
     size_t count,
     struct market_metrics *out
-);
\ No newline at end of file
+);
+
+/**
+ * market_calculate_metrics over many series in one call, e.g. for
+ * screening a whole universe. prices[i] holds counts[i] chronological
+ * prices; results go to out[i]. The SIMD kernel is resolved once for
+ * the whole batch.
+ *
+ * Returns 0 if every series was computed, -1 if any was rejected
+ * (NULL or fewer than 2 prices); rejected entries are zeroed.
+ */
+int market_calculate_metrics_batch(
+    const double *const *prices,
+    const size_t *counts,
+    size_t n,
+    struct market_metrics *out
+);
+
+/**
+ * Metrics for several trailing windows of one series in a single
+ * backward pass. windows[i] is a number of trailing prices (0, or
+ * more than count, means the whole series); results go to out[i].
+ * Windows shorter than 2 prices yield zeroed metrics.
+ *
+ * Drawdown and CAGR match market_calculate_metrics on each slice
+ * exactly; sharpe/sortino agree to within 1e-8 relative (returns are
+ * summed newest-first).
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int market_calculate_metrics_windows(
+    const double *prices,
+    size_t count,
+    const size_t *windows,
+    size_t n,
+    struct market_metrics *out
+);
+
+/**
+ * Precomputed per-series index answering metrics for any window.
+ *
+ * Holds prefix sums of returns, squared returns and downside squares
+ * (O(1) per window) plus a segment tree of (max, min, drawdown) over
+ * prices for max drawdown (O(log n) per window).
+ *
+ * Windows of up to 64 prices are computed directly and match
+ * market_calculate_metrics on the same slice exactly. Longer ones
+ * match to within 1e-8 relative error for sharpe/sortino (prefix-sum
+ * differencing reorders additions), except that a variance below the
+ * rounding bound of the prefix sums counts as zero; max_drawdown and
+ * cagr are exact.
+ */
+struct market_metrics_index;
+
+/**
+ * Build an index over a chronological price series.
+ * Returns NULL on failure (count < 2 or allocation failure).
+ */
+struct market_metrics_index *market_metrics_index_build(
+    const double *prices,
+    size_t count
+);
+
+void market_metrics_index_free(struct market_metrics_index *index);
+
+/**
+ * Metrics for prices[start .. start + count), same semantics as
+ * market_calculate_metrics on that slice.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int market_metrics_index_query(
+    const struct market_metrics_index *index,
+    size_t start,
+    size_t count,
+    struct market_metrics *out
+);
+
+/**
+ * Heap bytes owned by the index.
+ */
+size_t market_metrics_index_bytes(const struct market_metrics_index *index);
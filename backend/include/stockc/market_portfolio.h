@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "stockc/market_series.h"
+
+/**
+ * Buy-and-hold portfolio value series.
+ *
+ * Positions are aligned on the dates every series shares (see
+ * market_align.h). On the first of the trailing `days` common dates
+ * (0 = all) the portfolio is worth 1.0, split by `weights`; each
+ * position then follows its own price:
+ *
+ *     value(t) = sum_i weights[i] * price_i(t) / price_i(t0)
+ *
+ * Weights are normalized to sum to 1 and must sum to a positive
+ * number.
+ *
+ * Returns a new series named `name` (release with
+ * market_series_release), or NULL on failure. A portfolio with no
+ * common dates yields an empty series.
+ */
+struct market_series *market_portfolio_series(
+    const char *name,
+    const struct market_series *const *series,
+    const double *weights,
+    size_t n,
+    size_t days
+);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Rolling statistics over a chronological price series.
+ *
+ * Every point covers a trailing window of `window` prices
+ * (window - 1 returns), the same slice market_calculate_metrics would
+ * see:
+ *
+ * - vol:      annualized standard deviation of returns
+ * - sharpe:   annualized mean / stddev of returns (as market_metrics)
+ * - drawdown: (price - highest price in the window) / highest price
+ */
+
+#define MARKET_ROLLING_VOL      0x1u
+#define MARKET_ROLLING_SHARPE   0x2u
+#define MARKET_ROLLING_DRAWDOWN 0x4u
+#define MARKET_ROLLING_ALL      0x7u
+
+/**
+ * Compute rolling statistics in one O(count) pass: sliding sums of
+ * returns and squared returns, and a monotonic deque for the window
+ * peak. Windows of up to 64 prices are summed directly instead, and
+ * their Sharpe matches market_calculate_metrics exactly; longer ones
+ * match within 1e-8, except that variance below the sums' rounding
+ * bound counts as zero.
+ *
+ * Writes count - window + 1 points to each non-NULL output array;
+ * point k covers prices[k .. k + window). Requires
+ * 2 <= window <= count. The peak deque is scratch in the calling
+ * thread's request arena, released before returning.
+ *
+ * Returns the number of points written, or -1 on failure.
+ */
+long market_calculate_rolling(
+    const double *prices,
+    size_t count,
+    size_t window,
+    double *vol,
+    double *sharpe,
+    double *drawdown
+);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stockc/market.h"
+
+struct market_metrics_index;
+
+/**
+ * Parsed daily price series in structure-of-arrays form.
+ *
+ * - dates:  days since 1970-01-01 (UTC), chronological (oldest -> newest)
+ * - prices: closing prices, same order and length as dates
+ *
+ * Series are immutable once published and reference counted, so a
+ * cache can hand the same series to many readers without copying.
+ */
+struct market_series {
+    char symbol[16];
+    size_t count;
+    int32_t *dates;
+    double *prices;
+    struct market_metrics_index *index;     // optional, see below
+    atomic_int refs;    // private: use market_series_retain/release
+};
+
+/**
+ * Allocate a series with room for `count` points (one allocation).
+ * Returns a series with one reference, or NULL on failure.
+ */
+struct market_series *market_series_create(const char *symbol, size_t count);
+
+struct market_series *market_series_retain(struct market_series *series);
+
+void market_series_release(struct market_series *series);
+
+/**
+ * Build the windowed metrics index for the series if it has none.
+ * Must be called before the series is shared between threads.
+ * Returns 0 on success (or if already built), -1 on failure.
+ */
+int market_series_build_index(struct market_series *series);
+
+/**
+ * Heap bytes owned by the series (header + arrays + index).
+ */
+size_t market_series_bytes(const struct market_series *series);
+
+/**
+ * Latest close and day-over-day change, labelled with the series'
+ * symbol. Returns 0 on success, -1 if there are fewer than two points.
+ */
+int market_series_quote(const struct market_series *series,
+                        struct stock_quote *out);
+
+/**
+ * Convert "YYYY-MM-DD" to a day number.
+ * Returns 0 on success, -1 on malformed input.
+ */
+int market_date_parse(const char *s, int32_t *out_day);
+
+/**
+ * Format a day number as "YYYY-MM-DD" (buf must hold 11 bytes).
+ */
+void market_date_format(int32_t day, char buf[11]);
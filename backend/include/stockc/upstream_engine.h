@@ -0,0 +1,60 @@
+#pragma once
+
+#include "stockc/http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Non-blocking upstream fetch engine.
+//
+// One thread drives a curl multi handle (epoll socket callbacks on
+// Linux). Any thread may submit GET jobs; completions are delivered
+// through a callback on the engine thread, or through a future the
+// submitter can wait on.
+//
+// Configuration (read once by upstream_engine_start):
+//   UPSTREAM_MAX_INFLIGHT  transfers driven at once (default 32);
+//                          further jobs queue in submission order
+
+// Completion callback, run on the engine thread. rc is 0 on success
+// (even if status != 200), non-zero on transport error. On success
+// the callback owns res and must call http_response_free().
+// Callbacks must not block.
+typedef void (*upstream_callback)(int rc, struct http_response *res, void *user);
+
+struct upstream_future;
+
+struct upstream_engine_stats {
+    unsigned long long submitted;
+    unsigned long long completed;
+    unsigned long long failed;      // transport errors
+    unsigned long long in_flight;   // current
+    unsigned long long queued;      // current, waiting for a slot
+};
+
+// Start the engine thread. Returns 0 on success.
+int upstream_engine_start(void);
+
+// Queue a GET. Returns 0 if queued (cb will be called exactly once),
+// non-zero if the engine is not running.
+int upstream_engine_submit(const char *url,
+                           long timeout_ms,
+                           upstream_callback cb,
+                           void *user);
+
+// Queue a GET whose result is collected with upstream_future_wait.
+// Returns NULL if the engine is not running.
+struct upstream_future *upstream_engine_submit_future(const char *url,
+                                                      long timeout_ms);
+
+// Block until the job completes, then free the future.
+// Same return contract as http_get; caller must http_response_free().
+int upstream_future_wait(struct upstream_future *future,
+                         struct http_response *out);
+
+void upstream_engine_get_stats(struct upstream_engine_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
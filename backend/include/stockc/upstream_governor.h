@@ -0,0 +1,82 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Upstream rate-limit governor.
+//
+// Every Alpha Vantage call asks the governor for a token first. Tokens
+// come from a per-minute and a per-day bucket; callers that cannot be
+// served at once wait in a priority queue, where interactive misses
+// go ahead of background refreshes, and refreshes ahead of warmup.
+// Background calls also leave a reserve of each bucket to interactive
+// ones.
+//
+// The governor learns from the upstream's own verdicts: a rate-limit
+// "Note" halves the effective per-minute rate (recovering by one call
+// per clean minute) and pauses all calls for a minute; a daily-limit
+// "Information" pauses them for an hour. While paused, interactive
+// callers are refused at once instead of spending a call that would
+// only end in demo data.
+//
+// Configuration (read once by upstream_governor_start):
+//   UPSTREAM_RATE_PER_MINUTE  per-minute bucket  (default 0 = unlimited)
+//   UPSTREAM_RATE_PER_DAY     per-day bucket     (default 0 = unlimited)
+//   UPSTREAM_QUEUE_WAIT_MS    longest an interactive call waits for a
+//                             token (default 2000)
+//   UPSTREAM_QUEUE_MAX        queued calls across priorities
+//                             (default 1024)
+
+enum upstream_priority {
+    UPSTREAM_PRIORITY_INTERACTIVE,      // a request is waiting on it
+    UPSTREAM_PRIORITY_REFRESH,          // stale-while-revalidate
+    UPSTREAM_PRIORITY_WARMUP,           // startup cache warming
+    UPSTREAM_PRIORITY_COUNT
+};
+
+// What an upstream call told us about our quota.
+enum upstream_outcome {
+    UPSTREAM_OUTCOME_OK,                // answered (data or Error Message)
+    UPSTREAM_OUTCOME_LIMITED,           // "Note": per-minute limit
+    UPSTREAM_OUTCOME_LIMITED_DAILY      // "Information": daily limit
+};
+
+// Decision for a queued request, run on the governor thread. granted
+// is non-zero if the call may go upstream now (its token is spent),
+// zero if it was refused. Must not block.
+typedef void (*upstream_grant_fn)(int granted, void *user);
+
+struct upstream_governor_stats {
+    unsigned long long granted;
+    unsigned long long queued;          // requests that had to wait
+    unsigned long long refused;
+    unsigned long long limited;         // Note responses reported
+    unsigned long long limited_daily;   // Information responses reported
+    unsigned long long waiting;         // current queue depth
+    double rate_per_minute;             // effective; 0 = unlimited
+};
+
+// Start the governor thread. Until it runs, every request is granted.
+// Returns 0 on success.
+int upstream_governor_start(void);
+
+// Ask for a token. Returns 0 if granted now (fn is not called), 1 if
+// queued (fn is called exactly once, later, on the governor thread),
+// -1 if refused now (fn is not called).
+int upstream_governor_request(enum upstream_priority priority,
+                              upstream_grant_fn fn,
+                              void *user);
+
+// Blocking form of upstream_governor_request.
+// Returns 0 once granted, -1 if refused.
+int upstream_governor_acquire(enum upstream_priority priority);
+
+// Feed back what a granted call's response said about the quota.
+void upstream_governor_report(enum upstream_outcome outcome);
+
+void upstream_governor_get_stats(struct upstream_governor_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
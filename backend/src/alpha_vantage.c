@@ -1,13 +1,23 @@
 #include "stockc/alpha_vantage.h"
 #include "stockc/http_client.h"
+#include "stockc/upstream_engine.h"
+#include "stockc/upstream_governor.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "yyjson.h"
+#include "cache/history_cache.h"
+#include "memory/arena.h"
+#include "telemetry/telemetry.h"
 
-#define HISTORY_DAYS 100
+// Days in a default ("compact") TIME_SERIES_DAILY answer; longer
+// histories need outputsize=full
+#define HISTORY_COMPACT_DAYS 100
+
+#define ALPHAVANTAGE_BASE_URL "https://www.alphavantage.co/query"
 
 
 // ------------------------------------------------------------
@@ -27,6 +37,20 @@ static const char *get_api_key(void)
     return key;
 }
 
+/*
+ * Query endpoint; ALPHAVANTAGE_BASE_URL points it at a local stand-in
+ * (e.g. stockc_mock_upstream) for offline and load testing.
+ */
+static const char *get_base_url(void)
+{
+    const char *url = getenv("ALPHAVANTAGE_BASE_URL");
+
+    if (!url || strlen(url) == 0)
+        return ALPHAVANTAGE_BASE_URL;
+
+    return url;
+}
+
 static int parse_percent(const char *s, double *out)
 {
     char buf[32];
@@ -59,42 +83,31 @@ static void log_api_message(const char *endpoint, const char *type, const char *
     );
 }
 
+/*
+ * Tell the governor when a response was a quota message ("Note" is
+ * the per-minute limit, "Information" the daily one). "Error Message"
+ * is an answer about the request, not the quota.
+ */
+static void report_quota(yyjson_val *note, yyjson_val *info)
+{
+    if (note)
+        upstream_governor_report(UPSTREAM_OUTCOME_LIMITED);
+    else if (info)
+        upstream_governor_report(UPSTREAM_OUTCOME_LIMITED_DAILY);
+}
+
 
 // ------------------------------------------------------------
 // Quote
 // ------------------------------------------------------------
 
-int alpha_vantage_get_quote(const char *symbol, struct stock_quote *out)
+/*
+ * Fill `out` from a parsed GLOBAL_QUOTE body.
+ */
+static int quote_from_doc(const char *symbol,
+                          yyjson_doc *doc,
+                          struct stock_quote *out)
 {
-    if (!symbol || !out)
-        return -1;
-
-    const char *api_key = get_api_key();
-    if (!api_key)
-        return -2;
-
-    log_api_call("GLOBAL_QUOTE", symbol);
-
-    char url[512];
-    snprintf(
-        url, sizeof(url),
-        "https://www.alphavantage.co/query"
-        "?function=GLOBAL_QUOTE"
-        "&symbol=%s"
-        "&apikey=%s",
-        symbol, api_key
-    );
-
-    struct http_response res;
-    if (http_get(url, 10000, &res) != 0)
-        return -3;
-
-    yyjson_doc *doc = yyjson_read(res.body, res.size, 0);
-    http_response_free(&res);
-
-    if (!doc)
-        return -4;
-
     yyjson_val *root = yyjson_doc_get_root(doc);
 
     yyjson_val *note = yyjson_obj_get(root, "Note");
@@ -108,15 +121,15 @@ int alpha_vantage_get_quote(const char *symbol, struct stock_quote *out)
                    yyjson_get_str(info);
 
         log_api_message("GLOBAL_QUOTE", "info/error", msg ? msg : "(no message)");
-        yyjson_doc_free(doc);
-        return -100;
+        report_quota(note, info);
+
+        // A limit message wins: it says nothing about the symbol
+        return note || info ? -100 : -101;
     }
 
     yyjson_val *quote = yyjson_obj_get(root, "Global Quote");
-    if (!quote) {
-        yyjson_doc_free(doc);
+    if (!quote)
         return -5;
-    }
 
     const char *price_s =
         yyjson_get_str(yyjson_obj_get(quote, "05. price"));
@@ -125,60 +138,110 @@ int alpha_vantage_get_quote(const char *symbol, struct stock_quote *out)
     const char *pct_s =
         yyjson_get_str(yyjson_obj_get(quote, "10. change percent"));
 
-    if (!price_s || !change_s || !pct_s) {
-        yyjson_doc_free(doc);
+    if (!price_s || !change_s || !pct_s)
         return -6;
-    }
 
     out->price = atof(price_s);
     out->change = atof(change_s);
     parse_percent(pct_s, &out->change_percent);
     strncpy(out->symbol, symbol, sizeof(out->symbol) - 1);
 
-    yyjson_doc_free(doc);
     return 0;
 }
 
-
-// ------------------------------------------------------------
-// Daily history
-// ------------------------------------------------------------
-
-int alpha_vantage_get_daily_history_json(
-    const char *symbol,
-    char *out_json,
-    size_t out_size
-)
+static int fetch_quote(const char *symbol, struct stock_quote *out)
 {
-    if (!symbol || !out_json || out_size == 0)
+    if (!symbol || !out)
         return -1;
 
     const char *api_key = get_api_key();
     if (!api_key)
         return -2;
 
-    log_api_call("TIME_SERIES_DAILY", symbol);
+    if (upstream_governor_acquire(UPSTREAM_PRIORITY_INTERACTIVE) != 0)
+        return -7;
+
+    log_api_call("GLOBAL_QUOTE", symbol);
 
     char url[512];
-    snprintf(
+    int n = snprintf(
         url, sizeof(url),
-        "https://www.alphavantage.co/query"
-        "?function=TIME_SERIES_DAILY"
+        "%s"
+        "?function=GLOBAL_QUOTE"
         "&symbol=%s"
         "&apikey=%s",
-        symbol, api_key
+        get_base_url(), symbol, api_key
     );
 
+    if (n < 0 || (size_t)n >= sizeof(url))
+        return -1;
+
     struct http_response res;
     if (http_get(url, 10000, &res) != 0)
         return -3;
 
-    yyjson_doc *doc = yyjson_read(res.body, res.size, 0);
+    // The parse tree only lives until the fields are copied out
+    struct arena_mark mark = arena_mark();
+
+    yyjson_doc *doc = yyjson_read_opts(res.body, res.size, 0,
+                                       arena_yyjson_alc(), NULL);
+    int rc = doc ? quote_from_doc(symbol, doc, out) : -4;
+
+    yyjson_doc_free(doc);
     http_response_free(&res);
+    arena_rewind(mark);
+
+    return rc;
+}
+
+int alpha_vantage_get_quote(const char *symbol, struct stock_quote *out)
+{
+    uint64_t start = telemetry_now_ns();
+    int rc = fetch_quote(symbol, out);
+
+    telemetry_upstream(TELEMETRY_UPSTREAM_QUOTE, rc,
+                       telemetry_now_ns() - start);
+    return rc;
+}
+
+
+// ------------------------------------------------------------
+// Daily history
+// ------------------------------------------------------------
+
+static int build_daily_history_url(const char *symbol, char *url, size_t size)
+{
+    const char *api_key = get_api_key();
+    if (!api_key)
+        return -2;
+
+    int full = history_cache_max_points() > HISTORY_COMPACT_DAYS;
+
+    int n = snprintf(
+        url, size,
+        "%s"
+        "?function=TIME_SERIES_DAILY"
+        "&symbol=%s"
+        "%s"
+        "&apikey=%s",
+        get_base_url(), symbol, full ? "&outputsize=full" : "", api_key
+    );
 
-    if (!doc)
-        return -4;
+    if (n < 0 || (size_t)n >= size)
+        return -1;
+
+    return 0;
+}
 
+/*
+ * Build a chronological series from a parsed TIME_SERIES_DAILY body.
+ */
+static int daily_history_from_doc(
+    const char *symbol,
+    yyjson_doc *doc,
+    struct market_series **out
+)
+{
     yyjson_val *root = yyjson_doc_get_root(doc);
 
     yyjson_val *note = yyjson_obj_get(root, "Note");
@@ -192,28 +255,28 @@ int alpha_vantage_get_daily_history_json(
                    yyjson_get_str(info);
 
         log_api_message("TIME_SERIES_DAILY", "info/error", msg ? msg : "(no message)");
-        yyjson_doc_free(doc);
-        return -100;
+        report_quota(note, info);
+
+        // A limit message wins: it says nothing about the symbol
+        return note || info ? -100 : -101;
     }
 
     yyjson_val *series =
         yyjson_obj_get(root, "Time Series (Daily)");
 
-    if (!series || !yyjson_is_obj(series)) {
-        yyjson_doc_free(doc);
+    if (!series || !yyjson_is_obj(series))
         return -5;
-    }
 
-    size_t written = 0;
-    written += snprintf(
-        out_json + written,
-        out_size - written,
-        "{"
-          "\"symbol\":\"%s\","
-          "\"series\":[",
-        symbol
-    );
+    // Keep the newest points, as many as the history cache holds
+    size_t capacity = yyjson_obj_size(series);
+    if (capacity > history_cache_max_points())
+        capacity = history_cache_max_points();
 
+    struct market_series *ms = market_series_create(symbol, capacity);
+    if (!ms)
+        return -6;
+
+    // Upstream is newest-first; fill the chronological arrays from the end
     size_t count = 0;
     yyjson_obj_iter iter;
     yyjson_obj_iter_init(series, &iter);
@@ -222,7 +285,7 @@ int alpha_vantage_get_daily_history_json(
 
     while ((key = yyjson_obj_iter_next(&iter)) &&
            (val = yyjson_obj_iter_get_val(key)) &&
-           count < HISTORY_DAYS)
+           count < capacity)
     {
         const char *date = yyjson_get_str(key);
         yyjson_val *close =
@@ -235,26 +298,189 @@ int alpha_vantage_get_daily_history_json(
         if (!price_s)
             continue;
 
-        double price = atof(price_s);
+        int32_t day;
+        if (market_date_parse(date, &day) != 0)
+            continue;
 
-        written += snprintf(
-            out_json + written,
-            out_size - written,
-            "%s{\"date\":\"%s\",\"price\":%.2f}",
-            (count == 0 ? "" : ","),
-            date,
-            price
-        );
+        size_t at = capacity - 1 - count;
+        ms->dates[at] = day;
+        // Prices are kept to the cent, as they always have been served
+        ms->prices[at] = round(atof(price_s) * 100.0) / 100.0;
 
         count++;
     }
 
-    snprintf(
-        out_json + written,
-        out_size - written,
-        "]}"
-    );
+    // Skipped entries leave a gap at the front
+    if (count < capacity) {
+        size_t gap = capacity - count;
+        memmove(ms->prices, ms->prices + gap, count * sizeof(double));
+        memmove(ms->dates, ms->dates + gap, count * sizeof(int32_t));
+        ms->count = count;
+    }
+
+    *out = ms;
+    return 0;
+}
+
+/*
+ * Parse a TIME_SERIES_DAILY body into a chronological series.
+ * Shared by the blocking and engine-driven fetch paths.
+ */
+static int parse_daily_history(
+    const char *symbol,
+    const char *body,
+    size_t size,
+    struct market_series **out
+)
+{
+    // The parse tree only lives until the series is copied out
+    struct arena_mark mark = arena_mark();
+
+    yyjson_doc *doc = yyjson_read_opts((char *)body, size, 0,
+                                       arena_yyjson_alc(), NULL);
+    int rc = doc ? daily_history_from_doc(symbol, doc, out) : -4;
 
     yyjson_doc_free(doc);
+    arena_rewind(mark);
+    return rc;
+}
+
+int alpha_vantage_get_daily_history(
+    const char *symbol,
+    enum upstream_priority priority,
+    struct market_series **out
+)
+{
+    if (!symbol || !out)
+        return -1;
+
+    *out = NULL;
+
+    char url[512];
+    int rc = build_daily_history_url(symbol, url, sizeof(url));
+    if (rc != 0)
+        return rc;
+
+    if (upstream_governor_acquire(priority) != 0)
+        return -7;
+
+    log_api_call("TIME_SERIES_DAILY", symbol);
+
+    uint64_t start = telemetry_now_ns();
+
+    // Prefer the upstream engine; fall back to this thread's handle
+    // when it is not running
+    struct http_response res;
+    struct upstream_future *f = upstream_engine_submit_future(url, 10000);
+
+    if (f ? upstream_future_wait(f, &res) != 0
+          : http_get(url, 10000, &res) != 0) {
+        rc = -3;
+    } else {
+        rc = parse_daily_history(symbol, res.body, res.size, out);
+        http_response_free(&res);
+    }
+
+    telemetry_upstream(TELEMETRY_UPSTREAM_DAILY, rc,
+                       telemetry_now_ns() - start);
+    return rc;
+}
+
+
+// ------------------------------------------------------------
+// Daily history (upstream engine)
+// ------------------------------------------------------------
+
+struct daily_history_request {
+    char symbol[16];
+    char url[512];
+    alpha_vantage_history_callback cb;
+    void *user;
+    uint64_t start_ns;
+};
+
+static void on_daily_history(int rc, struct http_response *res, void *user)
+{
+    struct daily_history_request *req = user;
+    struct market_series *series = NULL;
+
+    if (rc != 0) {
+        rc = -3;
+    } else {
+        rc = parse_daily_history(req->symbol, res->body, res->size, &series);
+        http_response_free(res);
+    }
+
+    telemetry_upstream(TELEMETRY_UPSTREAM_DAILY, rc,
+                       telemetry_now_ns() - req->start_ns);
+
+    req->cb(rc, series, req->user);
+    free(req);
+}
+
+static int submit_daily_history(struct daily_history_request *req)
+{
+    log_api_call("TIME_SERIES_DAILY", req->symbol);
+
+    req->start_ns = telemetry_now_ns();
+
+    return upstream_engine_submit(req->url, 10000, on_daily_history, req);
+}
+
+/*
+ * Runs on the governor thread once a queued fetch is decided.
+ */
+static void on_daily_history_granted(int granted, void *user)
+{
+    struct daily_history_request *req = user;
+
+    int rc = granted ? 0 : -7;
+    if (granted && submit_daily_history(req) != 0)
+        rc = -3;
+
+    if (rc != 0) {
+        req->cb(rc, NULL, req->user);
+        free(req);
+    }
+}
+
+int alpha_vantage_get_daily_history_async(
+    const char *symbol,
+    enum upstream_priority priority,
+    alpha_vantage_history_callback cb,
+    void *user
+)
+{
+    if (!symbol || !cb)
+        return -1;
+
+    struct daily_history_request *req = malloc(sizeof(*req));
+    if (!req)
+        return -6;
+
+    memset(req, 0, sizeof(*req));
+    strncpy(req->symbol, symbol, sizeof(req->symbol) - 1);
+    req->cb = cb;
+    req->user = user;
+
+    int rc = build_daily_history_url(symbol, req->url, sizeof(req->url));
+    if (rc != 0) {
+        free(req);
+        return rc;
+    }
+
+    // Queued requests complete through on_daily_history_granted
+    rc = upstream_governor_request(priority, on_daily_history_granted, req);
+
+    if (rc < 0) {
+        free(req);
+        return -7;
+    }
+
+    if (rc == 0 && submit_daily_history(req) != 0) {
+        free(req);
+        return -3;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,18 +1,223 @@
 #include "history_cache.h"
 
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#define HISTORY_CACHE_TTL 86400  // 1 day
+#define HISTORY_CACHE_TTL 86400                     // 1 day
+#define HISTORY_CACHE_MAX_STALE (7 * 86400)         // 1 week past expiry
+#define HISTORY_CACHE_MAX_BYTES (64u * 1024 * 1024)  // 64 MiB
+#define HISTORY_MAX_POINTS 2520                     // ~10 years of trading days
 
-/*
- * Single-entry cache for now.
- */
-static struct history_cache_entry cache = {0};
+// Cached bytes per series point, rounded up: prices, dates and the
+// metrics index
+#define HISTORY_POINT_BYTES 128
+
+#define SHARD_COUNT 16                 // must be a power of two
+#define SHARD_INITIAL_BUCKETS 32       // must be a power of two
+
+struct history_cache_entry {
+    struct history_cache_entry *hash_next;
+    struct history_cache_entry *lru_prev;   // towards most recently used
+    struct history_cache_entry *lru_next;   // towards least recently used
+    uint64_t hash;
+    char symbol[16];
+    time_t fetched_at;
+    time_t expires_at;
+    size_t bytes;       // accounted size (entry + series)
+    struct market_series *series;
+    struct stock_quote quote;
+    int has_quote;
+};
+
+struct history_cache_shard {
+    pthread_mutex_t lock;
+    struct history_cache_entry **buckets;
+    size_t bucket_count;
+    struct history_cache_entry *lru_head;
+    struct history_cache_entry *lru_tail;
+    size_t entries;
+    size_t bytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+static struct history_cache_shard shards[SHARD_COUNT];
+static size_t shard_budget;
+static long default_ttl;
+static long max_stale;
+static size_t total_budget;
+static size_t max_points;
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static long env_long(const char *name, long fallback)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    char *end = NULL;
+    long n = strtol(v, &end, 10);
+    if (end == v || n <= 0)
+        return fallback;
+
+    return n;
+}
+
+static void init_cache(void)
+{
+    total_budget = (size_t)env_long("HISTORY_CACHE_MAX_BYTES",
+                                    HISTORY_CACHE_MAX_BYTES);
+    default_ttl = env_long("HISTORY_CACHE_TTL", HISTORY_CACHE_TTL);
+    max_stale = env_long("HISTORY_CACHE_MAX_STALE", HISTORY_CACHE_MAX_STALE);
+    shard_budget = total_budget / SHARD_COUNT;
+
+    // A series the budget cannot hold would be refetched on every miss
+    max_points = (size_t)env_long("HISTORY_MAX_POINTS", HISTORY_MAX_POINTS);
+    if (max_points > shard_budget / 4 / HISTORY_POINT_BYTES)
+        max_points = shard_budget / 4 / HISTORY_POINT_BYTES;
+    if (max_points < 2)
+        max_points = 2;
+
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        struct history_cache_shard *s = &shards[i];
+        pthread_mutex_init(&s->lock, NULL);
+        s->buckets = calloc(SHARD_INITIAL_BUCKETS, sizeof(*s->buckets));
+        s->bucket_count = s->buckets ? SHARD_INITIAL_BUCKETS : 0;
+    }
+}
+
+static void ensure_init(void)
+{
+    pthread_once(&init_once, init_cache);
+}
+
+// FNV-1a
+static uint64_t hash_symbol(const char *symbol)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)symbol; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static struct history_cache_shard *shard_for(uint64_t hash)
+{
+    return &shards[hash & (SHARD_COUNT - 1)];
+}
+
+static size_t bucket_for(const struct history_cache_shard *s, uint64_t hash)
+{
+    return (size_t)(hash >> 16) & (s->bucket_count - 1);
+}
+
+static struct history_cache_entry *
+shard_find(struct history_cache_shard *s, const char *symbol, uint64_t hash)
+{
+    if (s->bucket_count == 0)
+        return NULL;
+
+    struct history_cache_entry *e = s->buckets[bucket_for(s, hash)];
+    while (e) {
+        if (e->hash == hash && strcmp(e->symbol, symbol) == 0)
+            return e;
+        e = e->hash_next;
+    }
+    return NULL;
+}
+
+static void lru_unlink(struct history_cache_shard *s,
+                       struct history_cache_entry *e)
+{
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+    else             s->lru_head = e->lru_next;
+
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+    else             s->lru_tail = e->lru_prev;
+
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(struct history_cache_shard *s,
+                           struct history_cache_entry *e)
+{
+    e->lru_prev = NULL;
+    e->lru_next = s->lru_head;
+    if (s->lru_head) s->lru_head->lru_prev = e;
+    s->lru_head = e;
+    if (!s->lru_tail) s->lru_tail = e;
+}
+
+static void hash_unlink(struct history_cache_shard *s,
+                        struct history_cache_entry *e)
+{
+    struct history_cache_entry **pp = &s->buckets[bucket_for(s, e->hash)];
+    while (*pp && *pp != e)
+        pp = &(*pp)->hash_next;
+    if (*pp)
+        *pp = e->hash_next;
+    e->hash_next = NULL;
+}
+
+static void shard_remove(struct history_cache_shard *s,
+                         struct history_cache_entry *e)
+{
+    hash_unlink(s, e);
+    lru_unlink(s, e);
+    s->entries--;
+    s->bytes -= e->bytes;
+    market_series_release(e->series);
+    free(e);
+}
+
+static void shard_grow(struct history_cache_shard *s)
+{
+    size_t new_count = s->bucket_count * 2;
+    struct history_cache_entry **nb = calloc(new_count, sizeof(*nb));
+    if (!nb)
+        return;     // keep chaining on the old table
+
+    for (size_t i = 0; i < s->bucket_count; i++) {
+        struct history_cache_entry *e = s->buckets[i];
+        while (e) {
+            struct history_cache_entry *next = e->hash_next;
+            size_t b = (size_t)(e->hash >> 16) & (new_count - 1);
+            e->hash_next = nb[b];
+            nb[b] = e;
+            e = next;
+        }
+    }
+
+    free(s->buckets);
+    s->buckets = nb;
+    s->bucket_count = new_count;
+}
+
+
+// ------------------------------------------------------------
+// Cache API
+// ------------------------------------------------------------
 
 void history_cache_init(void)
 {
-    // No-op for now
+    ensure_init();
+}
+
+size_t history_cache_max_points(void)
+{
+    ensure_init();
+    return max_points;
 }
 
 int history_cache_is_valid(const char *symbol)
@@ -20,42 +225,225 @@ int history_cache_is_valid(const char *symbol)
     if (!symbol)
         return 0;
 
-    if (strcmp(cache.symbol, symbol) != 0)
-        return 0;
+    ensure_init();
 
-    time_t now = time(NULL);
-    return difftime(now, cache.fetched_at) < HISTORY_CACHE_TTL;
+    uint64_t hash = hash_symbol(symbol);
+    struct history_cache_shard *s = shard_for(hash);
+
+    pthread_mutex_lock(&s->lock);
+    struct history_cache_entry *e = shard_find(s, symbol, hash);
+    int valid = e && time(NULL) < e->expires_at;
+    pthread_mutex_unlock(&s->lock);
+
+    return valid;
 }
 
-const char *history_cache_get(const char *symbol)
+struct market_series *history_cache_get(const char *symbol,
+                                        time_t *fetched_at)
 {
-    if (!history_cache_is_valid(symbol))
+    if (!symbol)
         return NULL;
 
-    return cache.json;
+    ensure_init();
+
+    uint64_t hash = hash_symbol(symbol);
+    struct history_cache_shard *s = shard_for(hash);
+    struct market_series *out = NULL;
+
+    pthread_mutex_lock(&s->lock);
+
+    struct history_cache_entry *e = shard_find(s, symbol, hash);
+    if (e && time(NULL) < e->expires_at) {
+        lru_unlink(s, e);
+        lru_push_front(s, e);
+        out = market_series_retain(e->series);
+        if (fetched_at)
+            *fetched_at = e->fetched_at;
+    }
+
+    if (out) s->hits++;
+    else     s->misses++;
+
+    pthread_mutex_unlock(&s->lock);
+    return out;
 }
 
-time_t history_cache_get_fetched_at(const char *symbol)
+struct market_series *history_cache_get_stale(const char *symbol,
+                                              time_t *fetched_at,
+                                              int *expired)
 {
     if (!symbol)
+        return NULL;
+
+    ensure_init();
+
+    uint64_t hash = hash_symbol(symbol);
+    struct history_cache_shard *s = shard_for(hash);
+    struct market_series *out = NULL;
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&s->lock);
+
+    struct history_cache_entry *e = shard_find(s, symbol, hash);
+    if (e && now < e->expires_at + max_stale) {
+        lru_unlink(s, e);
+        lru_push_front(s, e);
+        out = market_series_retain(e->series);
+        if (fetched_at)
+            *fetched_at = e->fetched_at;
+        if (expired)
+            *expired = now >= e->expires_at;
+    }
+
+    if (out) s->hits++;
+    else     s->misses++;
+
+    pthread_mutex_unlock(&s->lock);
+    return out;
+}
+
+int history_cache_get_quote(const char *symbol,
+                            struct stock_quote *out,
+                            time_t *fetched_at,
+                            int *expired)
+{
+    if (!symbol || !out)
         return 0;
 
-    if (strcmp(cache.symbol, symbol) != 0)
+    ensure_init();
+
+    uint64_t hash = hash_symbol(symbol);
+    struct history_cache_shard *s = shard_for(hash);
+    time_t now = time(NULL);
+    int hit = 0;
+
+    pthread_mutex_lock(&s->lock);
+
+    struct history_cache_entry *e = shard_find(s, symbol, hash);
+    if (e && e->has_quote && now < e->expires_at + max_stale) {
+        lru_unlink(s, e);
+        lru_push_front(s, e);
+        *out = e->quote;
+        if (fetched_at)
+            *fetched_at = e->fetched_at;
+        if (expired)
+            *expired = now >= e->expires_at;
+        hit = 1;
+    }
+
+    if (hit) s->hits++;
+    else     s->misses++;
+
+    pthread_mutex_unlock(&s->lock);
+    return hit;
+}
+
+time_t history_cache_get_fetched_at(const char *symbol)
+{
+    if (!symbol)
         return 0;
 
-    return cache.fetched_at;
+    ensure_init();
+
+    uint64_t hash = hash_symbol(symbol);
+    struct history_cache_shard *s = shard_for(hash);
+
+    pthread_mutex_lock(&s->lock);
+    struct history_cache_entry *e = shard_find(s, symbol, hash);
+    time_t fetched_at = e ? e->fetched_at : 0;
+    pthread_mutex_unlock(&s->lock);
+
+    return fetched_at;
 }
 
-void history_cache_set(const char *symbol, const char *json)
+void history_cache_set(const char *symbol, struct market_series *series)
 {
-    if (!symbol || !json)
+    ensure_init();
+    history_cache_set_ttl(symbol, series, default_ttl);
+}
+
+void history_cache_set_ttl(const char *symbol,
+                           struct market_series *series,
+                           long ttl)
+{
+    if (!symbol || !series || ttl <= 0)
         return;
 
-    strncpy(cache.symbol, symbol, sizeof(cache.symbol) - 1);
-    cache.symbol[sizeof(cache.symbol) - 1] = '\0';
+    ensure_init();
+
+    // Windowed metrics are answered from the index for the entry's life
+    market_series_build_index(series);
+
+    size_t bytes = sizeof(struct history_cache_entry)
+                 + market_series_bytes(series);
+
+    // An entry that can never fit its shard is not worth evicting for
+    if (bytes > shard_budget)
+        return;
+
+    struct history_cache_entry *e = malloc(sizeof(*e));
+    if (!e)
+        return;
+
+    memset(e, 0, sizeof(*e));
+    strncpy(e->symbol, symbol, sizeof(e->symbol) - 1);
+    e->hash = hash_symbol(e->symbol);
+    e->fetched_at = time(NULL);
+    e->expires_at = e->fetched_at + ttl;
+    e->bytes = bytes;
+    e->series = market_series_retain(series);
+    e->has_quote = market_series_quote(series, &e->quote) == 0;
+
+    struct history_cache_shard *s = shard_for(e->hash);
+
+    pthread_mutex_lock(&s->lock);
+
+    if (s->bucket_count == 0) {
+        pthread_mutex_unlock(&s->lock);
+        market_series_release(e->series);
+        free(e);
+        return;
+    }
+
+    struct history_cache_entry *old = shard_find(s, e->symbol, e->hash);
+    if (old)
+        shard_remove(s, old);
+
+    while (s->lru_tail && s->bytes + bytes > shard_budget) {
+        shard_remove(s, s->lru_tail);
+        s->evictions++;
+    }
+
+    if (s->entries >= s->bucket_count)
+        shard_grow(s);
+
+    size_t b = bucket_for(s, e->hash);
+    e->hash_next = s->buckets[b];
+    s->buckets[b] = e;
+    lru_push_front(s, e);
+    s->entries++;
+    s->bytes += bytes;
+
+    pthread_mutex_unlock(&s->lock);
+}
+
+void history_cache_get_stats(struct history_cache_stats *out)
+{
+    if (!out)
+        return;
 
-    strncpy(cache.json, json, sizeof(cache.json) - 1);
-    cache.json[sizeof(cache.json) - 1] = '\0';
+    ensure_init();
+    memset(out, 0, sizeof(*out));
+    out->max_bytes = total_budget;
 
-    cache.fetched_at = time(NULL);
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        struct history_cache_shard *s = &shards[i];
+        pthread_mutex_lock(&s->lock);
+        out->entries += s->entries;
+        out->bytes += s->bytes;
+        out->hits += s->hits;
+        out->misses += s->misses;
+        out->evictions += s->evictions;
+        pthread_mutex_unlock(&s->lock);
+    }
 }
@@ -4,21 +4,51 @@
 #include <stddef.h>
 #include <time.h>
 
+#include "stockc/market_series.h"
+
 /*
- * History cache entry.
- * Stores JSON already formatted for the API response.
+ * History cache.
+ *
+ * Sharded hash table keyed by symbol. Each shard has its own lock,
+ * LRU list and slice of the overall byte budget, so CivetWeb workers
+ * asking for different symbols rarely touch the same mutex.
+ *
+ * Entries hold parsed, reference-counted price series; readers get
+ * their own reference and never copy the data. Each entry also keeps
+ * the latest quote, so quote lookups only copy a few fields.
+ *
+ * Configuration (read once by history_cache_init):
+ *   HISTORY_CACHE_MAX_BYTES  total memory budget   (default 64 MiB)
+ *   HISTORY_CACHE_TTL        default TTL, seconds  (default 1 day)
+ *   HISTORY_CACHE_MAX_STALE  how long past its TTL an entry may still
+ *                            be served stale, seconds (default 1 week)
+ *   HISTORY_MAX_POINTS       longest series fetched and kept per symbol
+ *                            (default 2520, about ten years of trading
+ *                            days); lowered so one series takes at most
+ *                            a quarter of a shard's share of the budget
  */
-struct history_cache_entry {
-    char symbol[16];
-    time_t fetched_at;
-    char json[8192];
+
+struct history_cache_stats {
+    size_t entries;
+    size_t bytes;
+    size_t max_bytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
 };
 
 /*
- * Initialize the cache (currently a no-op, but future-proof).
+ * Initialize the cache. Safe to call more than once; the cache also
+ * initializes itself lazily on first use.
  */
 void history_cache_init(void);
 
+/*
+ * Longest series worth fetching for the cache: HISTORY_MAX_POINTS,
+ * capped by the memory budget.
+ */
+size_t history_cache_max_points(void);
+
 /*
  * Check whether cached data for `symbol` is still valid.
  * Returns 1 if valid, 0 otherwise.
@@ -26,20 +56,57 @@ void history_cache_init(void);
 int history_cache_is_valid(const char *symbol);
 
 /*
- * Get cached JSON for `symbol`.
- * Returns pointer to internal buffer, or NULL if invalid.
+ * Get the cached series for `symbol`.
+ * Returns a new reference (release with market_series_release), or
+ * NULL if the entry is missing or expired. If fetched_at is non-NULL
+ * it receives the entry's fetch time.
  */
-const char *history_cache_get(const char *symbol);
+struct market_series *history_cache_get(const char *symbol,
+                                        time_t *fetched_at);
 
 /*
- * NEW: Get the timestamp of when the cache was last fetched.
+ * Like history_cache_get, but also returns entries past their TTL
+ * (up to HISTORY_CACHE_MAX_STALE), for stale-while-revalidate.
+ * *expired (if non-NULL) is set to 1 when the entry is past its TTL.
+ */
+struct market_series *history_cache_get_stale(const char *symbol,
+                                              time_t *fetched_at,
+                                              int *expired);
+
+/*
+ * Copy the quote record stored with `symbol`'s series (fresh or
+ * stale, as history_cache_get_stale) without taking a reference.
+ * Returns 1 on a hit, 0 if there is no usable entry or its series is
+ * too short to quote.
+ */
+int history_cache_get_quote(const char *symbol,
+                            struct stock_quote *out,
+                            time_t *fetched_at,
+                            int *expired);
+
+/*
+ * Get the timestamp of when the entry was last fetched.
  * Returns 0 if not present.
  */
 time_t history_cache_get_fetched_at(const char *symbol);
 
 /*
- * Store JSON in cache for `symbol` with current timestamp.
+ * Store a series in cache for `symbol` with current timestamp and the
+ * default TTL. The cache takes its own reference, builds the series'
+ * metrics index if it has none and derives the symbol's quote record.
+ */
+void history_cache_set(const char *symbol, struct market_series *series);
+
+/*
+ * Same as history_cache_set, with an explicit TTL in seconds.
+ */
+void history_cache_set_ttl(const char *symbol,
+                           struct market_series *series,
+                           long ttl);
+
+/*
+ * Snapshot of cache counters (summed across shards).
  */
-void history_cache_set(const char *symbol, const char *json);
+void history_cache_get_stats(struct history_cache_stats *out);
 
 #endif /* STOCKC_HISTORY_CACHE_H */
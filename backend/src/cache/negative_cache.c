@@ -0,0 +1,265 @@
+#include "negative_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NEGATIVE_CACHE_TTL_UNKNOWN 300
+#define NEGATIVE_CACHE_TTL_LIMITED 30
+#define NEGATIVE_CACHE_TTL_ERROR 10
+#define NEGATIVE_CACHE_MAX_ENTRIES 4096
+
+#define BUCKET_COUNT 1024           // must be a power of two
+#define MAX_BACKOFF_SHIFT 6         // 64x the base TTL
+#define FORGET_AFTER 86400          // failures older than this start over
+
+enum failure_class {
+    FAILURE_UNKNOWN_SYMBOL,
+    FAILURE_RATE_LIMITED,
+    FAILURE_UPSTREAM_ERROR,
+    FAILURE_CLASS_COUNT
+};
+
+struct negative_entry {
+    struct negative_entry *hash_next;
+    struct negative_entry *older;       // insertion order, for eviction
+    struct negative_entry *newer;
+    uint64_t hash;
+    char symbol[16];
+    int rc;
+    int failures;                       // consecutive
+    time_t expires_at;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct negative_entry *buckets[BUCKET_COUNT];
+static struct negative_entry *oldest = NULL;
+static struct negative_entry *newest = NULL;
+static size_t entries = 0;
+static size_t max_entries;
+static long base_ttl[FAILURE_CLASS_COUNT];
+static struct negative_cache_stats stats = {0};
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------------------------------------
+// Helpers (caller holds lock unless noted)
+// ------------------------------------------------------------
+
+static long env_long(const char *name, long fallback)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    char *end = NULL;
+    long n = strtol(v, &end, 10);
+    if (end == v || n <= 0)
+        return fallback;
+
+    return n;
+}
+
+static void init_cache(void)
+{
+    base_ttl[FAILURE_UNKNOWN_SYMBOL] =
+        env_long("NEGATIVE_CACHE_TTL_UNKNOWN", NEGATIVE_CACHE_TTL_UNKNOWN);
+    base_ttl[FAILURE_RATE_LIMITED] =
+        env_long("NEGATIVE_CACHE_TTL_LIMITED", NEGATIVE_CACHE_TTL_LIMITED);
+    base_ttl[FAILURE_UPSTREAM_ERROR] =
+        env_long("NEGATIVE_CACHE_TTL_ERROR", NEGATIVE_CACHE_TTL_ERROR);
+    max_entries = (size_t)env_long("NEGATIVE_CACHE_MAX_ENTRIES",
+                                   NEGATIVE_CACHE_MAX_ENTRIES);
+}
+
+static void ensure_init(void)
+{
+    pthread_once(&init_once, init_cache);
+}
+
+// FNV-1a
+static uint64_t hash_symbol(const char *symbol)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)symbol; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/*
+ * Returns the class for a cacheable failure, -1 for anything else.
+ */
+static int classify(int rc)
+{
+    switch (rc) {
+        case -101:
+            return FAILURE_UNKNOWN_SYMBOL;
+        case -100:
+            return FAILURE_RATE_LIMITED;
+        case -3: case -4: case -5: case -6:
+            return FAILURE_UPSTREAM_ERROR;
+        default:
+            return -1;
+    }
+}
+
+static struct negative_entry *find(const char *symbol, uint64_t hash)
+{
+    struct negative_entry *e = buckets[hash & (BUCKET_COUNT - 1)];
+    while (e) {
+        if (e->hash == hash && strcmp(e->symbol, symbol) == 0)
+            return e;
+        e = e->hash_next;
+    }
+    return NULL;
+}
+
+static void unlink_order(struct negative_entry *e)
+{
+    if (e->older) e->older->newer = e->newer;
+    else          oldest = e->newer;
+
+    if (e->newer) e->newer->older = e->older;
+    else          newest = e->older;
+
+    e->older = e->newer = NULL;
+}
+
+static void push_newest(struct negative_entry *e)
+{
+    e->newer = NULL;
+    e->older = newest;
+    if (newest) newest->newer = e;
+    newest = e;
+    if (!oldest) oldest = e;
+}
+
+static void remove_entry(struct negative_entry *e)
+{
+    struct negative_entry **pp = &buckets[e->hash & (BUCKET_COUNT - 1)];
+    while (*pp && *pp != e)
+        pp = &(*pp)->hash_next;
+    if (*pp)
+        *pp = e->hash_next;
+
+    unlink_order(e);
+    entries--;
+    free(e);
+}
+
+
+// ------------------------------------------------------------
+// Cache API
+// ------------------------------------------------------------
+
+void negative_cache_init(void)
+{
+    ensure_init();
+}
+
+int negative_cache_check(const char *symbol, int *rc)
+{
+    if (!symbol)
+        return 0;
+
+    ensure_init();
+
+    uint64_t hash = hash_symbol(symbol);
+    int hit = 0;
+
+    pthread_mutex_lock(&lock);
+
+    struct negative_entry *e = find(symbol, hash);
+    if (e && time(NULL) < e->expires_at) {
+        hit = 1;
+        stats.hits++;
+        if (rc)
+            *rc = e->rc;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return hit;
+}
+
+void negative_cache_record(const char *symbol, int rc)
+{
+    if (!symbol)
+        return;
+
+    int cls = classify(rc);
+    if (rc != 0 && cls < 0)
+        return;
+
+    ensure_init();
+
+    uint64_t hash = hash_symbol(symbol);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&lock);
+
+    struct negative_entry *e = find(symbol, hash);
+
+    if (rc == 0) {
+        if (e) {
+            remove_entry(e);
+            stats.cleared++;
+        }
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    if (e) {
+        // Refresh its place in the eviction order
+        unlink_order(e);
+        push_newest(e);
+
+        if (classify(e->rc) != cls || now > e->expires_at + FORGET_AFTER)
+            e->failures = 0;
+    } else {
+        while (entries >= max_entries && oldest) {
+            remove_entry(oldest);
+            stats.evictions++;
+        }
+
+        e = calloc(1, sizeof(*e));
+        if (!e) {
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+
+        strncpy(e->symbol, symbol, sizeof(e->symbol) - 1);
+        e->hash = hash_symbol(e->symbol);
+
+        struct negative_entry **head = &buckets[e->hash & (BUCKET_COUNT - 1)];
+        e->hash_next = *head;
+        *head = e;
+        push_newest(e);
+        entries++;
+    }
+
+    int shift = e->failures < MAX_BACKOFF_SHIFT ? e->failures : MAX_BACKOFF_SHIFT;
+    e->failures++;
+    e->rc = rc;
+    e->expires_at = now + (base_ttl[cls] << shift);
+    stats.recorded++;
+
+    pthread_mutex_unlock(&lock);
+}
+
+void negative_cache_get_stats(struct negative_cache_stats *out)
+{
+    if (!out)
+        return;
+
+    ensure_init();
+
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    out->entries = entries;
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,57 @@
+#ifndef STOCKC_NEGATIVE_CACHE_H
+#define STOCKC_NEGATIVE_CACHE_H
+
+#include <stddef.h>
+
+/*
+ * Negative cache.
+ *
+ * Remembers symbols whose last upstream fetch failed, so repeated
+ * requests for a typo'd ticker or during a throttled period cost a
+ * hash lookup instead of an upstream round trip each. Every failure
+ * class has its own base TTL; consecutive failures double it, up to
+ * 64x. A successful fetch clears the symbol.
+ *
+ * Classes (from alpha_vantage return codes):
+ *   unknown symbol  -101 (Error Message)
+ *   rate limited    -100 (Note / Information)
+ *   upstream error  transport and payload failures (-3 .. -6)
+ * Local refusals (bad arguments, no API key, governor -7) are not
+ * cached; they cost nothing upstream.
+ *
+ * Configuration (read once by negative_cache_init):
+ *   NEGATIVE_CACHE_TTL_UNKNOWN   base TTL, seconds  (default 300)
+ *   NEGATIVE_CACHE_TTL_LIMITED   base TTL, seconds  (default 30)
+ *   NEGATIVE_CACHE_TTL_ERROR     base TTL, seconds  (default 10)
+ *   NEGATIVE_CACHE_MAX_ENTRIES   symbols remembered (default 4096)
+ */
+
+struct negative_cache_stats {
+    size_t entries;
+    unsigned long long hits;
+    unsigned long long recorded;
+    unsigned long long cleared;
+    unsigned long long evictions;
+};
+
+/*
+ * Initialize the cache. Safe to call more than once; the cache also
+ * initializes itself lazily on first use.
+ */
+void negative_cache_init(void);
+
+/*
+ * Returns 1 if `symbol` failed recently and should not be fetched;
+ * *rc (if non-NULL) receives the failure's return code. 0 otherwise.
+ */
+int negative_cache_check(const char *symbol, int *rc);
+
+/*
+ * Record the outcome of an upstream fetch for `symbol`: rc == 0 clears
+ * it, a cacheable failure stores it (extending the backoff).
+ */
+void negative_cache_record(const char *symbol, int rc);
+
+void negative_cache_get_stats(struct negative_cache_stats *out);
+
+#endif /* STOCKC_NEGATIVE_CACHE_H */
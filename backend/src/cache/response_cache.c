@@ -0,0 +1,336 @@
+#include "response_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../http/responses.h"
+
+#define RESPONSE_CACHE_MAX_BYTES (16u * 1024 * 1024)  // 16 MiB
+
+#define SHARD_COUNT 8               // must be a power of two
+#define SHARD_BUCKETS 256           // must be a power of two
+#define KEY_MAX 160
+
+/*
+ * Table node. The public entry is embedded so a reference can outlive
+ * eviction: the node is freed when its last reference goes.
+ */
+struct response_node {
+    struct response_cache_entry entry;     // must be first
+    struct response_node *hash_next;
+    struct response_node *lru_prev;
+    struct response_node *lru_next;
+    uint64_t hash;
+    size_t bytes;
+    char key[KEY_MAX];
+};
+
+struct response_cache_shard {
+    pthread_mutex_t lock;
+    struct response_node *buckets[SHARD_BUCKETS];
+    struct response_node *lru_head;
+    struct response_node *lru_tail;
+    size_t entries;
+    size_t bytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+static struct response_cache_shard shards[SHARD_COUNT];
+static size_t shard_budget;
+static size_t total_budget;
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static void init_cache(void)
+{
+    total_budget = RESPONSE_CACHE_MAX_BYTES;
+
+    const char *v = getenv("RESPONSE_CACHE_MAX_BYTES");
+    if (v && strlen(v) > 0) {
+        long n = strtol(v, NULL, 10);
+        if (n > 0)
+            total_budget = (size_t)n;
+    }
+
+    shard_budget = total_budget / SHARD_COUNT;
+
+    for (size_t i = 0; i < SHARD_COUNT; i++)
+        pthread_mutex_init(&shards[i].lock, NULL);
+}
+
+static void ensure_init(void)
+{
+    pthread_once(&init_once, init_cache);
+}
+
+// FNV-1a
+static uint64_t fnv1a(const void *data, size_t len, uint64_t h)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+#define FNV_OFFSET 1469598103934665603ULL
+
+static struct response_cache_shard *shard_for(uint64_t hash)
+{
+    return &shards[hash & (SHARD_COUNT - 1)];
+}
+
+static size_t bucket_for(uint64_t hash)
+{
+    return (size_t)(hash >> 16) & (SHARD_BUCKETS - 1);
+}
+
+static struct response_node *
+shard_find(struct response_cache_shard *s, const char *key, uint64_t hash)
+{
+    struct response_node *n = s->buckets[bucket_for(hash)];
+    while (n) {
+        if (n->hash == hash && strcmp(n->key, key) == 0)
+            return n;
+        n = n->hash_next;
+    }
+    return NULL;
+}
+
+static void lru_unlink(struct response_cache_shard *s, struct response_node *n)
+{
+    if (n->lru_prev) n->lru_prev->lru_next = n->lru_next;
+    else             s->lru_head = n->lru_next;
+
+    if (n->lru_next) n->lru_next->lru_prev = n->lru_prev;
+    else             s->lru_tail = n->lru_prev;
+
+    n->lru_prev = n->lru_next = NULL;
+}
+
+static void lru_push_front(struct response_cache_shard *s,
+                           struct response_node *n)
+{
+    n->lru_prev = NULL;
+    n->lru_next = s->lru_head;
+    if (s->lru_head) s->lru_head->lru_prev = n;
+    s->lru_head = n;
+    if (!s->lru_tail) s->lru_tail = n;
+}
+
+static void node_release(struct response_node *n)
+{
+    if (atomic_fetch_sub_explicit(&n->entry.refs, 1,
+                                  memory_order_acq_rel) == 1) {
+        // One buffer holds every variant, identity first
+        free((char *)n->entry.variants[CONTENT_CODING_IDENTITY].wire);
+        free(n);
+    }
+}
+
+static void shard_remove(struct response_cache_shard *s,
+                         struct response_node *n)
+{
+    struct response_node **pp = &s->buckets[bucket_for(n->hash)];
+    while (*pp && *pp != n)
+        pp = &(*pp)->hash_next;
+    if (*pp)
+        *pp = n->hash_next;
+
+    lru_unlink(s, n);
+    s->entries--;
+    s->bytes -= n->bytes;
+    node_release(n);    // drop the table's reference
+}
+
+
+// ------------------------------------------------------------
+// Cache API
+// ------------------------------------------------------------
+
+void response_cache_init(void)
+{
+    ensure_init();
+}
+
+struct response_cache_entry *response_cache_get(const char *key)
+{
+    if (!key)
+        return NULL;
+
+    ensure_init();
+
+    uint64_t hash = fnv1a(key, strlen(key), FNV_OFFSET);
+    struct response_cache_shard *s = shard_for(hash);
+
+    pthread_mutex_lock(&s->lock);
+
+    struct response_node *n = shard_find(s, key, hash);
+    if (n) {
+        lru_unlink(s, n);
+        lru_push_front(s, n);
+        atomic_fetch_add_explicit(&n->entry.refs, 1, memory_order_relaxed);
+        s->hits++;
+    } else {
+        s->misses++;
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    return n ? &n->entry : NULL;
+}
+
+struct response_cache_entry *response_cache_put(const char *key,
+                                                const char *body,
+                                                size_t body_len)
+{
+    if (!key || !body || strlen(key) >= KEY_MAX)
+        return NULL;
+
+    ensure_init();
+
+    struct response_node *n = calloc(1, sizeof(*n));
+    if (!n)
+        return NULL;
+
+    // Compressed once here; hits only choose among the results
+    struct content_encodings enc;
+    content_coding_encode(body, body_len, &enc);
+
+    enc.data[CONTENT_CODING_IDENTITY] = (char *)body;
+    enc.len[CONTENT_CODING_IDENTITY] = body_len;
+
+    unsigned long long hash = fnv1a(body, body_len, FNV_OFFSET);
+    char heads[CONTENT_CODING_COUNT][RESPONSE_HEAD_MAX];
+    size_t head_len[CONTENT_CODING_COUNT];
+    size_t total = 0;
+
+    for (size_t c = 0; c < CONTENT_CODING_COUNT; c++) {
+        struct response_variant *v = &n->entry.variants[c];
+        const char *coding = content_coding_name((enum content_coding)c);
+
+        head_len[c] = 0;
+        if (!enc.data[c])
+            continue;
+
+        if (coding)
+            snprintf(v->etag, sizeof(v->etag), "\"%016llx-%s\"",
+                     hash, coding);
+        else
+            snprintf(v->etag, sizeof(v->etag), "\"%016llx\"", hash);
+
+        head_len[c] = format_json_head(heads[c], sizeof(heads[c]), 200,
+                                       enc.len[c], v->etag, coding);
+        total += head_len[c] ? head_len[c] + enc.len[c] : 0;
+    }
+
+    // Every variant in one buffer: each hit is still a single write
+    char *wire = head_len[CONTENT_CODING_IDENTITY] ? malloc(total) : NULL;
+
+    if (!wire) {
+        enc.data[CONTENT_CODING_IDENTITY] = NULL;
+        content_coding_free(&enc);
+        free(n);
+        return NULL;
+    }
+
+    char *at = wire;
+    for (size_t c = 0; c < CONTENT_CODING_COUNT; c++) {
+        struct response_variant *v = &n->entry.variants[c];
+        if (head_len[c] == 0)
+            continue;
+
+        memcpy(at, heads[c], head_len[c]);
+        memcpy(at + head_len[c], enc.data[c], enc.len[c]);
+        v->wire = at;
+        v->wire_len = head_len[c] + enc.len[c];
+        v->body_len = enc.len[c];
+        at += v->wire_len;
+    }
+
+    enc.data[CONTENT_CODING_IDENTITY] = NULL;
+    content_coding_free(&enc);
+
+    strcpy(n->key, key);
+    n->hash = fnv1a(key, strlen(key), FNV_OFFSET);
+    n->bytes = sizeof(*n) + total;
+
+    // One reference for the caller, one for the table
+    atomic_init(&n->entry.refs, 2);
+
+    if (n->bytes > shard_budget) {
+        atomic_store(&n->entry.refs, 1);
+        return &n->entry;   // too big to keep, still usable once
+    }
+
+    struct response_cache_shard *s = shard_for(n->hash);
+
+    pthread_mutex_lock(&s->lock);
+
+    struct response_node *old = shard_find(s, key, n->hash);
+    if (old)
+        shard_remove(s, old);
+
+    while (s->lru_tail && s->bytes + n->bytes > shard_budget) {
+        shard_remove(s, s->lru_tail);
+        s->evictions++;
+    }
+
+    size_t b = bucket_for(n->hash);
+    n->hash_next = s->buckets[b];
+    s->buckets[b] = n;
+    lru_push_front(s, n);
+    s->entries++;
+    s->bytes += n->bytes;
+
+    pthread_mutex_unlock(&s->lock);
+    return &n->entry;
+}
+
+const struct response_variant *
+response_cache_select(const struct response_cache_entry *entry,
+                      const char *accept_encoding)
+{
+    size_t len[CONTENT_CODING_COUNT];
+    for (size_t c = 0; c < CONTENT_CODING_COUNT; c++)
+        len[c] = entry->variants[c].wire ? entry->variants[c].body_len : 0;
+
+    return &entry->variants[content_coding_negotiate(accept_encoding, len)];
+}
+
+void response_cache_release(struct response_cache_entry *entry)
+{
+    if (entry)
+        node_release((struct response_node *)entry);
+}
+
+void response_cache_get_stats(struct response_cache_stats *out)
+{
+    if (!out)
+        return;
+
+    ensure_init();
+    memset(out, 0, sizeof(*out));
+    out->max_bytes = total_budget;
+
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        struct response_cache_shard *s = &shards[i];
+        pthread_mutex_lock(&s->lock);
+        out->entries += s->entries;
+        out->bytes += s->bytes;
+        out->hits += s->hits;
+        out->misses += s->misses;
+        out->evictions += s->evictions;
+        pthread_mutex_unlock(&s->lock);
+    }
+}
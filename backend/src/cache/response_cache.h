@@ -0,0 +1,88 @@
+#ifndef STOCKC_RESPONSE_CACHE_H
+#define STOCKC_RESPONSE_CACHE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "../http/content_coding.h"
+
+/*
+ * Response cache.
+ *
+ * Finished responses keyed by a caller-built string such as
+ * "history|AAPL|30|cache|1700000000". Keys embed the data's fetch
+ * time, so a refreshed series simply produces new keys and the old
+ * entries age out of the LRU.
+ *
+ * Each entry carries the complete 200 response (head and body in one
+ * buffer), so a hit is sent with one write and no formatting. Bodies
+ * worth compressing are also stored gzip-, deflate- and (when built
+ * with brotli) br-encoded, each as its own complete response; a
+ * request picks one by its Accept-Encoding and nothing is compressed
+ * per request. Every variant has its own strong ETag, computed once
+ * when the entry is stored.
+ *
+ * Configuration (read once by response_cache_init):
+ *   RESPONSE_CACHE_MAX_BYTES  total memory budget, all variants
+ *                             included (default 16 MiB)
+ *
+ * The variants follow the RESPONSE_* compression settings in
+ * http/content_coding.h.
+ */
+
+struct response_variant {
+    const char *wire;   // status line, headers, body; NULL if absent
+    size_t wire_len;
+    size_t body_len;
+    char etag[32];      // quoted, e.g. "\"0123456789abcdef-gzip\""
+};
+
+struct response_cache_entry {
+    struct response_variant variants[CONTENT_CODING_COUNT];
+    atomic_int refs;    // private: use response_cache_release
+};
+
+struct response_cache_stats {
+    size_t entries;
+    size_t bytes;
+    size_t max_bytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+/*
+ * Initialize the cache. Safe to call more than once; the cache also
+ * initializes itself lazily on first use.
+ */
+void response_cache_init(void);
+
+/*
+ * Look up `key`. Returns a new reference (release with
+ * response_cache_release), or NULL on miss.
+ */
+struct response_cache_entry *response_cache_get(const char *key);
+
+/*
+ * Store a copy of `body` under `key`, assembled behind its response
+ * head, along with its compressed variants. Returns a new reference
+ * to the stored entry, or NULL on failure.
+ */
+struct response_cache_entry *response_cache_put(const char *key,
+                                                const char *body,
+                                                size_t body_len);
+
+/*
+ * The variant of `entry` to answer a request with the given
+ * Accept-Encoding header (may be NULL). Never NULL: the identity
+ * variant is always present.
+ */
+const struct response_variant *
+response_cache_select(const struct response_cache_entry *entry,
+                      const char *accept_encoding);
+
+void response_cache_release(struct response_cache_entry *entry);
+
+void response_cache_get_stats(struct response_cache_stats *out);
+
+#endif /* STOCKC_RESPONSE_CACHE_H */
@@ -1,11 +1,24 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "market_controller.h"
 #include "../services/market_service.h"
 #include "../http/responses.h"
+#include "../cache/history_cache.h"
+#include "../cache/response_cache.h"
+#include "../memory/arena.h"
 #include "stockc/market.h"
+#include "stockc/market_history_columnar.h"
+#include "stockc/market_history_json.h"
+#include "stockc/market_portfolio.h"
+
+// "%.2f" of any finite double: sign, DBL_MAX's 309 digits, ".00"
+#define QUOTE_NUMBER_MAX 313
+// One quotes-batch entry at its largest: three such numbers, symbol,
+// source, fetchedAt and the fixed text
+#define QUOTE_ENTRY_MAX (3 * QUOTE_NUMBER_MAX + 192)
 
 
 // ------------------------------------------------------------
@@ -22,19 +35,217 @@ static const char *source_to_string(enum market_data_source src)
 }
 
 
+// ------------------------------------------------------------
+// Helper: response cache plumbing
+// ------------------------------------------------------------
+
+/*
+ * Demo responses are stamped with the current time and are cheap to
+ * build, so only real data goes through the response cache.
+ */
+static int cacheable(enum market_data_source src)
+{
+    return src != MARKET_SOURCE_DEMO;
+}
+
+/*
+ * Send the stored variant of `entry` that the request accepts.
+ */
+static void send_variant(struct mg_connection *conn,
+                         const struct response_cache_entry *entry)
+{
+    const struct response_variant *v = response_cache_select(
+        entry, mg_get_header(conn, "Accept-Encoding"));
+
+    send_prepared_json_response(conn, v->wire, v->wire_len,
+                                v->body_len, v->etag);
+}
+
+/*
+ * Send `json`, storing a copy under `key` when the response is
+ * cacheable.
+ */
+static void send_and_cache(struct mg_connection *conn,
+                           const char *key,
+                           const char *json,
+                           size_t json_len)
+{
+    if (key) {
+        struct response_cache_entry *entry =
+            response_cache_put(key, json, json_len);
+
+        if (entry) {
+            send_variant(conn, entry);
+            response_cache_release(entry);
+        } else {
+            send_json_error(conn, 500, "memory allocation failed");
+        }
+        return;
+    }
+
+    send_json_response_etag(conn, 200, json, json_len, NULL);
+}
+
+static int send_cached(struct mg_connection *conn, const char *key)
+{
+    struct response_cache_entry *hit = response_cache_get(key);
+    if (!hit)
+        return 0;
+
+    send_variant(conn, hit);
+    response_cache_release(hit);
+    return 1;
+}
+
+/*
+ * Prefix a built document `{...}` (NULL sends an empty series) with
+ * its source and fetchedAt, then send it.
+ */
+static void send_with_meta(struct mg_connection *conn,
+                           const char *key,
+                           const char *doc,
+                           const char *source_str,
+                           time_t fetched_at)
+{
+    const char *inner = doc;
+
+    if (inner && inner[0] == '{')
+        inner++;
+
+    size_t needed = strlen(inner ? inner : "\"series\":[]}")
+                    + 256;
+
+    char *json = arena_alloc(needed);
+    if (!json) {
+        send_json_error(conn, 500, "memory allocation failed");
+        return;
+    }
+
+    int len = snprintf(json, needed,
+        "{"
+          "\"source\":\"%s\","
+          "\"fetchedAt\":%lld,"
+          "%s",
+        source_str,
+        (long long)fetched_at,
+        inner ? inner : "\"series\":[]}"
+    );
+
+    send_and_cache(conn, key, json, (size_t)len);
+}
+
+
+// ------------------------------------------------------------
+// Helper: history documents
+// ------------------------------------------------------------
+
+static size_t stream_min;
+static pthread_once_t stream_min_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Default: one past the longest series the cache keeps, i.e. off.
+ * Streaming gives up the ETag, the response cache and the compressed
+ * variants, so it only applies to deployments that opt in.
+ */
+static void read_stream_min(void)
+{
+    stream_min = history_cache_max_points() + 1;
+
+    const char *v = getenv("HISTORY_STREAM_MIN_POINTS");
+    if (v && strlen(v) > 0) {
+        long n = strtol(v, NULL, 10);
+        if (n > 0)
+            stream_min = (size_t)n;
+    }
+}
+
+/*
+ * Histories with at least this many points are streamed rather than
+ * assembled and cached.
+ */
+static size_t stream_min_points(void)
+{
+    pthread_once(&stream_min_once, read_stream_min);
+    return stream_min;
+}
+
+/*
+ * Write the history document with its metadata straight into one
+ * buffer and send it, storing it under `key` when cacheable.
+ */
+static void send_history(struct mg_connection *conn,
+                         const char *key,
+                         const struct market_series *series,
+                         int days,
+                         const int *windows,
+                         size_t window_count,
+                         const char *source_str,
+                         time_t fetched_at)
+{
+    struct json_sink out;
+    json_sink_init_arena(&out, 256 + (series ? series->count : 0) * 48);
+
+    if (market_write_history(&out, series, days, windows, window_count,
+                             source_str, (long long)fetched_at) != 0) {
+        // A document that failed to build goes out as an empty series
+        json_sink_init_arena(&out, 256);
+        market_write_history(&out, NULL, 0, NULL, 0,
+                             source_str, (long long)fetched_at);
+    }
+
+    if (json_sink_finish(&out) != 0) {
+        send_json_error(conn, 500, "memory allocation failed");
+        return;
+    }
+
+    send_and_cache(conn, key, out.buf, out.len);
+}
+
+/*
+ * Send the history document as it is written, a chunk at a time:
+ * first byte and memory use do not grow with the series.
+ */
+static void stream_history(struct mg_connection *conn,
+                           const struct market_series *series,
+                           int days,
+                           const int *windows,
+                           size_t window_count,
+                           const char *source_str,
+                           time_t fetched_at)
+{
+    struct chunked_response r;
+
+    if (chunked_response_begin(&r, conn, 200) != 0) {
+        send_json_error(conn, 500, "memory allocation failed");
+        return;
+    }
+
+    market_write_history(&r.sink, series, days, windows, window_count,
+                         source_str, (long long)fetched_at);
+    chunked_response_end(&r);
+}
+
+
 int market_quote_controller(struct mg_connection *conn,
                             const char *symbol)
 {
+    enum market_data_source source;
+    time_t fetched_at;
     struct stock_quote q;
 
-    if (market_service_get_quote(symbol, &q) != 0) {
-        memset(&q, 0, sizeof(q));
-        strncpy(q.symbol, symbol, sizeof(q.symbol) - 1);
-    }
+    market_service_acquire_quote(symbol, &q, &source, &fetched_at);
 
-    char json[512];
+    char key[96];
+    snprintf(key, sizeof(key), "quote|%s|%s|%lld",
+             symbol, source_to_string(source), (long long)fetched_at);
+
+    int use_cache = cacheable(source);
 
-    snprintf(json, sizeof(json),
+    if (use_cache && send_cached(conn, key))
+        return 1;
+
+    char json[512];
+    int len = snprintf(json, sizeof(json),
         "{"
           "\"symbol\":\"%s\","
           "\"price\":%.2f,"
@@ -47,46 +258,402 @@ int market_quote_controller(struct mg_connection *conn,
         q.change_percent
     );
 
-    send_json_response(conn, 200, json);
+    send_and_cache(conn, use_cache ? key : NULL, json, (size_t)len);
     return 1;
 }
 
 
 int market_history_controller(struct mg_connection *conn,
                               const char *symbol,
-                              int days)
+                              int days,
+                              const int *windows,
+                              size_t window_count)
 {
-    struct market_history_result res =
-        market_service_get_history(symbol, days);
+    enum market_data_source source;
+    time_t fetched_at;
 
-    const char *source_str = source_to_string(res.source);
+    struct market_series *series =
+        market_service_acquire_history(symbol, &source, &fetched_at);
 
-    const char *inner = res.json;
+    // Windows past the end of the series all produce the full series
+    size_t window = series ? series->count : 0;
+    if (days > 0 && (size_t)days < window)
+        window = (size_t)days;
 
-    if (inner && inner[0] == '{')
-        inner++;
+    const char *source_str = source_to_string(source);
 
-    size_t needed = strlen(inner ? inner : "\"series\":[]}")
-                    + 256;
+    // Metric windows are keyed as requested, since they label the output
+    char windows_str[64] = "";
+    size_t pos = 0;
+    for (size_t i = 0; i < window_count && pos < sizeof(windows_str); i++)
+        pos += (size_t)snprintf(windows_str + pos, sizeof(windows_str) - pos,
+                                "%s%d", i ? "," : "", windows[i]);
 
-    char *json = malloc(needed);
-    if (!json) {
+    char key[160];
+    snprintf(key, sizeof(key), "history|%s|%zu|%s|%s|%lld",
+             symbol, window, windows_str, source_str, (long long)fetched_at);
+
+    int use_cache = cacheable(source);
+
+    // Streamed histories are never stored, so there is nothing to find
+    if (use_cache && window < stream_min_points() && send_cached(conn, key)) {
+        market_series_release(series);
+        return 1;
+    }
+
+    if (window >= stream_min_points())
+        stream_history(conn, series, days, windows, window_count,
+                       source_str, fetched_at);
+    else
+        send_history(conn, use_cache ? key : NULL, series, days,
+                     windows, window_count, source_str, fetched_at);
+
+    market_series_release(series);
+    return 1;
+}
+
+
+/*
+ * Header source codes of the columnar format.
+ */
+static uint8_t source_to_code(enum market_data_source src)
+{
+    switch (src) {
+        case MARKET_SOURCE_LIVE:  return 0;
+        case MARKET_SOURCE_CACHE: return 1;
+        default:                  return 2;
+    }
+}
+
+// FNV-1a
+static unsigned long long hash_key(const char *key)
+{
+    unsigned long long h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int market_history_columnar_controller(struct mg_connection *conn,
+                                       const char *symbol,
+                                       int days,
+                                       const int *windows,
+                                       size_t window_count,
+                                       int decimals)
+{
+    enum market_data_source source;
+    time_t fetched_at;
+
+    struct market_series *series =
+        market_service_acquire_history(symbol, &source, &fetched_at);
+
+    size_t window = series ? series->count : 0;
+    if (days > 0 && (size_t)days < window)
+        window = (size_t)days;
+
+    size_t len = 0;
+    void *body = market_build_history_columnar(
+        series, days, windows, window_count, decimals,
+        source_to_code(source), (long long)fetched_at, &len);
+
+    market_series_release(series);
+
+    if (!body) {
         send_json_error(conn, 500, "memory allocation failed");
         return 1;
     }
 
-    snprintf(json, needed,
-        "{"
-          "\"source\":\"%s\","
-          "\"fetchedAt\":%lld,"
-          "%s",
-        source_str,
-        (long long)res.fetched_at,
-        inner ? inner : "\"series\":[]}"
-    );
+    // Encoded from the shared series on every request, so it is not
+    // stored; the ETag comes from what the bytes depend on instead
+    char etag[32];
+    int has_etag = cacheable(source);
 
-    send_json_response(conn, 200, json);
+    if (has_etag) {
+        char key[192];
+        size_t pos = (size_t)snprintf(key, sizeof(key),
+            "history-bin|%s|%zu|%d|%s|%lld|",
+            symbol, window, decimals, source_to_string(source),
+            (long long)fetched_at);
+
+        for (size_t i = 0; i < window_count && pos < sizeof(key); i++)
+            pos += (size_t)snprintf(key + pos, sizeof(key) - pos,
+                                    "%s%d", i ? "," : "", windows[i]);
+
+        snprintf(etag, sizeof(etag), "\"%016llx-bin\"", hash_key(key));
+    }
 
-    free(json);
+    send_typed_response_etag(conn, 200, MARKET_COLUMNAR_CONTENT_TYPE,
+                             body, len, has_etag ? etag : NULL);
     return 1;
-}
\ No newline at end of file
+}
+
+
+int market_rolling_controller(struct mg_connection *conn,
+                              const char *symbol,
+                              int days,
+                              size_t window,
+                              unsigned stats)
+{
+    enum market_data_source source;
+    time_t fetched_at;
+
+    struct market_series *series =
+        market_service_acquire_history(symbol, &source, &fetched_at);
+
+    size_t points = series ? series->count : 0;
+    if (days > 0 && (size_t)days < points)
+        points = (size_t)days;
+
+    // Not an empty series: the client asked for more than there is.
+    // `days` only trims the output; windows reach back before it
+    size_t available = series ? series->count : 0;
+    if (window > available) {
+        market_series_release(series);
+
+        char msg[96];
+        snprintf(msg, sizeof(msg),
+                 "window is longer than the available history (%zu points)",
+                 available);
+        send_json_error(conn, 400, msg);
+        return 1;
+    }
+
+    const char *source_str = source_to_string(source);
+
+    char key[160];
+    snprintf(key, sizeof(key), "rolling|%s|%zu|%zu|%u|%s|%lld",
+             symbol, points, window, stats, source_str,
+             (long long)fetched_at);
+
+    int use_cache = cacheable(source);
+
+    if (use_cache && send_cached(conn, key)) {
+        market_series_release(series);
+        return 1;
+    }
+
+    char *rolling = market_build_rolling_json(series, days, window, stats);
+    market_series_release(series);
+
+    send_with_meta(conn, use_cache ? key : NULL,
+                   rolling, source_str, fetched_at);
+    return 1;
+}
+
+
+int market_quotes_controller(struct mg_connection *conn,
+                             const char *const *symbols,
+                             size_t count)
+{
+    struct market_series **series = arena_calloc(count, sizeof(*series));
+    enum market_data_source *sources = arena_calloc(count, sizeof(*sources));
+    time_t *fetched_at = arena_calloc(count, sizeof(*fetched_at));
+
+    // Typical entry size; grown below for outsized prices
+    size_t cap = 2 + count * 128;
+    char *json = arena_alloc(cap);
+
+    if (!series || !sources || !fetched_at || !json) {
+        send_json_error(conn, 500, "memory allocation failed");
+        return 1;
+    }
+
+    market_service_acquire_histories(symbols, count,
+                                     series, sources, fetched_at);
+
+    size_t len = 0;
+    json[len++] = '[';
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+        struct stock_quote q;
+
+        if (market_service_quote_from_series(series[i], symbols[i], &q) != 0) {
+            memset(&q, 0, sizeof(q));
+            strncpy(q.symbol, symbols[i], sizeof(q.symbol) - 1);
+        }
+
+        market_series_release(series[i]);
+
+        char entry[QUOTE_ENTRY_MAX];
+        int n = snprintf(entry, sizeof(entry),
+            "%s{"
+              "\"symbol\":\"%s\","
+              "\"price\":%.2f,"
+              "\"change\":%.2f,"
+              "\"changePercent\":%.2f,"
+              "\"source\":\"%s\","
+              "\"fetchedAt\":%lld"
+            "}",
+            len > 1 ? "," : "",
+            q.symbol,
+            q.price,
+            q.change,
+            q.change_percent,
+            source_to_string(sources[i]),
+            (long long)fetched_at[i]
+        );
+
+        if (n < 0 || (size_t)n >= sizeof(entry))
+            break;
+
+        // Keep room for the closing bracket and terminator
+        if (len + (size_t)n + 2 > cap) {
+            size_t new_cap = (len + (size_t)n + 2) * 2;
+            char *grown = arena_realloc(json, cap, new_cap);
+            if (!grown)
+                break;
+            json = grown;
+            cap = new_cap;
+        }
+
+        memcpy(json + len, entry, (size_t)n);
+        len += (size_t)n;
+    }
+
+    // Never answer with symbols silently missing
+    if (i < count) {
+        while (++i < count)
+            market_series_release(series[i]);
+        send_json_error(conn, 500, "memory allocation failed");
+        return 1;
+    }
+
+    json[len++] = ']';
+    json[len] = '\0';
+
+    send_and_cache(conn, NULL, json, len);
+    return 1;
+}
+
+
+int market_correlation_controller(struct mg_connection *conn,
+                                  const char *const *symbols,
+                                  size_t count,
+                                  int days,
+                                  int covariance)
+{
+    struct market_series **series = arena_calloc(count, sizeof(*series));
+    enum market_data_source *sources = arena_calloc(count, sizeof(*sources));
+    time_t *fetched_at = arena_calloc(count, sizeof(*fetched_at));
+    const char **source_strs = arena_calloc(count, sizeof(*source_strs));
+    double *packed = arena_alloc(MARKET_PACKED_SIZE(count) * sizeof(*packed));
+
+    char *json = NULL;
+    size_t points = 0;
+    int too_short = 0;
+
+    if (series && sources && fetched_at && source_strs && packed) {
+        market_service_acquire_histories(symbols, count,
+                                         series, sources, fetched_at);
+
+        for (size_t i = 0; i < count; i++)
+            source_strs[i] = source_to_string(sources[i]);
+
+        int rc = market_correlation_matrix(
+            (const struct market_series *const *)series, count,
+            days > 0 ? (size_t)days : 0, !covariance, packed, &points);
+
+        // Not computed over whatever there is: the client asked for
+        // more dates than the series share
+        if (rc == 0 && days > 0 && points < (size_t)days) {
+            too_short = 1;
+        } else if (rc == 0) {
+            json = market_build_correlation_json(
+                symbols, source_strs, count, points,
+                covariance ? "covariance" : "correlation", packed);
+        }
+
+        for (size_t i = 0; i < count; i++)
+            market_series_release(series[i]);
+    }
+
+    if (too_short) {
+        char msg[96];
+        snprintf(msg, sizeof(msg),
+                 "days is longer than the common history (%zu dates)",
+                 points);
+        send_json_error(conn, 400, msg);
+        return 1;
+    }
+
+    if (!json) {
+        send_json_error(conn, 500, "failed to compute correlation");
+        return 1;
+    }
+
+    send_and_cache(conn, NULL, json, strlen(json));
+    return 1;
+}
+
+
+int market_portfolio_controller(struct mg_connection *conn,
+                                const char *const *symbols,
+                                const double *weights,
+                                size_t count,
+                                int days)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++)
+        total += weights[i];
+
+    if (!(total > 0.0)) {
+        send_json_error(conn, 400, "weights must sum to a positive number");
+        return 1;
+    }
+
+    struct market_series **series = arena_calloc(count, sizeof(*series));
+    enum market_data_source *sources = arena_calloc(count, sizeof(*sources));
+    time_t *fetched_at = arena_calloc(count, sizeof(*fetched_at));
+    const char **source_strs = arena_calloc(count, sizeof(*source_strs));
+
+    char *json = NULL;
+    size_t points = 0;
+    int too_short = 0;
+
+    if (series && sources && fetched_at && source_strs) {
+        market_service_acquire_histories(symbols, count,
+                                         series, sources, fetched_at);
+
+        for (size_t i = 0; i < count; i++)
+            source_strs[i] = source_to_string(sources[i]);
+
+        struct market_series *portfolio = market_portfolio_series(
+            "portfolio", (const struct market_series *const *)series,
+            weights, count, days > 0 ? (size_t)days : 0);
+
+        // As for correlation: no value series over fewer dates than
+        // were asked for
+        if (portfolio) {
+            points = portfolio->count;
+            if (days > 0 && points < (size_t)days)
+                too_short = 1;
+            else
+                json = market_build_portfolio_json(
+                    portfolio, symbols, weights, source_strs, count);
+            market_series_release(portfolio);
+        }
+
+        for (size_t i = 0; i < count; i++)
+            market_series_release(series[i]);
+    }
+
+    if (too_short) {
+        char msg[96];
+        snprintf(msg, sizeof(msg),
+                 "days is longer than the common history (%zu dates)",
+                 points);
+        send_json_error(conn, 400, msg);
+        return 1;
+    }
+
+    if (!json) {
+        send_json_error(conn, 500, "failed to build portfolio");
+        return 1;
+    }
+
+    send_and_cache(conn, NULL, json, strlen(json));
+    return 1;
+}
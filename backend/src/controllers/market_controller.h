@@ -1,6 +1,8 @@
 #ifndef STOCKC_MARKET_CONTROLLER_H
 #define STOCKC_MARKET_CONTROLLER_H
 
+#include <stddef.h>
+
 #include "civetweb.h"
 
 /*
@@ -12,8 +14,62 @@
 int market_quote_controller(struct mg_connection *conn,
                             const char *symbol);
 
+/*
+ * History for `symbol`. With windows (window_count > 0) the metrics
+ * block holds one entry per trailing window.
+ */
 int market_history_controller(struct mg_connection *conn,
-                            const char *symbol,
-                            int days);
+                              const char *symbol,
+                              int days,
+                              const int *windows,
+                              size_t window_count);
+
+/*
+ * History for `symbol` in the columnar binary format
+ * (stockc/market_history_columnar.h); `decimals` > 0 asks for
+ * fixed-point prices.
+ */
+int market_history_columnar_controller(struct mg_connection *conn,
+                                       const char *symbol,
+                                       int days,
+                                       const int *windows,
+                                       size_t window_count,
+                                       int decimals);
+
+/*
+ * Rolling statistics (MARKET_ROLLING_* flags in `stats`).
+ */
+int market_rolling_controller(struct mg_connection *conn,
+                              const char *symbol,
+                              int days,
+                              size_t window,
+                              unsigned stats);
+
+/*
+ * Pairwise return correlation (or covariance) across `symbols` over
+ * the trailing `days` common dates (0 = all).
+ */
+int market_correlation_controller(struct mg_connection *conn,
+                                  const char *const *symbols,
+                                  size_t count,
+                                  int days,
+                                  int covariance);
+
+/*
+ * Buy-and-hold portfolio of `symbols` with `weights` (normalized by
+ * their sum) over the trailing `days` common dates (0 = all).
+ */
+int market_portfolio_controller(struct mg_connection *conn,
+                                const char *const *symbols,
+                                const double *weights,
+                                size_t count,
+                                int days);
+
+/*
+ * Batch quotes: one JSON array with an entry per symbol, in order.
+ */
+int market_quotes_controller(struct mg_connection *conn,
+                             const char *const *symbols,
+                             size_t count);
 
 #endif
@@ -0,0 +1,320 @@
+#include "content_coding.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <zlib.h>
+
+#ifdef STOCKC_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#define RESPONSE_GZIP_LEVEL 6
+#define RESPONSE_BROTLI_QUALITY 5
+#define RESPONSE_COMPRESS_MIN_BYTES 256
+
+#define GZIP_HEADER_BYTES 10
+#define GZIP_TRAILER_BYTES 8    // CRC-32, input size
+#define ZLIB_HEADER_BYTES 2
+#define ZLIB_TRAILER_BYTES 4    // Adler-32
+
+static long gzip_level;
+static long brotli_quality;
+static size_t min_bytes;
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+/*
+ * Like env_long elsewhere, but 0 is a valid setting (off) and values
+ * above `max` are clamped.
+ */
+static long env_level(const char *name, long fallback, long max)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    char *end = NULL;
+    long n = strtol(v, &end, 10);
+    if (end == v || n < 0)
+        return fallback;
+
+    return n > max ? max : n;
+}
+
+static void init_codings(void)
+{
+    gzip_level = env_level("RESPONSE_GZIP_LEVEL", RESPONSE_GZIP_LEVEL, 9);
+    brotli_quality = env_level("RESPONSE_BROTLI_QUALITY",
+                               RESPONSE_BROTLI_QUALITY, 11);
+    min_bytes = (size_t)env_level("RESPONSE_COMPRESS_MIN_BYTES",
+                                  RESPONSE_COMPRESS_MIN_BYTES, LONG_MAX);
+}
+
+static void put_le32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void put_be32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+/*
+ * Compress `body` once as raw DEFLATE, straight into a gzip frame,
+ * then rewrap a copy of the stream as zlib for "deflate".
+ */
+static void encode_deflate(const char *body,
+                           size_t len,
+                           struct content_encodings *out)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+
+    if (deflateInit2(&zs, (int)gzip_level, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return;
+
+    size_t bound = deflateBound(&zs, (uLong)len);
+    unsigned char *gz = malloc(GZIP_HEADER_BYTES + bound + GZIP_TRAILER_BYTES);
+    if (!gz) {
+        deflateEnd(&zs);
+        return;
+    }
+
+    zs.next_in = (Bytef *)body;
+    zs.avail_in = (uInt)len;
+    zs.next_out = gz + GZIP_HEADER_BYTES;
+    zs.avail_out = (uInt)bound;
+
+    int rc = deflate(&zs, Z_FINISH);
+    size_t raw_len = zs.total_out;
+    deflateEnd(&zs);
+
+    size_t gz_len = GZIP_HEADER_BYTES + raw_len + GZIP_TRAILER_BYTES;
+    if (rc != Z_STREAM_END || gz_len >= len) {
+        free(gz);
+        return;
+    }
+
+    // RFC 1952 header: no name or mtime, Unix
+    static const unsigned char gzip_header[GZIP_HEADER_BYTES] = {
+        0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3
+    };
+    memcpy(gz, gzip_header, GZIP_HEADER_BYTES);
+    gz[8] = gzip_level == 9 ? 2 : gzip_level == 1 ? 4 : 0;
+    put_le32(gz + GZIP_HEADER_BYTES + raw_len,
+             (uint32_t)crc32_z(0, (const Bytef *)body, len));
+    put_le32(gz + GZIP_HEADER_BYTES + raw_len + 4, (uint32_t)len);
+
+    out->data[CONTENT_CODING_GZIP] = (char *)gz;
+    out->len[CONTENT_CODING_GZIP] = gz_len;
+
+    size_t zl_len = ZLIB_HEADER_BYTES + raw_len + ZLIB_TRAILER_BYTES;
+    unsigned char *zl = malloc(zl_len);
+    if (!zl)
+        return;
+
+    // RFC 1950 header: 32 KiB window, level hint as zlib writes it
+    unsigned flevel = gzip_level < 2 ? 0 : gzip_level < 6 ? 1
+                    : gzip_level == 6 ? 2 : 3;
+    unsigned header = (0x78u << 8) | (flevel << 6);
+    header += 31 - header % 31;
+
+    zl[0] = (unsigned char)(header >> 8);
+    zl[1] = (unsigned char)header;
+    memcpy(zl + ZLIB_HEADER_BYTES, gz + GZIP_HEADER_BYTES, raw_len);
+    put_be32(zl + ZLIB_HEADER_BYTES + raw_len,
+             (uint32_t)adler32_z(1, (const Bytef *)body, len));
+
+    out->data[CONTENT_CODING_DEFLATE] = (char *)zl;
+    out->len[CONTENT_CODING_DEFLATE] = zl_len;
+}
+
+#ifdef STOCKC_HAVE_BROTLI
+static void encode_brotli(const char *body,
+                          size_t len,
+                          struct content_encodings *out)
+{
+    size_t cap = BrotliEncoderMaxCompressedSize(len);
+    char *br = cap ? malloc(cap) : NULL;
+    if (!br)
+        return;
+
+    size_t br_len = cap;
+    if (!BrotliEncoderCompress((int)brotli_quality, BROTLI_DEFAULT_WINDOW,
+                               BROTLI_MODE_TEXT, len,
+                               (const uint8_t *)body,
+                               &br_len, (uint8_t *)br) ||
+        br_len >= len) {
+        free(br);
+        return;
+    }
+
+    out->data[CONTENT_CODING_BR] = br;
+    out->len[CONTENT_CODING_BR] = br_len;
+}
+#endif
+
+/*
+ * qvalue in thousandths ("0.8" -> 800), or -1 if malformed.
+ */
+static int parse_qvalue(const char *p, const char *end)
+{
+    if (p >= end || (*p != '0' && *p != '1'))
+        return -1;
+
+    int q = (*p++ - '0') * 1000;
+    if (p < end && *p == '.') {
+        p++;
+        for (int scale = 100; p < end && *p >= '0' && *p <= '9'; p++) {
+            q += (*p - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    return q > 1000 ? 1000 : q;
+}
+
+static int token_is(const char *p, size_t len, const char *name)
+{
+    return strlen(name) == len && strncasecmp(p, name, len) == 0;
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+const char *content_coding_name(enum content_coding coding)
+{
+    switch (coding) {
+    case CONTENT_CODING_GZIP:    return "gzip";
+    case CONTENT_CODING_DEFLATE: return "deflate";
+    case CONTENT_CODING_BR:      return "br";
+    default:                     return NULL;
+    }
+}
+
+void content_coding_encode(const char *body,
+                           size_t len,
+                           struct content_encodings *out)
+{
+    memset(out, 0, sizeof(*out));
+    pthread_once(&init_once, init_codings);
+
+    if (!body || len < min_bytes || len > UINT32_MAX)
+        return;
+
+    if (gzip_level > 0)
+        encode_deflate(body, len, out);
+
+#ifdef STOCKC_HAVE_BROTLI
+    if (brotli_quality > 0)
+        encode_brotli(body, len, out);
+#endif
+}
+
+void content_coding_free(struct content_encodings *enc)
+{
+    for (size_t i = 0; i < CONTENT_CODING_COUNT; i++) {
+        free(enc->data[i]);
+        enc->data[i] = NULL;
+        enc->len[i] = 0;
+    }
+}
+
+enum content_coding content_coding_negotiate(const char *accept_encoding,
+                                             const size_t *len)
+{
+    if (!accept_encoding)
+        return CONTENT_CODING_IDENTITY;
+
+    int listed[CONTENT_CODING_COUNT];
+    int star = -1;
+    for (size_t i = 0; i < CONTENT_CODING_COUNT; i++)
+        listed[i] = -1;
+
+    const char *p = accept_encoding;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+
+        const char *name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t')
+            p++;
+        size_t name_len = (size_t)(p - name);
+
+        const char *elem_end = strchr(p, ',');
+        if (!elem_end)
+            elem_end = p + strlen(p);
+
+        // Only the q parameter matters
+        int q = 1000;
+        const char *param = memchr(p, ';', (size_t)(elem_end - p));
+        while (param) {
+            param++;
+            while (param < elem_end && (*param == ' ' || *param == '\t'))
+                param++;
+            if (elem_end - param >= 2 &&
+                (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = parse_qvalue(param + 2, elem_end);
+                break;
+            }
+            param = memchr(param, ';', (size_t)(elem_end - param));
+        }
+
+        if (name_len > 0 && q >= 0) {
+            if (token_is(name, name_len, "*"))
+                star = q;
+            else if (token_is(name, name_len, "identity"))
+                listed[CONTENT_CODING_IDENTITY] = q;
+            else if (token_is(name, name_len, "gzip") ||
+                     token_is(name, name_len, "x-gzip"))
+                listed[CONTENT_CODING_GZIP] = q;
+            else if (token_is(name, name_len, "deflate"))
+                listed[CONTENT_CODING_DEFLATE] = q;
+            else if (token_is(name, name_len, "br"))
+                listed[CONTENT_CODING_BR] = q;
+        }
+
+        p = elem_end;
+    }
+
+    enum content_coding best = CONTENT_CODING_IDENTITY;
+    int best_q = 0;
+
+    for (size_t i = 0; i < CONTENT_CODING_COUNT; i++) {
+        if (len[i] == 0 && i != CONTENT_CODING_IDENTITY)
+            continue;
+
+        int q = listed[i] >= 0 ? listed[i] : star >= 0 ? star : 0;
+
+        // Unlisted identity stays acceptable, below anything named
+        if (i == CONTENT_CODING_IDENTITY && listed[i] < 0 && star != 0)
+            q = 1;
+
+        if (q > best_q || (q == best_q && q > 0 && len[i] < len[best])) {
+            best = (enum content_coding)i;
+            best_q = q;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,64 @@
+#ifndef STOCKC_HTTP_CONTENT_CODING_H
+#define STOCKC_HTTP_CONTENT_CODING_H
+
+#include <stddef.h>
+
+/*
+ * Content codings for cached responses.
+ *
+ * Bodies are compressed once, when a response is stored, into every
+ * coding the build supports; requests only pick one of the stored
+ * variants by their Accept-Encoding. gzip and deflate share a single
+ * compression pass (same DEFLATE stream, different wrapper). br is
+ * available when the build found libbrotlienc.
+ *
+ * Configuration (read once, on first use):
+ *   RESPONSE_GZIP_LEVEL           gzip/deflate level 1-9, 0 = off (default 6)
+ *   RESPONSE_BROTLI_QUALITY       brotli quality 1-11, 0 = off  (default 5)
+ *   RESPONSE_COMPRESS_MIN_BYTES   smaller bodies are sent as-is (default 256)
+ */
+
+enum content_coding {
+    CONTENT_CODING_IDENTITY,
+    CONTENT_CODING_GZIP,
+    CONTENT_CODING_DEFLATE,
+    CONTENT_CODING_BR,
+    CONTENT_CODING_COUNT
+};
+
+/*
+ * Encoded forms of one body. Codings that are disabled, unsupported or
+ * would not make the body smaller have data NULL and len 0; identity
+ * is always absent (it is the body itself).
+ */
+struct content_encodings {
+    char *data[CONTENT_CODING_COUNT];
+    size_t len[CONTENT_CODING_COUNT];
+};
+
+/*
+ * Content-Encoding token for `coding`; NULL for identity.
+ */
+const char *content_coding_name(enum content_coding coding);
+
+/*
+ * Compress `body` into every enabled coding. Buffers are malloc'd;
+ * release them with content_coding_free.
+ */
+void content_coding_encode(const char *body,
+                           size_t len,
+                           struct content_encodings *out);
+
+void content_coding_free(struct content_encodings *enc);
+
+/*
+ * Pick the variant to send for an Accept-Encoding header (may be
+ * NULL). `len[c]` is the size of coding c's body, 0 if there is none;
+ * identity is always available. The highest q-value wins and ties go
+ * to the smaller body; identity is the fallback when no stored coding
+ * is acceptable.
+ */
+enum content_coding content_coding_negotiate(const char *accept_encoding,
+                                             const size_t *len);
+
+#endif /* STOCKC_HTTP_CONTENT_CODING_H */
@@ -1,6 +1,22 @@
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "cors.h"
+#include "../telemetry/telemetry.h"
+
+#define DEFAULT_ORIGIN "http://localhost:5173"
+
+/*
+ * Header lines and the full preflight response, formatted once. The
+ * origin cannot change while the process runs.
+ */
+static char header_block[640];
+static size_t header_block_len;
+static char preflight[768];
+static size_t preflight_len;
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
 
 /*
  * Returns the allowed origin.
@@ -11,23 +27,52 @@ static const char *get_allowed_origin(void)
 {
     const char *env_origin = getenv("CORS_ALLOWED_ORIGIN");
 
-    if (env_origin && strlen(env_origin) > 0)
-        return env_origin;
+    if (env_origin && strlen(env_origin) > 0) {
+        // Leave room in the header block for the fixed lines
+        if (strlen(env_origin) < 512)
+            return env_origin;
+
+        fprintf(stderr, "CORS_ALLOWED_ORIGIN is too long; using %s\n",
+                DEFAULT_ORIGIN);
+    }
 
     // Local development fallback
-    return "http://localhost:5173";
+    return DEFAULT_ORIGIN;
 }
 
-void add_cors_headers(struct mg_connection *conn)
+static void build_headers(void)
 {
     const char *origin = get_allowed_origin();
 
-    mg_printf(conn,
+    header_block_len = (size_t)snprintf(header_block, sizeof(header_block),
         "Access-Control-Allow-Origin: %s\r\n"
         "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
         "Access-Control-Allow-Headers: Content-Type\r\n",
         origin
     );
+
+    preflight_len = (size_t)snprintf(preflight, sizeof(preflight),
+        "HTTP/1.1 204 No Content\r\n"
+        "%s"
+        "Access-Control-Max-Age: 86400\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n",
+        header_block
+    );
+}
+
+void cors_init(void)
+{
+    pthread_once(&init_once, build_headers);
+}
+
+const char *cors_headers(size_t *len)
+{
+    cors_init();
+
+    if (len)
+        *len = header_block_len;
+    return header_block;
 }
 
 int handle_options_preflight(struct mg_connection *conn,
@@ -36,17 +81,10 @@ int handle_options_preflight(struct mg_connection *conn,
     if (strcmp(req->request_method, "OPTIONS") != 0)
         return 0;
 
-    const char *origin = get_allowed_origin();
+    cors_init();
 
-    mg_printf(conn,
-        "HTTP/1.1 204 No Content\r\n"
-        "Access-Control-Allow-Origin: %s\r\n"
-        "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
-        "Access-Control-Allow-Headers: Content-Type\r\n"
-        "Content-Length: 0\r\n"
-        "\r\n",
-        origin
-    );
+    telemetry_set_status(204);
+    mg_write(conn, preflight, preflight_len);
 
     return 1;
-}
\ No newline at end of file
+}
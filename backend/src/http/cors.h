@@ -1,13 +1,26 @@
 #ifndef STOCKC_HTTP_CORS_H
 #define STOCKC_HTTP_CORS_H
 
+#include <stddef.h>
+
 #include "civetweb.h"
 
 /*
  * CORS utilities
  */
 
-void add_cors_headers(struct mg_connection *conn);
+/*
+ * Resolve the allowed origin (CORS_ALLOWED_ORIGIN) and format the CORS
+ * header lines. Safe to call more than once; the other functions also
+ * initialize lazily.
+ */
+void cors_init(void);
+
+/*
+ * The CORS header lines, each ending in CRLF. *len (if non-NULL)
+ * receives their length.
+ */
+const char *cors_headers(size_t *len);
 
 /*
  * Handles OPTIONS preflight requests.
@@ -16,4 +29,4 @@ void add_cors_headers(struct mg_connection *conn);
 int handle_options_preflight(struct mg_connection *conn,
                              const struct mg_request_info *req);
 
-#endif
\ No newline at end of file
+#endif
@@ -2,11 +2,14 @@
 #include <string.h>
 #include "responses.h"
 #include "cors.h"
+#include "../memory/arena.h"
+#include "../telemetry/telemetry.h"
 
 static const char *status_text(int status_code)
 {
     switch (status_code) {
         case 200: return "OK";
+        case 304: return "Not Modified";
         case 400: return "Bad Request";
         case 404: return "Not Found";
         case 500: return "Internal Server Error";
@@ -14,25 +17,343 @@ static const char *status_text(int status_code)
     }
 }
 
-void send_json_response(struct mg_connection *conn,
+/*
+ * If-None-Match is a comma-separated list of (possibly weak) ETags,
+ * or "*".
+ */
+static int etag_matches(const char *if_none_match, const char *etag)
+{
+    if (!if_none_match || !etag)
+        return 0;
+
+    size_t etag_len = strlen(etag);
+    const char *p = if_none_match;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+
+        if (*p == '*')
+            return 1;
+
+        if (strncmp(p, "W/", 2) == 0)
+            p += 2;
+
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t'))
+            len--;
+
+        if (len == etag_len && strncmp(p, etag, len) == 0)
+            return 1;
+
+        if (!end)
+            break;
+        p = end;
+    }
+
+    return 0;
+}
+
+/*
+ * Small responses are assembled on the stack; anything larger in the
+ * request arena, which still costs less than a second write.
+ */
+#define ASSEMBLE_STACK_BYTES 8192
+
+/*
+ * Send `head` and `body` with one mg_write.
+ */
+static void send_assembled(struct mg_connection *conn,
+                           const char *head,
+                           size_t head_len,
+                           const char *body,
+                           size_t body_len)
+{
+    char stack_buf[ASSEMBLE_STACK_BYTES];
+    size_t total = head_len + body_len;
+    struct arena_mark mark = arena_mark();
+    char *buf = total <= sizeof(stack_buf) ? stack_buf : arena_alloc(total);
+
+    if (!buf) {
+        mg_write(conn, head, head_len);
+        mg_write(conn, body, body_len);
+        return;
+    }
+
+    memcpy(buf, head, head_len);
+    if (body_len > 0)
+        memcpy(buf + head_len, body, body_len);
+
+    mg_write(conn, buf, total);
+    arena_rewind(mark);
+}
+
+/*
+ * Returns 1 if a 304 was sent for `etag`.
+ */
+static int send_not_modified(struct mg_connection *conn, const char *etag)
+{
+    if (!etag ||
+        !etag_matches(mg_get_header(conn, "If-None-Match"), etag))
+        return 0;
+
+    size_t cors_len = 0;
+    const char *cors = cors_headers(&cors_len);
+
+    char head[RESPONSE_HEAD_MAX];
+    int n = snprintf(head, sizeof(head),
+        "HTTP/1.1 304 %s\r\n"
+        "ETag: %s\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Vary: Accept, Accept-Encoding\r\n"
+        "%.*s"
+        "\r\n",
+        status_text(304),
+        etag,
+        (int)cors_len, cors
+    );
+
+    telemetry_set_status(304);
+    if (n > 0 && (size_t)n < sizeof(head))
+        mg_write(conn, head, (size_t)n);
+
+    return 1;
+}
+
+/*
+ * Response head; `length_line` is the Content-Length or
+ * Transfer-Encoding header, without its CRLF. Responses with an ETag
+ * are market resources, negotiated by format and encoding.
+ */
+static size_t format_head(char *buf,
+                          size_t cap,
+                          int status_code,
+                          const char *content_type,
+                          const char *length_line,
+                          const char *etag,
+                          const char *encoding)
+{
+    size_t cors_len = 0;
+    const char *cors = cors_headers(&cors_len);
+
+    int n = snprintf(buf, cap,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: %s\r\n"
+        "%s\r\n"
+        "%s%s%s"
+        "%s%s%s"
+        "%.*s"
+        "\r\n",
+        status_code,
+        status_text(status_code),
+        content_type,
+        length_line,
+        encoding ? "Content-Encoding: " : "",
+        encoding ? encoding : "",
+        encoding ? "\r\n" : "",
+        etag ? "ETag: " : "",
+        etag ? etag : "",
+        etag ? "\r\nCache-Control: no-cache\r\n"
+               "Vary: Accept, Accept-Encoding\r\n" : "",
+        (int)cors_len, cors
+    );
+
+    if (n < 0 || (size_t)n >= cap)
+        return 0;
+
+    return (size_t)n;
+}
+
+static size_t format_typed_head(char *buf,
+                                size_t cap,
+                                int status_code,
+                                const char *content_type,
+                                size_t body_len,
+                                const char *etag,
+                                const char *encoding)
+{
+    char length_line[48];
+    snprintf(length_line, sizeof(length_line),
+             "Content-Length: %zu", body_len);
+
+    return format_head(buf, cap, status_code, content_type, length_line,
+                       etag, encoding);
+}
+
+size_t format_json_head(char *buf,
+                        size_t cap,
                         int status_code,
-                        const char *json_body)
+                        size_t body_len,
+                        const char *etag,
+                        const char *encoding)
+{
+    return format_typed_head(buf, cap, status_code, "application/json",
+                             body_len, etag, encoding);
+}
+
+void send_typed_response_etag(struct mg_connection *conn,
+                              int status_code,
+                              const char *content_type,
+                              const void *body,
+                              size_t body_len,
+                              const char *etag)
+{
+    if (send_not_modified(conn, etag))
+        return;
+
+    char head[RESPONSE_HEAD_MAX];
+    size_t head_len = format_typed_head(head, sizeof(head), status_code,
+                                        content_type, body_len, etag, NULL);
+
+    telemetry_set_status(status_code);
+    if (head_len == 0)
+        return;
+
+    send_assembled(conn, head, head_len, body, body_len);
+    telemetry_add_bytes(body_len);
+}
+
+void send_json_response_etag(struct mg_connection *conn,
+                             int status_code,
+                             const char *json_body,
+                             size_t body_len,
+                             const char *etag)
+{
+    send_typed_response_etag(conn, status_code, "application/json",
+                             json_body, body_len, etag);
+}
+
+void send_prepared_json_response(struct mg_connection *conn,
+                                 const char *wire,
+                                 size_t wire_len,
+                                 size_t body_len,
+                                 const char *etag)
 {
-    size_t body_len = strlen(json_body);
+    if (send_not_modified(conn, etag))
+        return;
 
-    mg_printf(conn,
+    telemetry_set_status(200);
+    mg_write(conn, wire, wire_len);
+    telemetry_add_bytes(body_len);
+}
+
+void send_text_response(struct mg_connection *conn,
+                        int status_code,
+                        const char *content_type,
+                        const char *body,
+                        size_t body_len)
+{
+    char head[RESPONSE_HEAD_MAX];
+    int n = snprintf(head, sizeof(head),
         "HTTP/1.1 %d %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %zu\r\n",
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "Cache-Control: no-store\r\n"
+        "\r\n",
         status_code,
         status_text(status_code),
+        content_type,
         body_len
     );
 
-    add_cors_headers(conn);
+    telemetry_set_status(status_code);
+    if (n < 0 || (size_t)n >= sizeof(head))
+        return;
+
+    send_assembled(conn, head, (size_t)n, body, body_len);
+    telemetry_add_bytes(body_len);
+}
+
+void send_json_response(struct mg_connection *conn,
+                        int status_code,
+                        const char *json_body)
+{
+    send_json_response_etag(conn, status_code,
+                            json_body, strlen(json_body), NULL);
+}
 
-    mg_printf(conn, "\r\n");
-    mg_write(conn, json_body, body_len);
+// ------------------------------------------------------------
+// Chunked responses
+// ------------------------------------------------------------
+
+/*
+ * Frame layout: room for the head, then for a chunk-size line, the
+ * payload (the sink's buffer), and its CRLF plus the final chunk. A
+ * flush writes the size line just in front of the payload, so each
+ * chunk leaves in one contiguous write with no copying of the body.
+ */
+#define CHUNK_SIZE_MAX 16               // "ffffffff\r\n"
+#define CHUNK_TRAILER_MAX 8             // "\r\n" + "0\r\n\r\n"
+#define FRAME_PAYLOAD_OFFSET (RESPONSE_HEAD_MAX + CHUNK_SIZE_MAX)
+
+static int flush_chunk(struct json_sink *sink, int last)
+{
+    struct chunked_response *r = sink->user;
+    char *payload = sink->buf;
+    char *start = payload;
+    char *end = payload + sink->len;
+
+    if (sink->len > 0) {
+        char size_line[CHUNK_SIZE_MAX];
+        int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", sink->len);
+        start -= n;
+        memcpy(start, size_line, (size_t)n);
+        memcpy(end, "\r\n", 2);
+        end += 2;
+    }
+
+    if (last) {
+        memcpy(end, "0\r\n\r\n", 5);
+        end += 5;
+    }
+
+    // The head goes out with the first chunk
+    if (!r->started) {
+        start -= r->head_len;
+        memmove(start, r->frame, r->head_len);
+        r->started = 1;
+    }
+
+    if (end == start)
+        return 0;
+
+    size_t total = (size_t)(end - start);
+    if (mg_write(r->conn, start, total) != (int)total)
+        return -1;
+
+    telemetry_add_bytes(sink->len);
+    return 0;
+}
+
+int chunked_response_begin(struct chunked_response *r,
+                           struct mg_connection *conn,
+                           int status_code)
+{
+    memset(r, 0, sizeof(*r));
+    r->conn = conn;
+
+    r->frame = arena_alloc(FRAME_PAYLOAD_OFFSET + CHUNKED_RESPONSE_BYTES
+                           + CHUNK_TRAILER_MAX);
+    if (!r->frame)
+        return -1;
+
+    r->head_len = format_head(r->frame, RESPONSE_HEAD_MAX, status_code,
+                              "application/json",
+                              "Transfer-Encoding: chunked", NULL, NULL);
+    if (r->head_len == 0)
+        return -1;
+
+    json_sink_init_stream(&r->sink, r->frame + FRAME_PAYLOAD_OFFSET,
+                          CHUNKED_RESPONSE_BYTES, flush_chunk, r);
+
+    telemetry_set_status(status_code);
+    return 0;
+}
+
+int chunked_response_end(struct chunked_response *r)
+{
+    return json_sink_finish(&r->sink);
 }
 
 void send_json_error(struct mg_connection *conn,
@@ -1,14 +1,120 @@
 #ifndef STOCKC_HTTP_RESPONSES_H
 #define STOCKC_HTTP_RESPONSES_H
 
+#include <stddef.h>
+
 #include "civetweb.h"
+#include "stockc/json_sink.h"
 
 /*
  * Common HTTP JSON responses
+ *
+ * Each response is written with a single mg_write: head and body are
+ * assembled into one buffer first, or come pre-assembled from the
+ * response cache.
+ */
+
+/*
+ * Room for a response head: status line, fixed headers, ETag and the
+ * CORS lines (whose origin is capped well below this).
+ */
+#define RESPONSE_HEAD_MAX 1024
+
+void send_json_response(struct mg_connection *conn,
+                        int status_code,
+                        const char *json_body);
+
+/*
+ * JSON response carrying a strong ETag.
+ * Sends 304 Not Modified (no body) when the request's If-None-Match
+ * matches `etag`.
+ */
+void send_json_response_etag(struct mg_connection *conn,
+                             int status_code,
+                             const char *json_body,
+                             size_t body_len,
+                             const char *etag);
+
+/*
+ * Like send_json_response_etag, for a body of another type (e.g. a
+ * binary form of a market resource).
+ */
+void send_typed_response_etag(struct mg_connection *conn,
+                              int status_code,
+                              const char *content_type,
+                              const void *body,
+                              size_t body_len,
+                              const char *etag);
+
+/*
+ * Write the status line and headers of a JSON response, through the
+ * blank line, into `buf`. `etag` may be NULL; with one the head also
+ * carries Vary: Accept, Accept-Encoding. `encoding` is the body's
+ * Content-Encoding, NULL for identity. Returns the head's length, or 0
+ * if it does not fit in `cap`.
+ */
+size_t format_json_head(char *buf,
+                        size_t cap,
+                        int status_code,
+                        size_t body_len,
+                        const char *etag,
+                        const char *encoding);
+
+/*
+ * Send a complete 200 response (`wire`: head from format_json_head,
+ * then the body) as-is, or a 304 when If-None-Match matches `etag`.
+ */
+void send_prepared_json_response(struct mg_connection *conn,
+                                 const char *wire,
+                                 size_t wire_len,
+                                 size_t body_len,
+                                 const char *etag);
+
+/*
+ * Non-JSON body (e.g. the /metrics scrape). Not cacheable and sent
+ * without CORS headers.
+ */
+void send_text_response(struct mg_connection *conn,
+                        int status_code,
+                        const char *content_type,
+                        const char *body,
+                        size_t body_len);
+
+/*
+ * Payload bytes per chunk of a chunked response.
+ */
+#define CHUNKED_RESPONSE_BYTES (16 * 1024)
+
+/*
+ * JSON response sent with Transfer-Encoding: chunked. Write the body
+ * into `sink`; every time its bounded buffer fills it goes out as one
+ * chunk in a single mg_write (the first also carries the head). No
+ * ETag, and never cached. The buffer lives in the request arena.
+ */
+struct chunked_response {
+    struct mg_connection *conn;
+    char *frame;
+    size_t head_len;
+    int started;
+    struct json_sink sink;
+};
+
+/*
+ * Returns 0, or -1 if the buffer could not be allocated (nothing has
+ * been sent; answer some other way).
+ */
+int chunked_response_begin(struct chunked_response *r,
+                           struct mg_connection *conn,
+                           int status_code);
+
+/*
+ * Flush the rest of the body and the terminating chunk.
+ * Returns 0, or -1 if any write failed (e.g. the client went away).
  */
+int chunked_response_end(struct chunked_response *r);
 
 void send_json_error(struct mg_connection *conn,
                      int status_code,
                      const char *message);
 
-#endif
\ No newline at end of file
+#endif
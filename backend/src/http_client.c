@@ -1,47 +1,115 @@
 #include "stockc/http_client.h"
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <curl/curl.h>
 
-struct mem_buf {
-    char *ptr;
-    size_t len;
-};
+#define BODY_INITIAL_CAP (16 * 1024)
+
+/*
+ * One CURLSH shared by every handle: DNS cache and TLS sessions. The
+ * connection cache is not shared: libcurl does not support that for
+ * handles running in parallel threads. Each thread keeps its own easy
+ * handle (easy handles must not be used concurrently), created on
+ * first use, and with it its own kept-alive connections.
+ */
+static CURLSH *share = NULL;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+static pthread_key_t handle_key;
+static int init_rc = 0;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+static atomic_ullong stat_requests;
+static atomic_ullong stat_connections_new;
+static atomic_ullong stat_connections_reused;
+static atomic_ullong stat_errors;
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static void share_lock(CURL *handle, curl_lock_data data,
+                       curl_lock_access access, void *userptr) {
+    (void)handle; (void)access; (void)userptr;
+    pthread_mutex_lock(&share_locks[data]);
+}
 
-static size_t write_cb(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsz = size * nmemb;
-    struct mem_buf *mem = (struct mem_buf *)userp;
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void)handle; (void)userptr;
+    pthread_mutex_unlock(&share_locks[data]);
+}
 
-    char *new_ptr = (char *)realloc(mem->ptr, mem->len + realsz + 1);
-    if (!new_ptr) return 0;
+static void destroy_handle(void *handle) {
+    curl_easy_cleanup((CURL *)handle);
+}
 
-    mem->ptr = new_ptr;
-    memcpy(mem->ptr + mem->len, contents, realsz);
-    mem->len += realsz;
-    mem->ptr[mem->len] = '\0';
+static void global_init_once(void) {
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0) {
+        init_rc = 2;
+        return;
+    }
 
-    return realsz;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        pthread_mutex_init(&share_locks[i], NULL);
+
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    if (pthread_key_create(&handle_key, destroy_handle) != 0)
+        init_rc = 2;
+}
+
+static CURL *thread_handle(void) {
+    CURL *curl = pthread_getspecific(handle_key);
+    if (curl)
+        return curl;
+
+    curl = curl_easy_init();
+    if (!curl)
+        return NULL;
+
+    if (share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    pthread_setspecific(handle_key, curl);
+    return curl;
+}
+
+
+// ------------------------------------------------------------
+// Client API
+// ------------------------------------------------------------
+
+int http_client_global_init(void) {
+    pthread_once(&init_once, global_init_once);
+    return init_rc;
 }
 
 int http_get(const char *url, long timeout_ms, struct http_response *out) {
     if (!url || !out) return 1;
     memset(out, 0, sizeof(*out));
 
-    static int curl_initialized = 0;
-    if (!curl_initialized) {
-        if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0)
-            return 2;
-        curl_initialized = 1;
-    }
+    if (http_client_global_init() != 0)
+        return 2;
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = thread_handle();
     if (!curl) return 3;
 
-    struct mem_buf mem = {0};
+    struct http_body mem = {0};
 
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, http_client_write_body);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &mem);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
@@ -49,7 +117,7 @@ int http_get(const char *url, long timeout_ms, struct http_response *out) {
 
     CURLcode rc = curl_easy_perform(curl);
     if (rc != CURLE_OK) {
-        curl_easy_cleanup(curl);
+        http_client_record_transfer(0, 0);
         free(mem.ptr);
         return 4;
     }
@@ -57,7 +125,9 @@ int http_get(const char *url, long timeout_ms, struct http_response *out) {
     long status = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
 
-    curl_easy_cleanup(curl);
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    http_client_record_transfer(1, connects);
 
     out->status = status;
     out->body = mem.ptr;
@@ -73,3 +143,51 @@ void http_response_free(struct http_response *res) {
     res->size = 0;
     res->status = 0;
 }
+
+size_t http_client_write_body(void *contents, size_t size, size_t nmemb,
+                              void *userp) {
+    size_t realsz = size * nmemb;
+    struct http_body *mem = (struct http_body *)userp;
+
+    // Grow geometrically: curl delivers a body in many small chunks
+    if (mem->len + realsz + 1 > mem->cap) {
+        size_t cap = mem->cap ? mem->cap * 2 : BODY_INITIAL_CAP;
+        while (cap < mem->len + realsz + 1)
+            cap *= 2;
+
+        char *new_ptr = (char *)realloc(mem->ptr, cap);
+        if (!new_ptr) return 0;
+
+        mem->ptr = new_ptr;
+        mem->cap = cap;
+    }
+
+    memcpy(mem->ptr + mem->len, contents, realsz);
+    mem->len += realsz;
+    mem->ptr[mem->len] = '\0';
+
+    return realsz;
+}
+
+void http_client_record_transfer(int ok, long connects) {
+    atomic_fetch_add_explicit(&stat_requests, 1, memory_order_relaxed);
+
+    if (!ok) {
+        atomic_fetch_add_explicit(&stat_errors, 1, memory_order_relaxed);
+        return;
+    }
+
+    // NUM_CONNECTS is the number of new connections the transfer made
+    atomic_fetch_add_explicit(
+        connects > 0 ? &stat_connections_new : &stat_connections_reused,
+        1, memory_order_relaxed);
+}
+
+void http_client_get_stats(struct http_client_stats *out) {
+    if (!out) return;
+
+    out->requests = atomic_load(&stat_requests);
+    out->connections_new = atomic_load(&stat_connections_new);
+    out->connections_reused = atomic_load(&stat_connections_reused);
+    out->errors = atomic_load(&stat_errors);
+}
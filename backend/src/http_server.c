@@ -2,8 +2,12 @@
 #include <string.h>
 
 #include "civetweb.h"
+#include "stockc/health.h"
 #include "stockc/http.h"
 #include "stockc/market.h"
+#include "http/cors.h"
+#include "memory/arena.h"
+#include "telemetry/telemetry.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -16,55 +20,30 @@
 
 // ---- CORS helpers ----
 
-static void add_cors_headers(struct mg_connection *conn)
-{
-    mg_printf(conn,
-        "Access-Control-Allow-Origin: http://localhost:5173\r\n"
-        "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-        "Access-Control-Allow-Headers: Content-Type\r\n"
-        "Access-Control-Max-Age: 86400\r\n"
-    );
-}
-
+// Preflights for any path get the same answer as the market routes'
 static int options_handler(struct mg_connection *conn, void *cbdata)
 {
-    mg_printf(conn,
-        "HTTP/1.1 204 No Content\r\n"
-        "Connection: close\r\n"
-    );
-    add_cors_headers(conn);
-    mg_printf(conn, "\r\n");
-    return 1;
+    (void)cbdata;
+    return handle_options_preflight(conn, mg_get_request_info(conn));
 }
 
 
-// ---- Health ----
+// ---- Telemetry ----
+
+static int begin_request(struct mg_connection *conn)
+{
+    (void)conn;
+    telemetry_request_begin();
+    return 0;   // let CivetWeb dispatch as usual
+}
 
-static int health_handler(struct mg_connection *conn, void *cbdata)
+static void end_request(const struct mg_connection *conn, int status)
 {
-    const char *response =
-        "{"
-        "\"status\":\"ok\","
-        "\"service\":\"stockc\""
-        "}";
-
-    mg_printf(conn,
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %zu\r\n",
-        strlen(response)
-    );
-
-    add_cors_headers(conn);
-
-    mg_printf(conn,
-        "Connection: close\r\n"
-        "\r\n"
-        "%s",
-        response
-    );
-
-    return 1;
+    const struct mg_request_info *req = mg_get_request_info(conn);
+    telemetry_request_end(req ? req->local_uri : NULL, status);
+
+    // Everything the request built is dropped in one go
+    arena_reset();
 }
 
 
@@ -81,8 +60,13 @@ int start_http_server(int port)
         0
     };
 
+    // Resolve CORS_ALLOWED_ORIGIN before the first response
+    cors_init();
+
     struct mg_callbacks callbacks;
     memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.begin_request = begin_request;
+    callbacks.end_request = end_request;
 
     struct mg_context *ctx = mg_start(&callbacks, NULL, options);
     if (!ctx) {
@@ -93,7 +77,7 @@ int start_http_server(int port)
     // CORS preflight handler
     mg_set_request_handler(ctx, "/**", options_handler, NULL);
 
-    mg_set_request_handler(ctx, "/health", health_handler, NULL);
+    register_health_routes(ctx);
     register_market_routes(ctx);
 
     printf("stockc listening on http://localhost:%d\n", port);
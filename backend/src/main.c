@@ -3,6 +3,39 @@
 #include <string.h>
 
 #include "stockc/http.h"
+#include "stockc/http_client.h"
+#include "stockc/upstream_engine.h"
+#include "stockc/upstream_governor.h"
+#include "cache/history_cache.h"
+#include "cache/response_cache.h"
+#include "services/history_refresher.h"
+
+/*
+ * Queue a background fetch for each symbol in STOCKC_WARMUP_SYMBOLS
+ * (comma-separated), so the first requests for them hit the cache.
+ */
+static void warm_history_cache(void)
+{
+    const char *list = getenv("STOCKC_WARMUP_SYMBOLS");
+    if (!list)
+        return;
+
+    const char *p = list;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        char symbol[16];
+
+        if (len > 0 && len < sizeof(symbol)) {
+            memcpy(symbol, p, len);
+            symbol[len] = '\0';
+            history_refresher_warm(symbol);
+        }
+
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+}
 
 int main(void)
 {
@@ -17,5 +50,24 @@ int main(void)
 
     printf("Listening on port %d\n", port);
 
+    if (http_client_global_init() != 0) {
+        fprintf(stderr, "Failed to initialize HTTP client\n");
+        return 1;
+    }
+
+    history_cache_init();
+    response_cache_init();
+
+    if (upstream_governor_start() != 0)
+        fprintf(stderr, "Upstream governor failed to start; upstream calls will not be rate limited\n");
+
+    if (upstream_engine_start() != 0)
+        fprintf(stderr, "Upstream engine failed to start; fetches will block request threads\n");
+
+    if (history_refresher_start() != 0)
+        fprintf(stderr, "Background refresher failed to start; expired entries will not be revalidated\n");
+
+    warm_history_cache();
+
     return start_http_server(port);
 }
\ No newline at end of file
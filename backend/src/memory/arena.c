@@ -0,0 +1,351 @@
+#include "arena.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_RETAIN_BYTES (4u * 1024 * 1024)   // 4 MiB
+#define ARENA_BLOCK_MIN (64u * 1024)            // 64 KiB
+#define ARENA_ALIGN 16
+
+struct arena_block {
+    struct arena_block *prev;   // older block
+    size_t cap;
+    size_t used;
+    _Alignas(ARENA_ALIGN) char data[];
+};
+
+struct arena {
+    struct arena_block *head;   // current (newest) block
+    void *last;                 // most recent allocation, for realloc
+    size_t peak;                // most bytes in use since the last reset
+#ifndef NDEBUG
+    unsigned long long allocations;
+    unsigned long long bytes;
+#endif
+};
+
+static _Thread_local struct arena *tls_arena = NULL;
+
+static pthread_key_t arena_key;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static size_t retain_bytes;
+
+static atomic_ullong stat_block_allocs;
+#ifndef NDEBUG
+static atomic_ullong stat_requests;
+static atomic_ullong stat_allocations;
+static atomic_ullong stat_bytes;
+static atomic_ullong stat_max_request_bytes;
+#endif
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static void free_blocks(struct arena_block *b)
+{
+    while (b) {
+        struct arena_block *prev = b->prev;
+        free(b);
+        b = prev;
+    }
+}
+
+static void destroy_arena(void *p)
+{
+    struct arena *a = p;
+    free_blocks(a->head);
+    free(a);
+}
+
+static void init_arena(void)
+{
+    pthread_key_create(&arena_key, destroy_arena);
+
+    retain_bytes = ARENA_RETAIN_BYTES;
+
+    const char *v = getenv("ARENA_RETAIN_BYTES");
+    if (v && strlen(v) > 0) {
+        long n = strtol(v, NULL, 10);
+        if (n > 0)
+            retain_bytes = (size_t)n;
+    }
+}
+
+static struct arena *get_arena(void)
+{
+    if (tls_arena)
+        return tls_arena;
+
+    pthread_once(&init_once, init_arena);
+
+    struct arena *a = calloc(1, sizeof(*a));
+    if (!a)
+        return NULL;
+
+    // The key only exists to free the arena when the thread exits
+    pthread_setspecific(arena_key, a);
+    tls_arena = a;
+    return a;
+}
+
+static size_t align_up(size_t n)
+{
+    return (n + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static struct arena_block *new_block(struct arena_block *prev, size_t cap)
+{
+    struct arena_block *b = malloc(sizeof(*b) + cap);
+    if (!b)
+        return NULL;
+
+    b->prev = prev;
+    b->cap = cap;
+    b->used = 0;
+    atomic_fetch_add_explicit(&stat_block_allocs, 1, memory_order_relaxed);
+    return b;
+}
+
+static size_t bytes_in_use(const struct arena *a)
+{
+    size_t n = 0;
+    for (const struct arena_block *b = a->head; b; b = b->prev)
+        n += b->used;
+    return n;
+}
+
+/*
+ * Drop every allocation. Several blocks are folded into one big
+ * enough for what was just released, so the next round of the same
+ * size stays in a single block. A single block is kept as it is,
+ * unless it is larger than the retain cap.
+ */
+static void release_all(struct arena *a)
+{
+    size_t in_use = bytes_in_use(a);
+    if (in_use > a->peak)
+        a->peak = in_use;
+
+    a->last = NULL;
+
+    if (!a->head)
+        return;
+
+    if (!a->head->prev &&
+        (a->head->cap <= retain_bytes || a->head->cap <= ARENA_BLOCK_MIN)) {
+        a->head->used = 0;
+        a->peak = 0;
+        return;
+    }
+
+    size_t cap = align_up(a->peak);
+    if (cap > retain_bytes)
+        cap = retain_bytes;
+    if (cap < ARENA_BLOCK_MIN)
+        cap = ARENA_BLOCK_MIN;
+
+    free_blocks(a->head);
+    a->head = new_block(NULL, cap);
+    a->peak = 0;
+}
+
+
+// ------------------------------------------------------------
+// Arena API
+// ------------------------------------------------------------
+
+void *arena_alloc(size_t size)
+{
+    struct arena *a = get_arena();
+    if (!a)
+        return NULL;
+
+    size = align_up(size ? size : 1);
+
+    struct arena_block *b = a->head;
+
+    if (!b || b->cap - b->used < size) {
+        // Each new block at least doubles, so a growing request
+        // needs only a few
+        size_t cap = b ? b->cap * 2 : ARENA_BLOCK_MIN;
+        if (cap < size)
+            cap = align_up(size);
+
+        struct arena_block *nb = new_block(b, cap);
+        if (!nb)
+            return NULL;
+
+        a->head = b = nb;
+    }
+
+    void *p = b->data + b->used;
+    b->used += size;
+    a->last = p;
+
+#ifndef NDEBUG
+    a->allocations++;
+    a->bytes += size;
+#endif
+
+    return p;
+}
+
+void *arena_calloc(size_t count, size_t size)
+{
+    if (size && count > SIZE_MAX / size)
+        return NULL;
+
+    void *p = arena_alloc(count * size);
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
+
+void *arena_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr)
+        return arena_alloc(new_size);
+
+    struct arena *a = get_arena();
+    struct arena_block *b = a ? a->head : NULL;
+
+    // The newest allocation can grow into the rest of its block
+    if (b && ptr == a->last) {
+        size_t start = (size_t)((char *)ptr - b->data);
+        size_t want = align_up(new_size ? new_size : 1);
+
+        if (start + want <= b->cap) {
+#ifndef NDEBUG
+            if (start + want > b->used)
+                a->bytes += start + want - b->used;
+#endif
+            b->used = start + want;
+            return ptr;
+        }
+    }
+
+    void *p = arena_alloc(new_size);
+    if (p)
+        memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    return p;
+}
+
+struct arena_mark arena_mark(void)
+{
+    struct arena_mark mark = { NULL, 0 };
+    struct arena *a = get_arena();
+
+    if (a && a->head) {
+        mark.block = a->head;
+        mark.used = a->head->used;
+    }
+    return mark;
+}
+
+void arena_rewind(struct arena_mark mark)
+{
+    struct arena *a = tls_arena;
+    if (!a)
+        return;
+
+    // A mark from before any allocation empties the arena
+    if (!mark.block) {
+        release_all(a);
+        return;
+    }
+
+    // Blocks opened after the mark go back to malloc
+    while (a->head && a->head != mark.block) {
+        struct arena_block *prev = a->head->prev;
+        free(a->head);
+        a->head = prev;
+    }
+
+    if (a->head)
+        a->head->used = mark.used;
+
+    a->last = NULL;
+}
+
+void arena_reset(void)
+{
+    struct arena *a = tls_arena;
+    if (!a)
+        return;
+
+#ifndef NDEBUG
+    atomic_fetch_add_explicit(&stat_requests, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat_allocations, a->allocations,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat_bytes, a->bytes, memory_order_relaxed);
+
+    unsigned long long prev_max =
+        atomic_load_explicit(&stat_max_request_bytes, memory_order_relaxed);
+    while (a->bytes > prev_max &&
+           !atomic_compare_exchange_weak_explicit(
+               &stat_max_request_bytes, &prev_max, a->bytes,
+               memory_order_relaxed, memory_order_relaxed))
+        ;
+
+    a->allocations = 0;
+    a->bytes = 0;
+#endif
+
+    release_all(a);
+}
+
+
+// ------------------------------------------------------------
+// yyjson adapter
+// ------------------------------------------------------------
+
+static void *yy_malloc(void *ctx, size_t size)
+{
+    (void)ctx;
+    return arena_alloc(size);
+}
+
+static void *yy_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+    (void)ctx;
+    return arena_realloc(ptr, old_size, size);
+}
+
+static void yy_free(void *ctx, void *ptr)
+{
+    (void)ctx;
+    (void)ptr;
+}
+
+static const yyjson_alc arena_alc = { yy_malloc, yy_realloc, yy_free, NULL };
+
+const yyjson_alc *arena_yyjson_alc(void)
+{
+    return &arena_alc;
+}
+
+void arena_get_stats(struct arena_stats *out)
+{
+    if (!out)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    out->block_allocs =
+        atomic_load_explicit(&stat_block_allocs, memory_order_relaxed);
+
+#ifndef NDEBUG
+    out->requests =
+        atomic_load_explicit(&stat_requests, memory_order_relaxed);
+    out->allocations =
+        atomic_load_explicit(&stat_allocations, memory_order_relaxed);
+    out->bytes =
+        atomic_load_explicit(&stat_bytes, memory_order_relaxed);
+    out->max_request_bytes =
+        atomic_load_explicit(&stat_max_request_bytes, memory_order_relaxed);
+#endif
+}
@@ -0,0 +1,86 @@
+#ifndef STOCKC_ARENA_H
+#define STOCKC_ARENA_H
+
+#include <stddef.h>
+
+#include "yyjson.h"
+
+/*
+ * Per-thread request arena.
+ *
+ * Bump allocator owned by the calling thread. Everything a request
+ * builds on the way to its response (parse trees, yyjson documents,
+ * output strings, scratch arrays) comes from here and is dropped in
+ * one go by arena_reset, which the HTTP server calls after every
+ * request. Nothing allocated here may outlive the request or be
+ * passed to free().
+ *
+ * Memory is kept between requests: on reset the arena folds its
+ * blocks into one block sized for the largest request seen (up to
+ * ARENA_RETAIN_BYTES), so steady-state requests never reach malloc
+ * and never fault in fresh pages.
+ *
+ * Threads that are not serving a request (e.g. the upstream engine)
+ * bracket their use with arena_mark / arena_rewind.
+ *
+ * Configuration (read once, on first use):
+ *   ARENA_RETAIN_BYTES  most memory a thread keeps across resets
+ *                       (default 4 MiB)
+ *
+ * Debug builds (no NDEBUG) also count allocations and bytes per
+ * request; see struct arena_stats.
+ */
+
+struct arena_mark {
+    void *block;
+    size_t used;
+};
+
+struct arena_stats {
+    unsigned long long block_allocs;    // blocks obtained from malloc
+
+    // Debug builds only; zero otherwise
+    unsigned long long requests;        // arena_reset calls
+    unsigned long long allocations;
+    unsigned long long bytes;
+    unsigned long long max_request_bytes;
+};
+
+/*
+ * Allocate `size` bytes, 16-byte aligned, from this thread's arena.
+ * Returns NULL only when malloc fails.
+ */
+void *arena_alloc(size_t size);
+
+/*
+ * arena_alloc, zero-filled.
+ */
+void *arena_calloc(size_t count, size_t size);
+
+/*
+ * Grow (or shrink) an allocation of `old_size` bytes. The most recent
+ * allocation is extended in place when the block has room.
+ */
+void *arena_realloc(void *ptr, size_t old_size, size_t new_size);
+
+/*
+ * Position to return to with arena_rewind. Allocations made after the
+ * mark are released by the rewind; earlier ones are untouched.
+ */
+struct arena_mark arena_mark(void);
+void arena_rewind(struct arena_mark mark);
+
+/*
+ * Release everything allocated on this thread since the last reset.
+ */
+void arena_reset(void);
+
+/*
+ * yyjson allocator backed by the calling thread's arena. Its free is
+ * a no-op; memory goes back at the next rewind or reset.
+ */
+const yyjson_alc *arena_yyjson_alc(void);
+
+void arena_get_stats(struct arena_stats *out);
+
+#endif /* STOCKC_ARENA_H */
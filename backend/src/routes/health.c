@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "civetweb.h"
+#include "stockc/health.h"
+#include "stockc/http_client.h"
+#include "stockc/upstream_engine.h"
+#include "stockc/upstream_governor.h"
+#include "../cache/history_cache.h"
+#include "../cache/negative_cache.h"
+#include "../memory/arena.h"
+#include "../cache/response_cache.h"
+#include "../services/history_refresher.h"
+#include "../services/single_flight.h"
+#include "../http/responses.h"
+#include "../telemetry/telemetry.h"
+
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static void append_counter(struct telemetry_text *t,
+                           const char *name,
+                           const char *type,
+                           const char *help,
+                           unsigned long long value)
+{
+    telemetry_appendf(t,
+        "# HELP %s %s\n"
+        "# TYPE %s %s\n"
+        "%s %llu\n",
+        name, help, name, type, name, value);
+}
+
+/*
+ * Component counters that already exist elsewhere, exported as-is.
+ */
+static void append_component_stats(struct telemetry_text *t)
+{
+    struct history_cache_stats hc;
+    history_cache_get_stats(&hc);
+
+    append_counter(t, "stockc_history_cache_entries", "gauge",
+                   "Symbols held in the history cache.", hc.entries);
+    append_counter(t, "stockc_history_cache_bytes", "gauge",
+                   "Bytes accounted to the history cache.", hc.bytes);
+    append_counter(t, "stockc_history_cache_hits_total", "counter",
+                   "History cache lookups that found an entry.", hc.hits);
+    append_counter(t, "stockc_history_cache_misses_total", "counter",
+                   "History cache lookups that found nothing.", hc.misses);
+    append_counter(t, "stockc_history_cache_evictions_total", "counter",
+                   "History cache entries evicted for space.", hc.evictions);
+
+    struct negative_cache_stats nc;
+    negative_cache_get_stats(&nc);
+
+    append_counter(t, "stockc_negative_cache_entries", "gauge",
+                   "Symbols remembered as recently failed.", nc.entries);
+    append_counter(t, "stockc_negative_cache_hits_total", "counter",
+                   "Upstream fetches skipped for a recent failure.", nc.hits);
+    append_counter(t, "stockc_negative_cache_recorded_total", "counter",
+                   "Upstream failures recorded.", nc.recorded);
+    append_counter(t, "stockc_negative_cache_cleared_total", "counter",
+                   "Failed symbols cleared by a successful fetch.", nc.cleared);
+    append_counter(t, "stockc_negative_cache_evictions_total", "counter",
+                   "Failed symbols evicted for space.", nc.evictions);
+
+    struct response_cache_stats rc;
+    response_cache_get_stats(&rc);
+
+    append_counter(t, "stockc_response_cache_entries", "gauge",
+                   "Responses held in the response cache.", rc.entries);
+    append_counter(t, "stockc_response_cache_bytes", "gauge",
+                   "Bytes accounted to the response cache.", rc.bytes);
+    append_counter(t, "stockc_response_cache_hits_total", "counter",
+                   "Response cache hits.", rc.hits);
+    append_counter(t, "stockc_response_cache_misses_total", "counter",
+                   "Response cache misses.", rc.misses);
+    append_counter(t, "stockc_response_cache_evictions_total", "counter",
+                   "Response cache entries evicted for space.", rc.evictions);
+
+    struct upstream_engine_stats ue;
+    upstream_engine_get_stats(&ue);
+
+    append_counter(t, "stockc_upstream_engine_submitted_total", "counter",
+                   "Requests submitted to the upstream engine.", ue.submitted);
+    append_counter(t, "stockc_upstream_engine_failed_total", "counter",
+                   "Upstream engine transport failures.", ue.failed);
+    append_counter(t, "stockc_upstream_engine_in_flight", "gauge",
+                   "Upstream transfers currently running.", ue.in_flight);
+    append_counter(t, "stockc_upstream_engine_queued", "gauge",
+                   "Upstream transfers waiting for a slot.", ue.queued);
+
+    struct upstream_governor_stats ug;
+    upstream_governor_get_stats(&ug);
+
+    append_counter(t, "stockc_upstream_governor_granted_total", "counter",
+                   "Upstream calls the governor let through.", ug.granted);
+    append_counter(t, "stockc_upstream_governor_queued_total", "counter",
+                   "Upstream calls that waited for a token.", ug.queued);
+    append_counter(t, "stockc_upstream_governor_refused_total", "counter",
+                   "Upstream calls refused for lack of quota.", ug.refused);
+    append_counter(t, "stockc_upstream_governor_limited_total", "counter",
+                   "Per-minute rate-limit notes from upstream.", ug.limited);
+    append_counter(t, "stockc_upstream_governor_limited_daily_total", "counter",
+                   "Daily-limit messages from upstream.", ug.limited_daily);
+    append_counter(t, "stockc_upstream_governor_waiting", "gauge",
+                   "Upstream calls queued for a token.", ug.waiting);
+    telemetry_appendf(t,
+        "# HELP stockc_upstream_governor_rate_per_minute Effective per-minute upstream rate (0 = unlimited).\n"
+        "# TYPE stockc_upstream_governor_rate_per_minute gauge\n"
+        "stockc_upstream_governor_rate_per_minute %g\n",
+        ug.rate_per_minute);
+
+    struct http_client_stats hcs;
+    http_client_get_stats(&hcs);
+
+    append_counter(t, "stockc_http_client_connections_new_total", "counter",
+                   "Upstream transfers that opened a connection.",
+                   hcs.connections_new);
+    append_counter(t, "stockc_http_client_connections_reused_total", "counter",
+                   "Upstream transfers on a kept-alive connection.",
+                   hcs.connections_reused);
+
+    struct history_refresher_stats hr;
+    history_refresher_get_stats(&hr);
+
+    append_counter(t, "stockc_refresh_succeeded_total", "counter",
+                   "Background history refreshes that succeeded.", hr.succeeded);
+    append_counter(t, "stockc_refresh_failed_total", "counter",
+                   "Background history refreshes that gave up.", hr.failed);
+    append_counter(t, "stockc_refresh_dropped_total", "counter",
+                   "Refreshes dropped because the queue was full.", hr.dropped);
+
+    struct arena_stats as;
+    arena_get_stats(&as);
+
+    append_counter(t, "stockc_arena_block_allocs_total", "counter",
+                   "Request arena blocks obtained from malloc.",
+                   as.block_allocs);
+#ifndef NDEBUG
+    append_counter(t, "stockc_arena_requests_total", "counter",
+                   "Requests whose arena was reset (debug builds).",
+                   as.requests);
+    append_counter(t, "stockc_arena_allocations_total", "counter",
+                   "Request arena allocations (debug builds).",
+                   as.allocations);
+    append_counter(t, "stockc_arena_bytes_total", "counter",
+                   "Bytes allocated from request arenas (debug builds).",
+                   as.bytes);
+    append_counter(t, "stockc_arena_max_request_bytes", "gauge",
+                   "Most arena bytes used by one request (debug builds).",
+                   as.max_request_bytes);
+#endif
+
+    struct single_flight_stats sf;
+    single_flight_get_stats(&sf);
+
+    append_counter(t, "stockc_single_flight_coalesced_total", "counter",
+                   "Cache misses that waited on another caller's fetch.",
+                   sf.coalesced);
+}
+
+
+// ============================================================
+// Handlers
+// ============================================================
+
+static int health_handler(struct mg_connection *conn, void *cbdata)
+{
+    (void)cbdata;
+
+    send_json_response(conn, 200,
+        "{"
+        "\"status\":\"ok\","
+        "\"service\":\"stockc\""
+        "}");
+
+    return 1;
+}
+
+static int metrics_handler(struct mg_connection *conn, void *cbdata)
+{
+    (void)cbdata;
+
+    struct telemetry_text t = { 0 };
+
+    telemetry_render(&t);
+    append_component_stats(&t);
+
+    if (!t.data) {
+        send_json_error(conn, 500, "Failed to render metrics");
+        return 1;
+    }
+
+    send_text_response(conn, 200, "text/plain; version=0.0.4",
+                       t.data, t.len);
+    free(t.data);
+    return 1;
+}
+
+
+// ============================================================
+// Route registration
+// ============================================================
+
+void register_health_routes(struct mg_context *ctx)
+{
+    mg_set_request_handler(ctx, "/health", health_handler, NULL);
+    mg_set_request_handler(ctx, "/metrics", metrics_handler, NULL);
+}
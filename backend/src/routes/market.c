@@ -1,10 +1,15 @@
+#include <ctype.h>
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
 #include "civetweb.h"
 #include "../controllers/market_controller.h"
+#include "stockc/market_history_columnar.h"
+#include "stockc/market_rolling.h"
 #include "../http/cors.h"
 #include "../http/responses.h"
+#include "../memory/arena.h"
 
 
 // ============================================================
@@ -47,6 +52,284 @@ static int extract_days_param(const struct mg_request_info *req)
     return days > 0 ? days : 0;
 }
 
+#define MARKET_WINDOWS_MAX 8
+#define MARKET_WINDOW_LIMIT 99999
+
+/*
+ * Parse `windows=5,21,63,0` into `out`.
+ * Returns the number of windows, 0 if absent, -1 if malformed or
+ * longer than `max`.
+ */
+static int extract_windows_param(const struct mg_request_info *req,
+                                 int *out,
+                                 int max)
+{
+    if (!req->query_string)
+        return 0;
+
+    char buf[128] = {0};
+
+    int rc = mg_get_var(req->query_string,
+                        strlen(req->query_string),
+                        "windows",
+                        buf,
+                        sizeof(buf));
+    if (rc == -1)
+        return 0;       // not present
+    if (rc < 0)
+        return -1;      // too long
+
+    int count = 0;
+    char *save = NULL;
+
+    for (char *tok = strtok_r(buf, ",", &save);
+         tok;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        char *end = NULL;
+        long w = strtol(tok, &end, 10);
+
+        if (end == tok || *end != '\0' || w < 0 || w > MARKET_WINDOW_LIMIT)
+            return -1;
+        if (count == max)
+            return -1;
+
+        out[count++] = (int)w;
+    }
+
+    return count;
+}
+
+/*
+ * History format: `format=bin` or `format=json` when given, otherwise
+ * an Accept header naming the columnar type.
+ * Returns 1 for columnar, 0 for JSON, -1 for an unknown format.
+ */
+static int wants_columnar(struct mg_connection *conn,
+                          const struct mg_request_info *req)
+{
+    char buf[16] = {0};
+    int rc = -1;
+
+    if (req->query_string)
+        rc = mg_get_var(req->query_string,
+                        strlen(req->query_string),
+                        "format",
+                        buf,
+                        sizeof(buf));
+
+    if (rc != -1) {
+        if (strcmp(buf, "bin") == 0)
+            return 1;
+        if (strcmp(buf, "json") == 0)
+            return 0;
+        return -1;
+    }
+
+    const char *accept = mg_get_header(conn, "Accept");
+    return accept && strstr(accept, MARKET_COLUMNAR_CONTENT_TYPE) != NULL;
+}
+
+/*
+ * Parse `decimals=` for fixed-point columnar prices.
+ * Returns 0 (f64) if absent, -1 if malformed or out of range.
+ */
+static int extract_decimals_param(const struct mg_request_info *req)
+{
+    char buf[16] = {0};
+
+    if (!req->query_string ||
+        mg_get_var(req->query_string,
+                   strlen(req->query_string),
+                   "decimals",
+                   buf,
+                   sizeof(buf)) < 0)
+        return 0;
+
+    char *end = NULL;
+    long d = strtol(buf, &end, 10);
+    if (end == buf || *end != '\0' || d < 0 ||
+        d > MARKET_COLUMNAR_DECIMALS_MAX)
+        return -1;
+
+    return (int)d;
+}
+
+#define MARKET_ROLLING_DEFAULT_WINDOW 21
+#define MARKET_ROLLING_MAX_WINDOW 10000
+
+/*
+ * Parse `window=` for rolling stats.
+ * Returns the window, or 0 if it is malformed or out of range.
+ */
+static size_t extract_rolling_window_param(const struct mg_request_info *req)
+{
+    char buf[16] = {0};
+
+    if (!req->query_string ||
+        mg_get_var(req->query_string,
+                   strlen(req->query_string),
+                   "window",
+                   buf,
+                   sizeof(buf)) < 0 ||
+        strlen(buf) == 0)
+        return MARKET_ROLLING_DEFAULT_WINDOW;
+
+    char *end = NULL;
+    long w = strtol(buf, &end, 10);
+
+    if (*end != '\0' || w < 2 || w > MARKET_ROLLING_MAX_WINDOW)
+        return 0;
+
+    return (size_t)w;
+}
+
+/*
+ * Parse `stats=vol,sharpe,drawdown` into MARKET_ROLLING_* flags.
+ * Absent means all. Returns 0 if any name is unknown.
+ */
+static unsigned extract_rolling_stats_param(const struct mg_request_info *req)
+{
+    char buf[64] = {0};
+
+    if (!req->query_string ||
+        mg_get_var(req->query_string,
+                   strlen(req->query_string),
+                   "stats",
+                   buf,
+                   sizeof(buf)) == -1)
+        return MARKET_ROLLING_ALL;
+
+    unsigned stats = 0;
+    char *save = NULL;
+
+    for (char *tok = strtok_r(buf, ",", &save);
+         tok;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        if (strcmp(tok, "vol") == 0)
+            stats |= MARKET_ROLLING_VOL;
+        else if (strcmp(tok, "sharpe") == 0)
+            stats |= MARKET_ROLLING_SHARPE;
+        else if (strcmp(tok, "drawdown") == 0)
+            stats |= MARKET_ROLLING_DRAWDOWN;
+        else
+            return 0;
+    }
+
+    return stats;
+}
+
+#define MARKET_BATCH_MAX 64
+#define MARKET_CORRELATION_MAX 500
+#define MARKET_PORTFOLIO_MAX 500
+
+/*
+ * Parse `weights=0.6,0.4` into `out`.
+ * Returns the number of weights, 0 if absent, -1 if malformed
+ * (non-numeric, negative, infinite or out of range) or longer than
+ * `max`.
+ */
+static int extract_weights_param(const struct mg_request_info *req,
+                                 double *out,
+                                 int max)
+{
+    if (!req->query_string)
+        return 0;
+
+    size_t buf_size = (size_t)max * 24;
+    char *buf = arena_alloc(buf_size);
+    if (!buf)
+        return -1;
+
+    int rc = mg_get_var(req->query_string,
+                        strlen(req->query_string),
+                        "weights",
+                        buf,
+                        buf_size);
+    if (rc < 0)
+        return rc == -1 ? 0 : -1;
+
+    int count = 0;
+    char *save = NULL;
+
+    for (char *tok = strtok_r(buf, ",", &save);
+         tok;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        char *end = NULL;
+        double w = strtod(tok, &end);
+
+        if (end == tok || *end != '\0' || !(w >= 0.0) || !isfinite(w) ||
+            count == max) {
+            count = -1;
+            break;
+        }
+
+        out[count++] = w;
+    }
+
+    return count;
+}
+
+/*
+ * Split the comma-separated `symbols` parameter into `out`, skipping
+ * empty items and duplicates (or rejecting duplicates when
+ * `unique` is set). `buf` holds the symbol strings.
+ * Returns the number of symbols, or -1 if one is malformed or there
+ * are more than `max`.
+ */
+static int extract_symbols_param(const struct mg_request_info *req,
+                                 char *buf,
+                                 size_t buf_size,
+                                 const char **out,
+                                 int max,
+                                 int unique)
+{
+    if (!req->query_string)
+        return 0;
+
+    if (mg_get_var(req->query_string,
+                   strlen(req->query_string),
+                   "symbols",
+                   buf,
+                   buf_size) < 0)
+        return -1;
+
+    int count = 0;
+    char *save = NULL;
+
+    for (char *tok = strtok_r(buf, ",", &save);
+         tok;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        size_t len = strlen(tok);
+        if (len >= 16)
+            return -1;
+
+        // Symbols are echoed into JSON unescaped
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = (unsigned char)tok[i];
+            if (!isalnum(c) && c != '.' && c != '-' && c != '^')
+                return -1;
+        }
+
+        int dup = 0;
+        for (int i = 0; i < count && !dup; i++)
+            dup = strcmp(out[i], tok) == 0;
+        if (dup && unique)
+            return -1;
+        if (dup)
+            continue;
+
+        if (count == max)
+            return -1;
+        out[count++] = tok;
+    }
+
+    return count;
+}
+
 
 // ============================================================
 // Route handlers (HTTP glue only)
@@ -83,7 +366,171 @@ static int handle_market_history(struct mg_connection *conn, void *cbdata)
 
     int days = extract_days_param(req);
 
-    return market_history_controller(conn, symbol, days);
+    int windows[MARKET_WINDOWS_MAX];
+    int window_count = extract_windows_param(req, windows, MARKET_WINDOWS_MAX);
+    if (window_count < 0) {
+        send_json_error(conn, 400, "windows must be up to 8 comma-separated day counts");
+        return 1;
+    }
+
+    int columnar = wants_columnar(conn, req);
+    if (columnar < 0) {
+        send_json_error(conn, 400, "format must be json or bin");
+        return 1;
+    }
+
+    if (columnar) {
+        int decimals = extract_decimals_param(req);
+        if (decimals < 0) {
+            send_json_error(conn, 400, "decimals must be between 0 and 8");
+            return 1;
+        }
+
+        return market_history_columnar_controller(conn, symbol, days,
+                                                  windows,
+                                                  (size_t)window_count,
+                                                  decimals);
+    }
+
+    return market_history_controller(conn, symbol, days,
+                                     windows, (size_t)window_count);
+}
+
+static int handle_market_rolling(struct mg_connection *conn, void *cbdata)
+{
+    const struct mg_request_info *req = mg_get_request_info(conn);
+
+    if (handle_options_preflight(conn, req))
+        return 1;
+
+    char symbol[16] = {0};
+    if (!extract_symbol_param(req, symbol, sizeof(symbol))) {
+        send_json_error(conn, 400, "symbol parameter required");
+        return 1;
+    }
+
+    size_t window = extract_rolling_window_param(req);
+    if (window == 0) {
+        send_json_error(conn, 400, "window must be between 2 and 10000");
+        return 1;
+    }
+
+    unsigned stats = extract_rolling_stats_param(req);
+    if (stats == 0) {
+        send_json_error(conn, 400, "stats must be a list of vol, sharpe, drawdown");
+        return 1;
+    }
+
+    int days = extract_days_param(req);
+
+    return market_rolling_controller(conn, symbol, days, window, stats);
+}
+
+static int handle_market_quotes(struct mg_connection *conn, void *cbdata)
+{
+    const struct mg_request_info *req = mg_get_request_info(conn);
+
+    if (handle_options_preflight(conn, req))
+        return 1;
+
+    char buf[MARKET_BATCH_MAX * 16];
+    const char *symbols[MARKET_BATCH_MAX];
+
+    int count = extract_symbols_param(req, buf, sizeof(buf),
+                                      symbols, MARKET_BATCH_MAX, 0);
+    if (count < 0) {
+        send_json_error(conn, 400, "symbols must be up to 64 comma-separated tickers");
+        return 1;
+    }
+    if (count == 0) {
+        send_json_error(conn, 400, "symbols parameter required");
+        return 1;
+    }
+
+    return market_quotes_controller(conn, symbols, (size_t)count);
+}
+
+static int handle_market_correlation(struct mg_connection *conn, void *cbdata)
+{
+    const struct mg_request_info *req = mg_get_request_info(conn);
+
+    if (handle_options_preflight(conn, req))
+        return 1;
+
+    size_t buf_size = MARKET_CORRELATION_MAX * 16;
+    char *buf = arena_alloc(buf_size);
+    const char **symbols = arena_alloc(MARKET_CORRELATION_MAX * sizeof(*symbols));
+
+    if (!buf || !symbols) {
+        send_json_error(conn, 500, "memory allocation failed");
+        return 1;
+    }
+
+    int count = extract_symbols_param(req, buf, buf_size,
+                                      symbols, MARKET_CORRELATION_MAX, 0);
+
+    char stat[16] = {0};
+    if (req->query_string)
+        mg_get_var(req->query_string, strlen(req->query_string),
+                   "stat", stat, sizeof(stat));
+
+    int covariance = strcmp(stat, "covariance") == 0;
+
+    if (count < 2) {
+        send_json_error(conn, 400,
+            "symbols must be 2 to 500 comma-separated tickers");
+    } else if (stat[0] != '\0' && !covariance &&
+               strcmp(stat, "correlation") != 0) {
+        send_json_error(conn, 400, "stat must be correlation or covariance");
+    } else {
+        market_correlation_controller(conn, symbols, (size_t)count,
+                                      extract_days_param(req), covariance);
+    }
+
+    return 1;
+}
+
+static int handle_market_portfolio(struct mg_connection *conn, void *cbdata)
+{
+    const struct mg_request_info *req = mg_get_request_info(conn);
+
+    if (handle_options_preflight(conn, req))
+        return 1;
+
+    size_t buf_size = MARKET_PORTFOLIO_MAX * 16;
+    char *buf = arena_alloc(buf_size);
+    const char **symbols = arena_alloc(MARKET_PORTFOLIO_MAX * sizeof(*symbols));
+    double *weights = arena_alloc(MARKET_PORTFOLIO_MAX * sizeof(*weights));
+
+    if (!buf || !symbols || !weights) {
+        send_json_error(conn, 500, "memory allocation failed");
+        return 1;
+    }
+
+    int count = extract_symbols_param(req, buf, buf_size,
+                                      symbols, MARKET_PORTFOLIO_MAX, 1);
+    int weight_count = extract_weights_param(req, weights,
+                                             MARKET_PORTFOLIO_MAX);
+
+    if (count <= 0) {
+        send_json_error(conn, 400,
+            "symbols must be 1 to 500 distinct comma-separated tickers");
+    } else if (weight_count < 0 ||
+               (weight_count > 0 && weight_count != count)) {
+        send_json_error(conn, 400,
+            "weights must be one finite non-negative number per symbol");
+    } else {
+        // Equal weights unless given
+        if (weight_count == 0) {
+            for (int i = 0; i < count; i++)
+                weights[i] = 1.0;
+        }
+
+        market_portfolio_controller(conn, symbols, weights, (size_t)count,
+                                    extract_days_param(req));
+    }
+
+    return 1;
 }
 
 
@@ -98,8 +545,28 @@ void register_market_routes(struct mg_context *ctx)
         handle_market_quote,
         NULL);
 
+    mg_set_request_handler(ctx,
+        "/api/market/quotes",
+        handle_market_quotes,
+        NULL);
+
     mg_set_request_handler(ctx,
         "/api/market/history",
         handle_market_history,
         NULL);
+
+    mg_set_request_handler(ctx,
+        "/api/market/correlation",
+        handle_market_correlation,
+        NULL);
+
+    mg_set_request_handler(ctx,
+        "/api/market/portfolio",
+        handle_market_portfolio,
+        NULL);
+
+    mg_set_request_handler(ctx,
+        "/api/market/rolling",
+        handle_market_rolling,
+        NULL);
 }
\ No newline at end of file
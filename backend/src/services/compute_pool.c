@@ -0,0 +1,166 @@
+#include "compute_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define COMPUTE_MAX_THREADS 16
+
+struct pool_job {
+    struct pool_job *next;
+    void (*fn)(size_t task, void *ctx);
+    void *ctx;
+    size_t tasks;
+    size_t next_task;       // next unclaimed task
+    size_t done;
+    pthread_cond_t finished;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static struct pool_job *jobs = NULL;   // jobs with unclaimed tasks
+static size_t workers = 0;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------------------------------------
+// Helpers (caller holds lock)
+// ------------------------------------------------------------
+
+static long env_long(const char *name, long fallback)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    long n = strtol(v, NULL, 10);
+    return n > 0 ? n : fallback;
+}
+
+/*
+ * Claim the next task of `job`, unlinking it once fully claimed.
+ */
+static size_t claim_task(struct pool_job *job)
+{
+    size_t task = job->next_task++;
+
+    if (job->next_task == job->tasks) {
+        struct pool_job **pp = &jobs;
+        while (*pp && *pp != job)
+            pp = &(*pp)->next;
+        if (*pp)
+            *pp = job->next;
+    }
+
+    return task;
+}
+
+static void finish_task(struct pool_job *job)
+{
+    if (++job->done == job->tasks)
+        pthread_cond_signal(&job->finished);
+}
+
+
+// ------------------------------------------------------------
+// Workers
+// ------------------------------------------------------------
+
+static void *pool_worker(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+
+    for (;;) {
+        struct pool_job *job = jobs;
+
+        if (!job) {
+            pthread_cond_wait(&work_cond, &lock);
+            continue;
+        }
+
+        size_t task = claim_task(job);
+
+        pthread_mutex_unlock(&lock);
+        job->fn(task, job->ctx);
+        pthread_mutex_lock(&lock);
+
+        finish_task(job);
+    }
+
+    return NULL;
+}
+
+static void start_pool(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long n = env_long("COMPUTE_THREADS", cpus > 0 ? cpus : 1);
+    if (n > COMPUTE_MAX_THREADS)
+        n = COMPUTE_MAX_THREADS;
+
+    // The submitting thread is one of the n
+    for (long i = 1; i < n; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, pool_worker, NULL) != 0)
+            break;
+        pthread_detach(tid);
+        workers++;
+    }
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+void compute_pool_run(size_t tasks,
+                      void (*fn)(size_t task, void *ctx),
+                      void *ctx)
+{
+    if (tasks == 0 || !fn)
+        return;
+
+    pthread_once(&init_once, start_pool);
+
+    struct pool_job job;
+    memset(&job, 0, sizeof(job));
+    job.fn = fn;
+    job.ctx = ctx;
+    job.tasks = tasks;
+    pthread_cond_init(&job.finished, NULL);
+
+    pthread_mutex_lock(&lock);
+
+    // Append, so earlier requests finish first
+    struct pool_job **pp = &jobs;
+    while (*pp)
+        pp = &(*pp)->next;
+    *pp = &job;
+
+    if (workers > 0)
+        pthread_cond_broadcast(&work_cond);
+
+    while (job.next_task < job.tasks) {
+        size_t task = claim_task(&job);
+
+        pthread_mutex_unlock(&lock);
+        fn(task, ctx);
+        pthread_mutex_lock(&lock);
+
+        finish_task(&job);
+    }
+
+    while (job.done < job.tasks)
+        pthread_cond_wait(&job.finished, &lock);
+
+    pthread_mutex_unlock(&lock);
+    pthread_cond_destroy(&job.finished);
+}
+
+size_t compute_pool_width(void)
+{
+    pthread_once(&init_once, start_pool);
+    return workers + 1;
+}
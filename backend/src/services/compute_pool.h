@@ -0,0 +1,32 @@
+#ifndef STOCKC_COMPUTE_POOL_H
+#define STOCKC_COMPUTE_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Shared worker pool for CPU-bound request work (e.g. correlation
+ * matrices).
+ *
+ * A job is a number of independent tasks; pool workers and the
+ * submitting thread claim tasks until all are done. Jobs from
+ * concurrent requests share the same workers.
+ *
+ * Configuration (read once, on first use):
+ *   COMPUTE_THREADS  worker threads (default: online CPUs, max 16)
+ */
+
+/*
+ * Run fn(task, ctx) for every task in [0, tasks) and return when all
+ * have finished. The caller runs tasks too, so this completes even if
+ * no worker could be started.
+ */
+void compute_pool_run(size_t tasks,
+                      void (*fn)(size_t task, void *ctx),
+                      void *ctx);
+
+/*
+ * Number of threads a job can use (workers + caller).
+ */
+size_t compute_pool_width(void);
+
+#endif
@@ -0,0 +1,347 @@
+#include "history_refresher.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stockc/alpha_vantage.h"
+#include "../cache/history_cache.h"
+#include "../cache/negative_cache.h"
+#include "single_flight.h"
+
+#define REFRESH_CONCURRENCY 2
+#define REFRESH_RETRIES 3
+#define REFRESH_QUEUE_MAX 256
+#define REFRESH_BACKOFF_MS 2000         // first retry delay, doubled per attempt
+#define REFRESH_MAX_IN_FLIGHT 256
+
+struct refresh_job {
+    struct refresh_job *next;
+    char symbol[16];
+    enum upstream_priority priority;
+    int attempts;
+    int running;
+    struct single_flight_call *flight;  // while running
+    struct timespec not_before;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static struct refresh_job *jobs = NULL;
+static size_t job_count = 0;
+static int started = 0;
+static int max_attempts = REFRESH_RETRIES;
+static long max_in_flight = REFRESH_CONCURRENCY;
+static long in_flight = 0;
+static unsigned int jitter_seed = 0;
+static struct history_refresher_stats stats = {0};
+
+
+// ------------------------------------------------------------
+// Helpers (caller holds lock unless noted)
+// ------------------------------------------------------------
+
+static long env_long(const char *name, long fallback)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    long n = strtol(v, NULL, 10);
+    return n > 0 ? n : fallback;
+}
+
+static void now_plus_ms(struct timespec *ts, long ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static int ts_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec ||
+           (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static struct refresh_job *find_job(const char *symbol)
+{
+    for (struct refresh_job *j = jobs; j; j = j->next) {
+        if (strcmp(j->symbol, symbol) == 0)
+            return j;
+    }
+    return NULL;
+}
+
+static void remove_job(struct refresh_job *job)
+{
+    struct refresh_job **pp = &jobs;
+    while (*pp && *pp != job)
+        pp = &(*pp)->next;
+    if (*pp)
+        *pp = job->next;
+
+    job_count--;
+    free(job);
+}
+
+/*
+ * Earliest idle job. Sets *ready when its not_before has passed.
+ */
+static struct refresh_job *next_job(int *ready)
+{
+    struct refresh_job *best = NULL;
+    for (struct refresh_job *j = jobs; j; j = j->next) {
+        if (j->running)
+            continue;
+        if (!best || ts_before(&j->not_before, &best->not_before))
+            best = j;
+    }
+
+    if (best) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        *ready = !ts_before(&now, &best->not_before);
+    }
+
+    return best;
+}
+
+// Exponential backoff with +/-50% jitter, so symbols that failed
+// together do not retry together
+static long backoff_ms(int attempts)
+{
+    long base = REFRESH_BACKOFF_MS << (attempts - 1);
+    long jitter = (long)(rand_r(&jitter_seed) % (unsigned)base) - base / 2;
+    return base + jitter;
+}
+
+
+// ------------------------------------------------------------
+// Completion and scheduler
+// ------------------------------------------------------------
+
+/*
+ * Record the outcome of an attempt: drop the job, or schedule a retry.
+ * `retry` = 0 makes a failure final regardless of attempts left.
+ */
+static void finish_attempt(struct refresh_job *job, int rc, int retry)
+{
+    job->running = 0;
+    in_flight--;
+
+    if (rc == 0) {
+        stats.succeeded++;
+        remove_job(job);
+    } else if (!retry) {
+        stats.failed++;
+        fprintf(stderr,
+            "[refresher] skipping %s, failed recently (rc=%d)\n",
+            job->symbol, rc);
+        remove_job(job);
+    } else if (job->attempts >= max_attempts) {
+        stats.failed++;
+        fprintf(stderr,
+            "[refresher] giving up on %s after %d attempts (rc=%d)\n",
+            job->symbol, job->attempts, rc);
+        remove_job(job);
+    } else {
+        stats.retried++;
+        now_plus_ms(&job->not_before, backoff_ms(job->attempts));
+    }
+
+    pthread_cond_signal(&work_cond);
+}
+
+/*
+ * Runs on the upstream engine thread. Jobs are not removed while
+ * running, so `job` is still live here.
+ */
+static void on_refreshed(int rc, struct market_series *series, void *user)
+{
+    struct refresh_job *job = user;
+
+    negative_cache_record(job->symbol, rc);
+
+    if (rc == 0) {
+        history_cache_set(job->symbol, series);
+        market_series_release(series);
+    }
+
+    // Cache first, so request-path callers woken here find the series
+    single_flight_finish(job->flight, rc);
+
+    pthread_mutex_lock(&lock);
+    finish_attempt(job, rc, 1);
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * Hands ready jobs to the upstream engine, keeping at most
+ * max_in_flight refreshes outstanding. Never waits on upstream itself.
+ */
+static void *refresh_scheduler(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+
+    for (;;) {
+        int ready = 0;
+        struct refresh_job *job =
+            in_flight < max_in_flight ? next_job(&ready) : NULL;
+
+        if (!job) {
+            pthread_cond_wait(&work_cond, &lock);
+            continue;
+        }
+
+        if (!ready) {
+            struct timespec until = job->not_before;
+            pthread_cond_timedwait(&work_cond, &lock, &until);
+            continue;
+        }
+
+        job->running = 1;
+        job->attempts++;
+        in_flight++;
+
+        // A request-path fetch may have beaten us to it
+        if (history_cache_is_valid(job->symbol)) {
+            finish_attempt(job, 0, 1);
+            continue;
+        }
+
+        // The negative cache's TTL already is the backoff for a symbol
+        // that failed recently; retrying sooner would only repeat it
+        int cached_rc = 0;
+        if (negative_cache_check(job->symbol, &cached_rc)) {
+            finish_attempt(job, cached_rc, 0);
+            continue;
+        }
+
+        // A request-path miss (or batch) is fetching it right now: that
+        // fetch refreshes the cache, so this job has nothing left to do
+        if (!single_flight_try_begin(job->symbol, &job->flight)) {
+            stats.deduplicated++;
+            job->running = 0;
+            in_flight--;
+            remove_job(job);
+            continue;
+        }
+
+        // Submission only queues; the completion takes the lock later
+        int rc = alpha_vantage_get_daily_history_async(
+            job->symbol, job->priority, on_refreshed, job);
+
+        if (rc != 0) {
+            single_flight_finish(job->flight, rc);
+            finish_attempt(job, rc, 1);
+        }
+    }
+
+    return NULL;
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+int history_refresher_start(void)
+{
+    pthread_mutex_lock(&lock);
+
+    if (started) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    max_in_flight = env_long("HISTORY_REFRESH_CONCURRENCY", REFRESH_CONCURRENCY);
+    if (max_in_flight > REFRESH_MAX_IN_FLIGHT)
+        max_in_flight = REFRESH_MAX_IN_FLIGHT;
+
+    max_attempts = (int)env_long("HISTORY_REFRESH_RETRIES", REFRESH_RETRIES);
+    jitter_seed = (unsigned int)time(NULL);
+
+    int rc = 0;
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, refresh_scheduler, NULL) == 0) {
+        pthread_detach(tid);
+        started = 1;
+    } else {
+        rc = -1;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return started ? 0 : rc;
+}
+
+static void enqueue(const char *symbol, enum upstream_priority priority)
+{
+    if (!symbol || symbol[0] == '\0')
+        return;
+
+    pthread_mutex_lock(&lock);
+
+    if (!started) {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    struct refresh_job *existing = find_job(symbol);
+    if (existing) {
+        // A warmup job someone is now reading becomes a refresh
+        if (priority < existing->priority)
+            existing->priority = priority;
+        stats.deduplicated++;
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    struct refresh_job *job =
+        job_count < REFRESH_QUEUE_MAX ? calloc(1, sizeof(*job)) : NULL;
+
+    if (!job) {
+        stats.dropped++;
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    strncpy(job->symbol, symbol, sizeof(job->symbol) - 1);
+    job->priority = priority;
+    clock_gettime(CLOCK_REALTIME, &job->not_before);
+    job->next = jobs;
+    jobs = job;
+    job_count++;
+    stats.enqueued++;
+
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void history_refresher_enqueue(const char *symbol)
+{
+    enqueue(symbol, UPSTREAM_PRIORITY_REFRESH);
+}
+
+void history_refresher_warm(const char *symbol)
+{
+    enqueue(symbol, UPSTREAM_PRIORITY_WARMUP);
+}
+
+void history_refresher_get_stats(struct history_refresher_stats *out)
+{
+    if (!out)
+        return;
+
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,51 @@
+#ifndef STOCKC_HISTORY_REFRESHER_H
+#define STOCKC_HISTORY_REFRESHER_H
+
+/*
+ * Background history refresher (stale-while-revalidate).
+ *
+ * Requests that find an expired cache entry serve it immediately and
+ * enqueue the symbol here. A single scheduler thread hands due jobs to
+ * the upstream engine (through the governor, at refresh or warmup
+ * priority), so many refreshes can be in flight without a thread
+ * each; failures are retried with exponential backoff plus
+ * jitter. A symbol in the negative cache is not fetched at all: the
+ * job fails at once, without retries. Refreshes lead the symbol's
+ * single flight, so request-path misses wait on them; a symbol some
+ * request is already fetching is left to that fetch.
+ *
+ * Configuration (read once by history_refresher_start):
+ *   HISTORY_REFRESH_CONCURRENCY  refreshes in flight at once (default 2,
+ *                                max 256)
+ *   HISTORY_REFRESH_RETRIES      attempts per symbol        (default 3)
+ */
+
+struct history_refresher_stats {
+    unsigned long long enqueued;
+    unsigned long long deduplicated;    // already queued, running or
+                                        // being fetched by a request
+    unsigned long long dropped;         // queue full
+    unsigned long long succeeded;
+    unsigned long long retried;
+    unsigned long long failed;          // gave up after all attempts
+};
+
+/*
+ * Start the scheduler thread. Returns 0 on success.
+ */
+int history_refresher_start(void);
+
+/*
+ * Queue a background refresh for `symbol`. Never blocks on upstream.
+ */
+void history_refresher_enqueue(const char *symbol);
+
+/*
+ * Like history_refresher_enqueue, for startup warming: the fetch goes
+ * upstream at the lowest priority, after any refresh.
+ */
+void history_refresher_warm(const char *symbol);
+
+void history_refresher_get_stats(struct history_refresher_stats *out);
+
+#endif
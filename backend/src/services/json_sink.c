@@ -0,0 +1,176 @@
+#include "stockc/json_sink.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "yyjson.h"
+#include "../memory/arena.h"
+
+// Longest number yyjson_write_number produces, plus its terminator
+#define NUMBER_MAX 40
+
+void json_sink_init_arena(struct json_sink *sink, size_t initial_cap)
+{
+    memset(sink, 0, sizeof(*sink));
+
+    sink->cap = initial_cap ? initial_cap : 256;
+    sink->buf = arena_alloc(sink->cap);
+    if (!sink->buf)
+        sink->error = 1;
+}
+
+void json_sink_init_stream(struct json_sink *sink,
+                           char *buf,
+                           size_t cap,
+                           int (*flush)(struct json_sink *, int),
+                           void *user)
+{
+    memset(sink, 0, sizeof(*sink));
+
+    sink->buf = buf;
+    sink->cap = cap;
+    sink->flush = flush;
+    sink->user = user;
+}
+
+/*
+ * Ensure `n` free bytes: drain a stream sink, grow an arena one.
+ */
+static int make_room(struct json_sink *sink, size_t n)
+{
+    if (sink->error)
+        return -1;
+
+    if (sink->cap - sink->len >= n)
+        return 0;
+
+    if (sink->flush) {
+        if (sink->len > 0) {
+            if (sink->flush(sink, 0) != 0) {
+                sink->error = 1;
+                return -1;
+            }
+            sink->len = 0;
+        }
+
+        if (n > sink->cap) {
+            sink->error = 1;
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t cap = sink->cap * 2;
+    while (cap - sink->len < n)
+        cap *= 2;
+
+    // The buffer is usually the arena's newest block: grows in place
+    char *grown = arena_realloc(sink->buf, sink->cap, cap);
+    if (!grown) {
+        sink->error = 1;
+        return -1;
+    }
+
+    sink->buf = grown;
+    sink->cap = cap;
+    return 0;
+}
+
+char *json_sink_reserve(struct json_sink *sink, size_t n)
+{
+    if (make_room(sink, n) != 0)
+        return NULL;
+
+    return sink->buf + sink->len;
+}
+
+void json_sink_write(struct json_sink *sink, const char *data, size_t n)
+{
+    while (n > 0 && !sink->error) {
+        // Stream sinks take large writes a buffer at a time
+        size_t part = n;
+        if (sink->flush && part > sink->cap)
+            part = sink->cap;
+
+        if (make_room(sink, part) != 0)
+            return;
+
+        memcpy(sink->buf + sink->len, data, part);
+        sink->len += part;
+        data += part;
+        n -= part;
+    }
+}
+
+void json_sink_real(struct json_sink *sink, double value)
+{
+    if (!isfinite(value)) {
+        json_sink_write(sink, "null", 4);
+        return;
+    }
+
+    char *at = json_sink_reserve(sink, NUMBER_MAX);
+    if (!at)
+        return;
+
+    yyjson_mut_val num;
+    memset(&num, 0, sizeof(num));
+    yyjson_mut_set_real(&num, value);
+
+    char *end = yyjson_mut_write_number(&num, at);
+    if (end)
+        json_sink_commit(sink, end);
+}
+
+void json_sink_int(struct json_sink *sink, long long value)
+{
+    char *at = json_sink_reserve(sink, 24);
+    if (!at)
+        return;
+
+    int n = snprintf(at, 24, "%lld", value);
+    if (n > 0)
+        sink->len += (size_t)n;
+}
+
+void json_sink_string(struct json_sink *sink, const char *s)
+{
+    json_sink_write(sink, "\"", 1);
+
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        json_sink_write(sink, run, (size_t)(s - run));
+        run = s + 1;
+
+        char esc[8];
+        int n = c == '"'  ? snprintf(esc, sizeof(esc), "\\\"")
+              : c == '\\' ? snprintf(esc, sizeof(esc), "\\\\")
+              :             snprintf(esc, sizeof(esc), "\\u%04x", c);
+        json_sink_write(sink, esc, (size_t)n);
+    }
+
+    json_sink_write(sink, run, (size_t)(s - run));
+    json_sink_write(sink, "\"", 1);
+}
+
+int json_sink_finish(struct json_sink *sink)
+{
+    if (sink->flush) {
+        if (!sink->error && sink->flush(sink, 1) != 0)
+            sink->error = 1;
+        sink->len = 0;
+        return sink->error ? -1 : 0;
+    }
+
+    // Arena documents are handed out as C strings
+    if (make_room(sink, 1) != 0)
+        return -1;
+
+    sink->buf[sink->len] = '\0';
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "stockc/market_align.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Move every cursor forward to the first date >= some common target,
+ * starting from `from[i]`. Returns 1 with a->pos/date set on the next
+ * common date, 0 if a series runs out.
+ */
+static int leapfrog_forward(struct market_align *a, const size_t *from)
+{
+    size_t k = a->k;
+    int32_t target = INT32_MIN;
+
+    for (size_t i = 0; i < k; i++) {
+        if (from[i] >= a->series[i]->count)
+            return 0;
+        a->pos[i] = from[i];
+        if (a->series[i]->dates[from[i]] > target)
+            target = a->series[i]->dates[from[i]];
+    }
+
+    for (;;) {
+        int agreed = 1;
+
+        for (size_t i = 0; i < k; i++) {
+            const struct market_series *s = a->series[i];
+            size_t p = a->pos[i];
+
+            while (p < s->count && s->dates[p] < target)
+                p++;
+            if (p == s->count)
+                return 0;
+
+            a->pos[i] = p;
+            if (s->dates[p] > target) {
+                target = s->dates[p];
+                agreed = 0;
+            }
+        }
+
+        if (agreed) {
+            a->date = target;
+            return 1;
+        }
+    }
+}
+
+/*
+ * Mirror of leapfrog_forward, walking back from the newest points.
+ * cur[i] is one past the last index still allowed.
+ */
+static int leapfrog_backward(struct market_align *a, size_t *cur)
+{
+    size_t k = a->k;
+    int32_t target = INT32_MAX;
+
+    for (size_t i = 0; i < k; i++) {
+        if (cur[i] == 0)
+            return 0;
+        if (a->series[i]->dates[cur[i] - 1] < target)
+            target = a->series[i]->dates[cur[i] - 1];
+    }
+
+    for (;;) {
+        int agreed = 1;
+
+        for (size_t i = 0; i < k; i++) {
+            const struct market_series *s = a->series[i];
+            size_t p = cur[i];
+
+            while (p > 0 && s->dates[p - 1] > target)
+                p--;
+            if (p == 0)
+                return 0;
+
+            cur[i] = p;
+            if (s->dates[p - 1] < target) {
+                target = s->dates[p - 1];
+                agreed = 0;
+            }
+        }
+
+        if (agreed) {
+            for (size_t i = 0; i < k; i++)
+                cur[i]--;
+            return 1;
+        }
+    }
+}
+
+int market_align_init(struct market_align *a,
+                      const struct market_series *const *series,
+                      size_t k,
+                      size_t days)
+{
+    if (!a || !series || k == 0)
+        return -1;
+
+    memset(a, 0, sizeof(*a));
+
+    for (size_t i = 0; i < k; i++) {
+        if (!series[i])
+            return -1;
+    }
+
+    a->series = series;
+    a->k = k;
+    a->pos = calloc(k * 2, sizeof(size_t));
+    if (!a->pos)
+        return -1;
+
+    // Count back from the newest common date to find where the walk
+    // starts; cur ends on the oldest date that will be visited
+    size_t *cur = a->pos + k;
+    for (size_t i = 0; i < k; i++)
+        cur[i] = series[i]->count;
+
+    while ((days == 0 || a->count < days) && leapfrog_backward(a, cur))
+        a->count++;
+
+    // market_align_next starts its first search at cur
+    return 0;
+}
+
+int market_align_next(struct market_align *a)
+{
+    if (!a || a->visited >= a->count)
+        return 0;
+
+    size_t *start = a->pos + a->k;
+
+    if (a->visited > 0) {
+        for (size_t i = 0; i < a->k; i++)
+            start[i] = a->pos[i] + 1;
+    }
+
+    if (!leapfrog_forward(a, start))
+        return 0;
+
+    a->visited++;
+    return 1;
+}
+
+void market_align_free(struct market_align *a)
+{
+    if (!a)
+        return;
+
+    free(a->pos);
+    a->pos = NULL;
+}
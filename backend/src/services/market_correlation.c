@@ -0,0 +1,238 @@
+#include "stockc/market_correlation.h"
+#include "stockc/market_align.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compute_pool.h"
+
+#define TILE_ROWS 32        // rows per tile; two tiles of a year of
+                            // returns stay within L2
+
+typedef double v4d __attribute__((vector_size(32)));
+
+struct tile_job {
+    const double *returns;  // n rows of `stride` demeaned returns
+    size_t stride;          // multiple of 4, zero padded
+    size_t n;
+    size_t tiles;           // tiles per side
+    double scale;           // 1 / number of returns
+    double *out;            // packed upper triangle
+};
+
+
+// ------------------------------------------------------------
+// Kernel
+// ------------------------------------------------------------
+
+#define HSUM(v) (((v)[0] + (v)[1]) + ((v)[2] + (v)[3]))
+
+/*
+ * Covariances of rows [i0, i1) against rows [j0, j1), upper triangle
+ * only. Row i is reused across four j rows at a time.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(__clang__)
+__attribute__((target_clones("avx2", "default")))
+#endif
+static void covariance_tile(const struct tile_job *job,
+                            size_t i0, size_t i1,
+                            size_t j0, size_t j1)
+{
+    const size_t stride = job->stride;
+    const size_t n = job->n;
+
+    for (size_t i = i0; i < i1; i++) {
+        const v4d *ri = (const v4d *)(job->returns + i * stride);
+        size_t j = j0 > i ? j0 : i;
+
+        for (; j + 4 <= j1; j += 4) {
+            const v4d *r0 = (const v4d *)(job->returns + (j + 0) * stride);
+            const v4d *r1 = (const v4d *)(job->returns + (j + 1) * stride);
+            const v4d *r2 = (const v4d *)(job->returns + (j + 2) * stride);
+            const v4d *r3 = (const v4d *)(job->returns + (j + 3) * stride);
+
+            v4d a0 = {0}, a1 = {0}, a2 = {0}, a3 = {0};
+
+            for (size_t t = 0; t < stride / 4; t++) {
+                v4d x = ri[t];
+                a0 += x * r0[t];
+                a1 += x * r1[t];
+                a2 += x * r2[t];
+                a3 += x * r3[t];
+            }
+
+            job->out[MARKET_PACKED_INDEX(n, i, j + 0)] = HSUM(a0) * job->scale;
+            job->out[MARKET_PACKED_INDEX(n, i, j + 1)] = HSUM(a1) * job->scale;
+            job->out[MARKET_PACKED_INDEX(n, i, j + 2)] = HSUM(a2) * job->scale;
+            job->out[MARKET_PACKED_INDEX(n, i, j + 3)] = HSUM(a3) * job->scale;
+        }
+
+        for (; j < j1; j++) {
+            const v4d *rj = (const v4d *)(job->returns + j * stride);
+            v4d a = {0};
+
+            for (size_t t = 0; t < stride / 4; t++)
+                a += ri[t] * rj[t];
+
+            job->out[MARKET_PACKED_INDEX(n, i, j)] = HSUM(a) * job->scale;
+        }
+    }
+}
+
+/*
+ * Task k is the k-th tile pair (bi <= bj) of the upper triangle.
+ */
+static void run_tile(size_t task, void *ctx)
+{
+    const struct tile_job *job = ctx;
+
+    size_t bi = 0;
+    size_t row_tiles = job->tiles;
+    while (task >= row_tiles) {
+        task -= row_tiles;
+        bi++;
+        row_tiles--;
+    }
+    size_t bj = bi + task;
+
+    size_t i0 = bi * TILE_ROWS;
+    size_t j0 = bj * TILE_ROWS;
+    size_t i1 = i0 + TILE_ROWS < job->n ? i0 + TILE_ROWS : job->n;
+    size_t j1 = j0 + TILE_ROWS < job->n ? j0 + TILE_ROWS : job->n;
+
+    covariance_tile(job, i0, i1, j0, j1);
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+/*
+ * Fill `returns` (n rows of `stride`) with demeaned returns between
+ * consecutive common dates.
+ */
+static int load_returns(const struct market_series *const *series,
+                        size_t n,
+                        struct market_align *align,
+                        double *returns,
+                        size_t stride)
+{
+    double *prev = malloc(n * sizeof(*prev));
+    if (!prev)
+        return -1;
+
+    size_t step = 0;
+
+    while (market_align_next(align)) {
+        for (size_t i = 0; i < n; i++) {
+            double p = series[i]->prices[align->pos[i]];
+            if (step > 0)
+                returns[i * stride + step - 1] = (p / prev[i]) - 1.0;
+            prev[i] = p;
+        }
+        step++;
+    }
+
+    free(prev);
+
+    size_t count = step > 0 ? step - 1 : 0;
+
+    for (size_t i = 0; i < n; i++) {
+        double *row = returns + i * stride;
+        double sum = 0.0;
+
+        for (size_t t = 0; t < count; t++)
+            sum += row[t];
+
+        double mean = sum / (double)count;
+        for (size_t t = 0; t < count; t++)
+            row[t] -= mean;
+    }
+
+    return 0;
+}
+
+int market_correlation_matrix(
+    const struct market_series *const *series,
+    size_t n,
+    size_t days,
+    int correlation,
+    double *out,
+    size_t *points
+)
+{
+    if (!series || !out || n == 0)
+        return -1;
+
+    struct market_align align;
+    if (market_align_init(&align, series, n, days) != 0)
+        return -1;
+
+    if (points)
+        *points = align.count;
+
+    memset(out, 0, MARKET_PACKED_SIZE(n) * sizeof(*out));
+
+    if (align.count < 3) {
+        market_align_free(&align);
+        return 0;
+    }
+
+    size_t count = align.count - 1;
+    size_t stride = (count + 3) & ~(size_t)3;
+
+    double *returns = aligned_alloc(32, n * stride * sizeof(double));
+    if (!returns) {
+        market_align_free(&align);
+        return -1;
+    }
+    memset(returns, 0, n * stride * sizeof(double));
+
+    int rc = load_returns(series, n, &align, returns, stride);
+    market_align_free(&align);
+
+    if (rc != 0) {
+        free(returns);
+        return -1;
+    }
+
+    struct tile_job job = {
+        .returns = returns,
+        .stride = stride,
+        .n = n,
+        .tiles = (n + TILE_ROWS - 1) / TILE_ROWS,
+        .scale = 1.0 / (double)count,
+        .out = out,
+    };
+
+    compute_pool_run(job.tiles * (job.tiles + 1) / 2, run_tile, &job);
+    free(returns);
+
+    if (!correlation)
+        return 0;
+
+    double *sd = malloc(n * sizeof(*sd));
+    if (!sd)
+        return -1;
+
+    for (size_t i = 0; i < n; i++) {
+        double var = out[MARKET_PACKED_INDEX(n, i, i)];
+        sd[i] = var > 0.0 ? sqrt(var) : 0.0;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i; j < n; j++) {
+            double *c = &out[MARKET_PACKED_INDEX(n, i, j)];
+            *c = sd[i] > 0.0 && sd[j] > 0.0 ? *c / (sd[i] * sd[j]) : 0.0;
+        }
+
+        // Exactly 1, not var / (sqrt(var) * sqrt(var)) with its rounding
+        if (sd[i] > 0.0)
+            out[MARKET_PACKED_INDEX(n, i, i)] = 1.0;
+    }
+
+    free(sd);
+    return 0;
+}
@@ -1,5 +1,10 @@
 #include "stockc/market_demo_data.h"
 
+#include <pthread.h>
+#include <string.h>
+
+#include "yyjson.h"
+
 /*
  * NOTE:
  * - Reverse chronological (latest first)
@@ -119,3 +124,48 @@ market_demo_history_json(void)
 {
     return DEV_FALLBACK_HISTORY;
 }
+
+static struct market_series *demo_series = NULL;
+static pthread_once_t demo_series_once = PTHREAD_ONCE_INIT;
+
+static void parse_demo_series(void)
+{
+    yyjson_doc *doc = yyjson_read(
+        DEV_FALLBACK_HISTORY, strlen(DEV_FALLBACK_HISTORY), 0);
+    if (!doc)
+        return;
+
+    yyjson_val *root = yyjson_doc_get_root(doc);
+    yyjson_val *series = yyjson_obj_get(root, "series");
+    const char *symbol = yyjson_get_str(yyjson_obj_get(root, "symbol"));
+
+    size_t count = yyjson_arr_size(series);
+    struct market_series *s = market_series_create(symbol, count);
+    if (!s) {
+        yyjson_doc_free(doc);
+        return;
+    }
+
+    // Reverse-chronological source -> chronological arrays
+    size_t idx, max;
+    yyjson_val *item;
+    yyjson_arr_foreach(series, idx, max, item) {
+        size_t at = count - 1 - idx;
+        const char *date = yyjson_get_str(yyjson_obj_get(item, "date"));
+
+        if (market_date_parse(date, &s->dates[at]) != 0)
+            s->dates[at] = 0;
+        s->prices[at] = yyjson_get_real(yyjson_obj_get(item, "price"));
+    }
+
+    yyjson_doc_free(doc);
+    market_series_build_index(s);
+    demo_series = s;    // holds the permanent reference
+}
+
+struct market_series *
+market_demo_history_series(void)
+{
+    pthread_once(&demo_series_once, parse_demo_series);
+    return market_series_retain(demo_series);
+}
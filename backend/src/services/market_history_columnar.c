@@ -0,0 +1,180 @@
+#include "stockc/market_history_columnar.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "stockc/market_history_json.h"
+#include "../memory/arena.h"
+
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HOST_LITTLE_ENDIAN 1
+#endif
+
+// ------------------------------------------------------------
+// Little-endian writers
+// ------------------------------------------------------------
+
+static void put_u16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_f64(unsigned char *p, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put_u64(p, bits);
+}
+
+/*
+ * Copy 4- or 8-byte host values out little-endian: a plain memcpy on
+ * little-endian hosts, which is every deployment so far.
+ */
+static void put_i32_array(unsigned char *p, const int32_t *v, size_t n)
+{
+#ifdef HOST_LITTLE_ENDIAN
+    memcpy(p, v, n * sizeof(*v));
+#else
+    for (size_t i = 0; i < n; i++)
+        put_u32(p + 4 * i, (uint32_t)v[i]);
+#endif
+}
+
+static void put_f64_array(unsigned char *p, const double *v, size_t n)
+{
+#ifdef HOST_LITTLE_ENDIAN
+    memcpy(p, v, n * sizeof(*v));
+#else
+    for (size_t i = 0; i < n; i++)
+        put_f64(p + 8 * i, v[i]);
+#endif
+}
+
+/*
+ * Prices as i32 multiples of 10^-decimals. Returns 0, or -1 (nothing
+ * usable written) if a price is not finite or out of range.
+ */
+static int put_fixed_array(unsigned char *p,
+                           const double *v,
+                           size_t n,
+                           int decimals)
+{
+    double scale = pow(10.0, decimals);
+
+    for (size_t i = 0; i < n; i++) {
+        double x = nearbyint(v[i] * scale);
+        if (!(x >= (double)INT32_MIN && x <= (double)INT32_MAX))
+            return -1;
+        put_u32(p + 4 * i, (uint32_t)(int32_t)x);
+    }
+
+    return 0;
+}
+
+
+// ------------------------------------------------------------
+// Encoder
+// ------------------------------------------------------------
+
+void *market_build_history_columnar(const struct market_series *series,
+                                    int days,
+                                    const int *windows,
+                                    size_t window_count,
+                                    int decimals,
+                                    uint8_t source,
+                                    long long fetched_at,
+                                    size_t *out_len)
+{
+    if (!out_len || decimals < 0 || decimals > MARKET_COLUMNAR_DECIMALS_MAX)
+        return NULL;
+
+    size_t start = 0;
+    size_t count = 0;
+
+    struct market_metrics metrics[MARKET_HISTORY_WINDOWS_MAX];
+    int sets = 0;
+
+    if (series) {
+        count = series->count;
+        if (days > 0 && (size_t)days < count)
+            count = (size_t)days;
+        start = series->count - count;
+
+        sets = market_history_metrics(series, days, windows, window_count,
+                                      metrics);
+        if (sets < 0)
+            return NULL;
+    }
+
+    if (count > UINT32_MAX)
+        return NULL;
+
+    // Sized for f64 prices; fixed point only ever needs less
+    size_t dates_at = MARKET_COLUMNAR_HEADER_BYTES;
+    size_t prices_at = ALIGN8(dates_at + count * sizeof(int32_t));
+    size_t metrics_at = ALIGN8(prices_at + count * sizeof(double));
+    size_t total = metrics_at + (size_t)sets * MARKET_COLUMNAR_METRICS_BYTES;
+
+    unsigned char *buf = arena_calloc(1, total);
+    if (!buf)
+        return NULL;
+
+    if (count > 0) {
+        put_i32_array(buf + dates_at, series->dates + start, count);
+
+        if (decimals > 0 &&
+            put_fixed_array(buf + prices_at, series->prices + start,
+                            count, decimals) == 0) {
+            metrics_at = ALIGN8(prices_at + count * sizeof(int32_t));
+        } else {
+            decimals = 0;
+            put_f64_array(buf + prices_at, series->prices + start, count);
+        }
+    } else {
+        decimals = 0;
+    }
+
+    // Fixed-point prices take half the room: metrics move up behind them
+    total = metrics_at + (size_t)sets * MARKET_COLUMNAR_METRICS_BYTES;
+
+    for (int i = 0; i < sets; i++) {
+        unsigned char *m = buf + metrics_at
+                         + (size_t)i * MARKET_COLUMNAR_METRICS_BYTES;
+        int window = window_count > 0 ? windows[i] : (days > 0 ? days : 0);
+
+        put_u32(m, (uint32_t)window);
+        put_f64(m + 8, metrics[i].sharpe);
+        put_f64(m + 16, metrics[i].sortino);
+        put_f64(m + 24, metrics[i].max_drawdown);
+        put_f64(m + 32, metrics[i].cagr);
+    }
+
+    memcpy(buf, "SKCH", 4);
+    put_u16(buf + 4, MARKET_COLUMNAR_VERSION);
+    buf[6] = source;
+    buf[7] = (unsigned char)decimals;
+    put_u32(buf + 8, (uint32_t)count);
+    put_u32(buf + 12, (uint32_t)sets);
+    put_u64(buf + 16, (uint64_t)fetched_at);
+    if (series)
+        strncpy((char *)buf + 24, series->symbol, 15);
+    put_u32(buf + 40, (uint32_t)dates_at);
+
+    *out_len = total;
+    return buf;
+}
@@ -1,153 +1,468 @@
 #include "stockc/market_history_json.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "yyjson.h"
+#include "../memory/arena.h"
+
+/*
+ * Chronological slice for a trailing `days` window (0 = full series):
+ * the tail of the series, clamped to its length.
+ */
+static void history_slice(const struct market_series *series,
+                          int days,
+                          size_t *start,
+                          size_t *count)
+{
+    size_t total_count = series->count;
+    size_t slice_count = total_count;
 
-char *
-market_build_history_with_metrics(const char *history_json, int days)
+    if (days > 0 && (size_t)days < total_count)
+        slice_count = (size_t)days;
+
+    *start = total_count - slice_count;
+    *count = slice_count;
+}
+
+static void add_metrics_fields(yyjson_mut_doc *mut,
+                               yyjson_mut_val *obj,
+                               const struct market_metrics *metrics)
 {
-    if (!history_json)
-        return NULL;
+    yyjson_mut_obj_add_real(mut, obj, "sharpe", metrics->sharpe);
+    yyjson_mut_obj_add_real(mut, obj, "sortino", metrics->sortino);
+    yyjson_mut_obj_add_real(mut, obj, "maxDrawdown", metrics->max_drawdown);
+    yyjson_mut_obj_add_real(mut, obj, "cagr", metrics->cagr);
+}
+
+/*
+ * Metrics for each trailing window: from the series index when it has
+ * one, otherwise in a single backward pass over the prices.
+ */
+static int compute_windows(const struct market_series *series,
+                           const int *windows,
+                           size_t window_count,
+                           struct market_metrics *out)
+{
+    size_t total_count = series->count;
+    size_t lens[MARKET_HISTORY_WINDOWS_MAX];
+
+    for (size_t i = 0; i < window_count; i++) {
+        size_t len = total_count;
+        if (windows[i] > 0 && (size_t)windows[i] < total_count)
+            len = (size_t)windows[i];
+        lens[i] = len;
+    }
+
+    if (!series->index)
+        return market_calculate_metrics_windows(
+            series->prices, total_count, lens, window_count, out);
+
+    for (size_t i = 0; i < window_count; i++) {
+        memset(&out[i], 0, sizeof(out[i]));
+        if (lens[i] < 2)
+            continue;
+
+        if (market_metrics_index_query(series->index,
+                                       total_count - lens[i], lens[i],
+                                       &out[i]) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Write one metrics object's fields, e.g. "sharpe":1.2,...
+ */
+static void write_metrics_fields(struct json_sink *out,
+                                 const struct market_metrics *metrics)
+{
+    json_sink_puts(out, "\"sharpe\":");
+    json_sink_real(out, metrics->sharpe);
+    json_sink_puts(out, ",\"sortino\":");
+    json_sink_real(out, metrics->sortino);
+    json_sink_puts(out, ",\"maxDrawdown\":");
+    json_sink_real(out, metrics->max_drawdown);
+    json_sink_puts(out, ",\"cagr\":");
+    json_sink_real(out, metrics->cagr);
+}
+
+// Longest point: {"date":"YYYY-MM-DD","price":<number>},
+#define POINT_MAX 96
+
+int market_history_metrics(const struct market_series *series,
+                           int days,
+                           const int *windows,
+                           size_t window_count,
+                           struct market_metrics *out)
+{
+    if (!series || !out ||
+        window_count > MARKET_HISTORY_WINDOWS_MAX ||
+        (window_count > 0 && !windows))
+        return -1;
+
+    if (series->count < 2)
+        return 0;
+
+    if (window_count > 0) {
+        if (compute_windows(series, windows, window_count, out) != 0)
+            return -1;
+        return (int)window_count;
+    }
 
     if (days < 0)
         days = 0;
 
-    yyjson_doc *doc = yyjson_read(history_json, strlen(history_json), 0);
-    if (!doc)
-        return NULL;
+    size_t chrono_start, slice_count;
+    history_slice(series, days, &chrono_start, &slice_count);
+
+    memset(&out[0], 0, sizeof(out[0]));
+    if (slice_count < 2)
+        return 1;
+
+    int rc = series->index
+        ? market_metrics_index_query(
+              series->index, chrono_start, slice_count, &out[0])
+        : market_calculate_metrics(series->prices + chrono_start,
+                                   slice_count, &out[0]);
+
+    return rc == 0 ? 1 : -1;
+}
+
+int market_write_history(struct json_sink *out,
+                         const struct market_series *series,
+                         int days,
+                         const int *windows,
+                         size_t window_count,
+                         const char *source,
+                         long long fetched_at)
+{
+    if (!series && !source)
+        return -1;
 
-    yyjson_val *root = yyjson_doc_get_root(doc);
-    yyjson_val *series = yyjson_obj_get(root, "series");
-    yyjson_val *symbol = yyjson_obj_get(root, "symbol");
+    if (window_count > MARKET_HISTORY_WINDOWS_MAX ||
+        (window_count > 0 && !windows))
+        return -1;
 
-    if (!series || !yyjson_is_arr(series)) {
-        yyjson_doc_free(doc);
-        return NULL;
+    json_sink_puts(out, "{");
+
+    if (source) {
+        json_sink_puts(out, "\"source\":");
+        json_sink_string(out, source);
+        json_sink_puts(out, ",\"fetchedAt\":");
+        json_sink_int(out, fetched_at);
+        json_sink_puts(out, ",");
     }
 
-    size_t total_count = yyjson_arr_size(series);
-    if (total_count < 2) {
-        yyjson_doc_free(doc);
-        return strdup(history_json);
+    if (!series) {
+        json_sink_puts(out, "\"series\":[]}");
+        return out->error ? -1 : 0;
     }
 
-    // ------------------------------------------------------------
-    // Determine safe slice window
-    // ------------------------------------------------------------
+    if (days < 0)
+        days = 0;
 
-    size_t slice_count = total_count;
+    size_t chrono_start, slice_count;
+    history_slice(series, days, &chrono_start, &slice_count);
+    const double *prices = series->prices + chrono_start;
+    const int32_t *dates = series->dates + chrono_start;
 
-    if (days > 0) {
-        if ((size_t)days > total_count)
-            slice_count = total_count;
-        else
-            slice_count = (size_t)days;
+    if (series->symbol[0] != '\0') {
+        json_sink_puts(out, "\"symbol\":");
+        json_sink_string(out, series->symbol);
+        json_sink_puts(out, ",");
     }
 
-    // Enforce minimum for metrics
-    int compute_metrics = 1;
-    if (slice_count < 2) {
-        compute_metrics = 0;
+    json_sink_puts(out, "\"series\":[");
+
+    // Output must remain reverse-chronological
+    for (size_t i = slice_count; i-- > 0; ) {
+        char *p = json_sink_reserve(out, POINT_MAX);
+        if (!p)
+            return -1;
+
+        if (i + 1 < slice_count)
+            *p++ = ',';
+
+        memcpy(p, "{\"date\":\"", 9);
+        p += 9;
+        market_date_format(dates[i], p);
+        p += 10;
+        memcpy(p, "\",\"price\":", 10);
+        p += 10;
+        json_sink_commit(out, p);
+
+        json_sink_real(out, prices[i]);
+        json_sink_puts(out, "}");
     }
 
-    // ------------------------------------------------------------
-    // Build chronological price array (slice only)
-    // ------------------------------------------------------------
+    json_sink_puts(out, "]");
+
+    // Metrics come last, so the series is already on its way while
+    // they are computed; a single-point series has no block
+    struct market_metrics metrics[MARKET_HISTORY_WINDOWS_MAX];
+    int sets = market_history_metrics(series, days, windows, window_count,
+                                      metrics);
+
+    if (sets > 0 && window_count > 0) {
+        // Keyed by the window as requested, e.g. "21" or "0"
+        json_sink_puts(out, ",\"metrics\":{");
+
+        for (size_t i = 0; i < window_count; i++) {
+            char key[24];
+            snprintf(key, sizeof(key), "%s\"%d\":{",
+                     i ? "," : "", windows[i]);
+            json_sink_puts(out, key);
+            write_metrics_fields(out, &metrics[i]);
+            json_sink_puts(out, "}");
+        }
 
-    double *prices = NULL;
-    struct market_metrics metrics;
-    memset(&metrics, 0, sizeof(metrics));
+        json_sink_puts(out, "}");
+    } else if (sets > 0) {
+        json_sink_puts(out, ",\"metrics\":{");
+        write_metrics_fields(out, &metrics[0]);
+        json_sink_puts(out, "}");
+    }
 
-    if (compute_metrics) {
-        prices = malloc(sizeof(double) * slice_count);
-        if (!prices) {
-            yyjson_doc_free(doc);
-            return NULL;
-        }
+    int rc = sets < 0 ? -1 : 0;
 
-        size_t chrono_start = total_count - slice_count;
+    json_sink_puts(out, "}");
 
-        for (size_t i = 0; i < slice_count; i++) {
-            size_t chrono_index = chrono_start + i;
-            size_t reverse_index = total_count - 1 - chrono_index;
+    if (rc != 0)
+        return -1;
 
-            yyjson_val *item = yyjson_arr_get(series, reverse_index);
-            yyjson_val *price = yyjson_obj_get(item, "price");
-            prices[i] = yyjson_get_real(price);
-        }
+    return out->error ? -1 : 0;
+}
+
+char *
+market_build_history_with_metrics(const struct market_series *series,
+                                  int days)
+{
+    return market_build_history_with_windows(series, days, NULL, 0);
+}
+
+char *
+market_build_history_with_windows(const struct market_series *series,
+                                  int days,
+                                  const int *windows,
+                                  size_t window_count)
+{
+    if (!series)
+        return NULL;
+
+    struct json_sink out;
+    json_sink_init_arena(&out, 256 + series->count * 48);
+
+    if (market_write_history(&out, series, days, windows, window_count,
+                             NULL, 0) != 0)
+        return NULL;
+
+    if (json_sink_finish(&out) != 0)
+        return NULL;
+
+    return out.buf;
+}
 
-        if (market_calculate_metrics(prices, slice_count, &metrics) != 0) {
-            free(prices);
-            yyjson_doc_free(doc);
+
+char *
+market_build_rolling_json(const struct market_series *series,
+                          int days,
+                          size_t window,
+                          unsigned stats)
+{
+    if (!series || window < 2 || !(stats & MARKET_ROLLING_ALL))
+        return NULL;
+
+    if (days < 0)
+        days = 0;
+
+    size_t chrono_start, slice_count;
+    history_slice(series, days, &chrono_start, &slice_count);
+
+    // Each emitted point needs window - 1 earlier prices behind it
+    size_t calc_start =
+        chrono_start >= window - 1 ? chrono_start - (window - 1) : 0;
+    size_t calc_count = series->count - calc_start;
+
+    size_t points = calc_count >= window ? calc_count - window + 1 : 0;
+    if (points > slice_count)
+        points = slice_count;
+
+    double *values = NULL;
+    double *vol = NULL, *sharpe = NULL, *drawdown = NULL;
+
+    if (points > 0) {
+        size_t all = calc_count - window + 1;
+        values = arena_alloc(3 * all * sizeof(double));
+        if (!values)
             return NULL;
-        }
 
-        free(prices);
+        if (stats & MARKET_ROLLING_VOL)      vol = values;
+        if (stats & MARKET_ROLLING_SHARPE)   sharpe = values + all;
+        if (stats & MARKET_ROLLING_DRAWDOWN) drawdown = values + 2 * all;
+
+        if (market_calculate_rolling(series->prices + calc_start,
+                                     calc_count, window,
+                                     vol, sharpe, drawdown) < 0)
+            return NULL;
     }
 
-    // ------------------------------------------------------------
-    // Build new JSON
-    // ------------------------------------------------------------
+    yyjson_mut_doc *mut = yyjson_mut_doc_new(arena_yyjson_alc());
+    if (!mut)
+        return NULL;
 
-    yyjson_mut_doc *mut = yyjson_mut_doc_new(NULL);
     yyjson_mut_val *mut_root = yyjson_mut_obj(mut);
     yyjson_mut_doc_set_root(mut, mut_root);
 
-    if (symbol && yyjson_is_str(symbol)) {
-        yyjson_mut_obj_add_str(
-            mut,
-            mut_root,
-            "symbol",
-            yyjson_get_str(symbol)
-        );
-    }
+    if (series->symbol[0] != '\0')
+        yyjson_mut_obj_add_str(mut, mut_root, "symbol", series->symbol);
+
+    yyjson_mut_obj_add_uint(mut, mut_root, "window", window);
 
     yyjson_mut_val *mut_series =
         yyjson_mut_obj_add_arr(mut, mut_root, "series");
 
-    // Output must remain reverse-chronological
-    for (size_t i = 0; i < slice_count; i++) {
-        yyjson_val *item =
-            yyjson_arr_get(series, i);
+    // Point k ends at price calc_start + k + window - 1; the last
+    // `points` of them are emitted, newest first like history
+    size_t all = points > 0 ? calc_count - window + 1 : 0;
 
-        yyjson_val *date = yyjson_obj_get(item, "date");
-        yyjson_val *price = yyjson_obj_get(item, "price");
+    for (size_t k = all; k-- > all - points; ) {
+        char date[11];
+        market_date_format(series->dates[calc_start + k + window - 1], date);
 
         yyjson_mut_val *mut_item =
             yyjson_mut_arr_add_obj(mut, mut_series);
 
-        if (date && yyjson_is_str(date)) {
-            yyjson_mut_obj_add_str(
-                mut,
-                mut_item,
-                "date",
-                yyjson_get_str(date)
-            );
-        }
+        yyjson_mut_obj_add_strncpy(mut, mut_item, "date", date, 10);
+        if (vol)
+            yyjson_mut_obj_add_real(mut, mut_item, "vol", vol[k]);
+        if (sharpe)
+            yyjson_mut_obj_add_real(mut, mut_item, "sharpe", sharpe[k]);
+        if (drawdown)
+            yyjson_mut_obj_add_real(mut, mut_item, "drawdown", drawdown[k]);
+    }
+
+    char *out = yyjson_mut_write_opts(mut, 0, arena_yyjson_alc(), NULL, NULL);
+
+    yyjson_mut_doc_free(mut);
+
+    return out;
+}
+
+
+char *
+market_build_correlation_json(const char *const *symbols,
+                              const char *const *sources,
+                              size_t n,
+                              size_t points,
+                              const char *stat,
+                              const double *packed)
+{
+    if (!symbols || !sources || !stat || !packed)
+        return NULL;
 
-        yyjson_mut_obj_add_real(
-            mut,
-            mut_item,
-            "price",
-            yyjson_get_real(price)
-        );
+    yyjson_mut_doc *mut = yyjson_mut_doc_new(arena_yyjson_alc());
+    if (!mut)
+        return NULL;
+
+    yyjson_mut_val *mut_root = yyjson_mut_obj(mut);
+    yyjson_mut_doc_set_root(mut, mut_root);
+
+    yyjson_mut_val *mut_symbols =
+        yyjson_mut_obj_add_arr(mut, mut_root, "symbols");
+    yyjson_mut_val *mut_sources =
+        yyjson_mut_obj_add_arr(mut, mut_root, "sources");
+
+    for (size_t i = 0; i < n; i++) {
+        yyjson_mut_arr_add_str(mut, mut_symbols, symbols[i]);
+        yyjson_mut_arr_add_str(mut, mut_sources, sources[i]);
     }
 
-    yyjson_mut_val *metrics_obj =
-        yyjson_mut_obj_add_obj(mut, mut_root, "metrics");
+    yyjson_mut_obj_add_uint(mut, mut_root, "points", points);
+    yyjson_mut_obj_add_str(mut, mut_root, "layout", "upper");
+
+    yyjson_mut_val *mut_matrix = yyjson_mut_obj_add_arr(mut, mut_root, stat);
+
+    for (size_t k = 0; k < MARKET_PACKED_SIZE(n); k++)
+        yyjson_mut_arr_add_real(mut, mut_matrix, packed[k]);
 
-    yyjson_mut_obj_add_real(mut, metrics_obj, "sharpe", metrics.sharpe);
-    yyjson_mut_obj_add_real(mut, metrics_obj, "sortino", metrics.sortino);
-    yyjson_mut_obj_add_real(
-        mut, metrics_obj, "maxDrawdown", metrics.max_drawdown);
-    yyjson_mut_obj_add_real(mut, metrics_obj, "cagr", metrics.cagr);
+    char *out = yyjson_mut_write_opts(mut, 0, arena_yyjson_alc(), NULL, NULL);
+
+    yyjson_mut_doc_free(mut);
+
+    return out;
+}
+
+
+char *
+market_build_portfolio_json(const struct market_series *portfolio,
+                            const char *const *symbols,
+                            const double *weights,
+                            const char *const *sources,
+                            size_t n)
+{
+    if (!portfolio || !symbols || !weights || !sources)
+        return NULL;
+
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++)
+        total += weights[i];
+
+    struct market_metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+
+    int emit_metrics = portfolio->count >= 2;
+    if (emit_metrics &&
+        market_calculate_metrics(portfolio->prices, portfolio->count,
+                                 &metrics) != 0)
+        return NULL;
+
+    yyjson_mut_doc *mut = yyjson_mut_doc_new(arena_yyjson_alc());
+    if (!mut)
+        return NULL;
+
+    yyjson_mut_val *mut_root = yyjson_mut_obj(mut);
+    yyjson_mut_doc_set_root(mut, mut_root);
+
+    yyjson_mut_val *mut_positions =
+        yyjson_mut_obj_add_arr(mut, mut_root, "positions");
+
+    for (size_t i = 0; i < n; i++) {
+        yyjson_mut_val *mut_item =
+            yyjson_mut_arr_add_obj(mut, mut_positions);
+
+        yyjson_mut_obj_add_str(mut, mut_item, "symbol", symbols[i]);
+        yyjson_mut_obj_add_real(mut, mut_item, "weight", weights[i] / total);
+        yyjson_mut_obj_add_str(mut, mut_item, "source", sources[i]);
+    }
+
+    yyjson_mut_val *mut_series =
+        yyjson_mut_obj_add_arr(mut, mut_root, "series");
+
+    // Reverse-chronological, like history
+    for (size_t i = portfolio->count; i-- > 0; ) {
+        char date[11];
+        market_date_format(portfolio->dates[i], date);
+
+        yyjson_mut_val *mut_item =
+            yyjson_mut_arr_add_obj(mut, mut_series);
+
+        yyjson_mut_obj_add_strncpy(mut, mut_item, "date", date, 10);
+        yyjson_mut_obj_add_real(mut, mut_item, "value", portfolio->prices[i]);
+    }
+
+    if (emit_metrics) {
+        yyjson_mut_val *metrics_obj =
+            yyjson_mut_obj_add_obj(mut, mut_root, "metrics");
+
+        add_metrics_fields(mut, metrics_obj, &metrics);
+    }
 
-    char *out = yyjson_mut_write(mut, 0, NULL);
+    char *out = yyjson_mut_write_opts(mut, 0, arena_yyjson_alc(), NULL, NULL);
 
     yyjson_mut_doc_free(mut);
-    yyjson_doc_free(doc);
 
     return out;
-}
\ No newline at end of file
+}
@@ -1,43 +1,24 @@
 #include "stockc/market_metrics.h"
 
 #include <math.h>
-
-int market_calculate_metrics(
-    const double *prices,
-    size_t count,
-    struct market_metrics *out
-)
+#include <stdlib.h>
+#include <string.h>
+
+#include "market_metrics_kernel.h"
+
+/*
+ * Turn raw sums into the published ratios.
+ */
+static void metrics_from_sums(const double *prices,
+                              size_t count,
+                              const struct metrics_sums *sums,
+                              struct market_metrics *out)
 {
-    if (!prices || !out || count < 2)
-        return -1;
-
-    double returns_sum = 0.0;
-    double returns_sq_sum = 0.0;
-
-    double downside_sq_sum = 0.0;
-    size_t downside_count = 0;
-
-    double peak = prices[0];
-    double max_drawdown = 0.0;
-
-    for (size_t i = 1; i < count; i++) {
-        double r = (prices[i] / prices[i - 1]) - 1.0;
-
-        returns_sum += r;
-        returns_sq_sum += r * r;
-
-        if (r < 0.0) {
-            downside_sq_sum += r * r;
-            downside_count++;
-        }
-
-        if (prices[i] > peak)
-            peak = prices[i];
-
-        double drawdown = (prices[i] - peak) / peak;
-        if (drawdown < max_drawdown)
-            max_drawdown = drawdown;
-    }
+    double returns_sum = sums->ret_sum;
+    double returns_sq_sum = sums->ret_sq_sum;
+    double downside_sq_sum = sums->down_sq_sum;
+    size_t downside_count = sums->down_count;
+    double max_drawdown = sums->max_drawdown;
 
     double mean = returns_sum / (count - 1);
     double variance =
@@ -68,6 +49,154 @@ int market_calculate_metrics(
         years > 0.0
             ? pow(prices[count - 1] / prices[0], 1.0 / years) - 1.0
             : 0.0;
+}
+
+int market_calculate_metrics(
+    const double *prices,
+    size_t count,
+    struct market_metrics *out
+)
+{
+    if (!prices || !out || count < 2)
+        return -1;
+
+    struct metrics_sums sums;
+    metrics_kernel_get()(prices, count, &sums);
+
+    metrics_from_sums(prices, count, &sums, out);
+    return 0;
+}
+
+int market_calculate_metrics_batch(
+    const double *const *prices,
+    const size_t *counts,
+    size_t n,
+    struct market_metrics *out
+)
+{
+    if (!prices || !counts || !out)
+        return -1;
+
+    metrics_kernel_fn kernel = metrics_kernel_get();
+    int failed = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!prices[i] || counts[i] < 2) {
+            memset(&out[i], 0, sizeof(out[i]));
+            failed = 1;
+            continue;
+        }
+
+        struct metrics_sums sums;
+        kernel(prices[i], counts[i], &sums);
+        metrics_from_sums(prices[i], counts[i], &sums, &out[i]);
+    }
+
+    return failed ? -1 : 0;
+}
+
+/*
+ * Candidate peak for the backward pass: a forward running-max record
+ * of the current suffix, the lowest price it covers before the next
+ * record, and the worst drawdown of it and every later record.
+ */
+struct peak_record {
+    double peak;
+    double seg_min;
+    double worst_dd;
+};
+
+static size_t effective_window(size_t window, size_t count)
+{
+    return window == 0 || window > count ? count : window;
+}
+
+int market_calculate_metrics_windows(
+    const double *prices,
+    size_t count,
+    const size_t *windows,
+    size_t n,
+    struct market_metrics *out
+)
+{
+    if (!prices || !windows || !out || count == 0)
+        return -1;
+
+    size_t *order = malloc((n ? n : 1) * sizeof(*order));
+    struct peak_record *stack = malloc(count * sizeof(*stack));
+
+    if (!order || !stack) {
+        free(order);
+        free(stack);
+        return -1;
+    }
+
+    // Windows by trailing length, shortest first
+    for (size_t i = 0; i < n; i++) {
+        size_t j = i;
+        size_t len = effective_window(windows[i], count);
+        while (j > 0 && effective_window(windows[order[j - 1]], count) > len) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    struct metrics_sums sums;
+    memset(&sums, 0, sizeof(sums));
+
+    size_t depth = 0;
+    size_t next = 0;
+
+    // Walk from the newest price back; each step extends the suffix by
+    // one older price and snapshots any window of that length
+    for (size_t s = count; s-- > 0 && next < n; ) {
+        if (s + 1 < count) {
+            double r = (prices[s + 1] / prices[s]) - 1.0;
+
+            sums.ret_sum += r;
+            sums.ret_sq_sum += r * r;
+
+            if (r < 0.0) {
+                sums.down_sq_sum += r * r;
+                sums.down_count++;
+            }
+        }
+
+        // prices[s] becomes the first peak; records it dominates merge
+        // into its segment
+        double seg_min = prices[s];
+        while (depth > 0 && stack[depth - 1].peak <= prices[s]) {
+            if (stack[depth - 1].seg_min < seg_min)
+                seg_min = stack[depth - 1].seg_min;
+            depth--;
+        }
+
+        double dd = (seg_min - prices[s]) / prices[s];
+        if (depth > 0 && stack[depth - 1].worst_dd < dd)
+            dd = stack[depth - 1].worst_dd;
+
+        stack[depth].peak = prices[s];
+        stack[depth].seg_min = seg_min;
+        stack[depth].worst_dd = dd;
+        depth++;
+
+        size_t len = count - s;
+
+        while (next < n && effective_window(windows[order[next]], count) <= len) {
+            struct market_metrics *m = &out[order[next]];
+
+            if (len < 2) {
+                memset(m, 0, sizeof(*m));
+            } else {
+                sums.max_drawdown = dd;
+                metrics_from_sums(prices + s, len, &sums, m);
+            }
+            next++;
+        }
+    }
 
+    free(stack);
+    free(order);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,227 @@
+#include "stockc/market_metrics.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Windows this short are cheaper to recompute than to trust to
+// differenced prefix sums
+#define INDEX_DIRECT_MAX_POINTS 64
+
+/*
+ * Segment tree node over a price range.
+ * dd is the worst (p_j - p_i) / p_i for i <= j inside the range,
+ * which is exactly the running-peak drawdown market_calculate_metrics
+ * computes.
+ */
+struct dd_node {
+    double max;
+    double min;
+    double dd;
+};
+
+struct market_metrics_index {
+    size_t count;
+
+    // Prefix arrays, entry i covers returns r_1 .. r_i (entry 0 is 0)
+    double *ret_sum;
+    double *ret_sq_sum;
+    double *down_sq_sum;
+    uint32_t *down_count;
+
+    double *prices;         // own copy, for CAGR endpoints
+    struct dd_node *tree;   // 2 * count nodes, leaves at [count, 2 * count)
+};
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static struct dd_node dd_combine(struct dd_node l, struct dd_node r)
+{
+    struct dd_node out;
+    out.max = l.max > r.max ? l.max : r.max;
+    out.min = l.min < r.min ? l.min : r.min;
+
+    double cross = (r.min - l.max) / l.max;
+    out.dd = l.dd < r.dd ? l.dd : r.dd;
+    if (cross < out.dd)
+        out.dd = cross;
+
+    return out;
+}
+
+static struct dd_node tree_query(const struct market_metrics_index *ix,
+                                 size_t lo, size_t hi)
+{
+    // Non-commutative combine: keep separate left and right accumulators
+    struct dd_node left = {0}, right = {0};
+    int has_left = 0, has_right = 0;
+
+    size_t n = ix->count;
+    for (lo += n, hi += n; lo < hi; lo >>= 1, hi >>= 1) {
+        if (lo & 1) {
+            left = has_left ? dd_combine(left, ix->tree[lo]) : ix->tree[lo];
+            has_left = 1;
+            lo++;
+        }
+        if (hi & 1) {
+            hi--;
+            right = has_right ? dd_combine(ix->tree[hi], right) : ix->tree[hi];
+            has_right = 1;
+        }
+    }
+
+    if (!has_left)
+        return right;
+    if (!has_right)
+        return left;
+    return dd_combine(left, right);
+}
+
+
+// ------------------------------------------------------------
+// Index API
+// ------------------------------------------------------------
+
+struct market_metrics_index *market_metrics_index_build(
+    const double *prices,
+    size_t count
+)
+{
+    if (!prices || count < 2)
+        return NULL;
+
+    struct market_metrics_index *ix = calloc(1, sizeof(*ix));
+    if (!ix)
+        return NULL;
+
+    ix->count = count;
+    ix->ret_sum = malloc(count * sizeof(double));
+    ix->ret_sq_sum = malloc(count * sizeof(double));
+    ix->down_sq_sum = malloc(count * sizeof(double));
+    ix->down_count = malloc(count * sizeof(uint32_t));
+    ix->prices = malloc(count * sizeof(double));
+    ix->tree = malloc(2 * count * sizeof(struct dd_node));
+
+    if (!ix->ret_sum || !ix->ret_sq_sum || !ix->down_sq_sum ||
+        !ix->down_count || !ix->prices || !ix->tree) {
+        market_metrics_index_free(ix);
+        return NULL;
+    }
+
+    ix->ret_sum[0] = 0.0;
+    ix->ret_sq_sum[0] = 0.0;
+    ix->down_sq_sum[0] = 0.0;
+    ix->down_count[0] = 0;
+    ix->prices[0] = prices[0];
+
+    for (size_t i = 1; i < count; i++) {
+        double r = (prices[i] / prices[i - 1]) - 1.0;
+        int down = r < 0.0;
+
+        ix->ret_sum[i] = ix->ret_sum[i - 1] + r;
+        ix->ret_sq_sum[i] = ix->ret_sq_sum[i - 1] + r * r;
+        ix->down_sq_sum[i] = ix->down_sq_sum[i - 1] + (down ? r * r : 0.0);
+        ix->down_count[i] = ix->down_count[i - 1] + (uint32_t)down;
+        ix->prices[i] = prices[i];
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ix->tree[count + i].max = prices[i];
+        ix->tree[count + i].min = prices[i];
+        ix->tree[count + i].dd = 0.0;
+    }
+    for (size_t i = count - 1; i > 0; i--)
+        ix->tree[i] = dd_combine(ix->tree[2 * i], ix->tree[2 * i + 1]);
+
+    return ix;
+}
+
+void market_metrics_index_free(struct market_metrics_index *index)
+{
+    if (!index)
+        return;
+
+    free(index->ret_sum);
+    free(index->ret_sq_sum);
+    free(index->down_sq_sum);
+    free(index->down_count);
+    free(index->prices);
+    free(index->tree);
+    free(index);
+}
+
+int market_metrics_index_query(
+    const struct market_metrics_index *index,
+    size_t start,
+    size_t count,
+    struct market_metrics *out
+)
+{
+    if (!index || !out || count < 2 || start + count > index->count)
+        return -1;
+
+    if (count <= INDEX_DIRECT_MAX_POINTS)
+        return market_calculate_metrics(index->prices + start, count, out);
+
+    size_t last = start + count - 1;
+    size_t n_returns = count - 1;
+
+    double returns_sum = index->ret_sum[last] - index->ret_sum[start];
+    double returns_sq_sum = index->ret_sq_sum[last] - index->ret_sq_sum[start];
+    double downside_sq_sum = index->down_sq_sum[last] - index->down_sq_sum[start];
+    uint32_t downside_count = index->down_count[last] - index->down_count[start];
+
+    double mean = returns_sum / n_returns;
+    double mean_sq = returns_sq_sum / n_returns;
+    double variance = mean_sq - (mean * mean);
+
+    // Differencing prefix sums leaves rounding noise proportional to
+    // the running totals, not to this window: anything below that
+    // bound is no variance at all
+    double noise = (index->ret_sq_sum[last] + index->ret_sq_sum[start])
+                 * (double)last * DBL_EPSILON / (double)n_returns;
+    if (variance <= noise)
+        variance = 0.0;
+
+    double stddev = variance > 0.0 ? sqrt(variance) : 0.0;
+
+    double downside_stddev = 0.0;
+    if (downside_count > 0 && downside_sq_sum > 0.0) {
+        downside_stddev =
+            sqrt(downside_sq_sum / downside_count);
+    }
+
+    out->sharpe =
+        stddev > 0.0
+            ? (mean / stddev) * sqrt(TRADING_DAYS_PER_YEAR)
+            : 0.0;
+
+    out->sortino =
+        downside_stddev > 0.0
+            ? (mean / downside_stddev) * sqrt(TRADING_DAYS_PER_YEAR)
+            : 0.0;
+
+    out->max_drawdown = tree_query(index, start, last + 1).dd;
+
+    double years = (double)count / TRADING_DAYS_PER_YEAR;
+    out->cagr =
+        years > 0.0
+            ? pow(index->prices[last] / index->prices[start], 1.0 / years) - 1.0
+            : 0.0;
+
+    return 0;
+}
+
+size_t market_metrics_index_bytes(const struct market_metrics_index *index)
+{
+    if (!index)
+        return 0;
+
+    return sizeof(*index)
+         + index->count * (4 * sizeof(double) + sizeof(uint32_t))
+         + 2 * index->count * sizeof(struct dd_node);
+}
@@ -0,0 +1,270 @@
+#include "market_metrics_kernel.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+static metrics_kernel_fn selected_kernel = NULL;
+static const char *selected_name = "scalar";
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+
+// ------------------------------------------------------------
+// Scalar
+// ------------------------------------------------------------
+
+static void kernel_scalar(const double *prices,
+                          size_t count,
+                          struct metrics_sums *out)
+{
+    double returns_sum = 0.0;
+    double returns_sq_sum = 0.0;
+
+    double downside_sq_sum = 0.0;
+    size_t downside_count = 0;
+
+    double peak = prices[0];
+    double max_drawdown = 0.0;
+
+    for (size_t i = 1; i < count; i++) {
+        double r = (prices[i] / prices[i - 1]) - 1.0;
+
+        returns_sum += r;
+        returns_sq_sum += r * r;
+
+        if (r < 0.0) {
+            downside_sq_sum += r * r;
+            downside_count++;
+        }
+
+        if (prices[i] > peak)
+            peak = prices[i];
+
+        double drawdown = (prices[i] - peak) / peak;
+        if (drawdown < max_drawdown)
+            max_drawdown = drawdown;
+    }
+
+    out->ret_sum = returns_sum;
+    out->ret_sq_sum = returns_sq_sum;
+    out->down_sq_sum = downside_sq_sum;
+    out->down_count = downside_count;
+    out->max_drawdown = max_drawdown;
+}
+
+/*
+ * Finish elements [from, count) on the scalar path, continuing from
+ * the running peak of a vector loop.
+ */
+static void scalar_tail(const double *prices,
+                        size_t from,
+                        size_t count,
+                        double peak,
+                        struct metrics_sums *acc)
+{
+    for (size_t i = from; i < count; i++) {
+        double r = (prices[i] / prices[i - 1]) - 1.0;
+
+        acc->ret_sum += r;
+        acc->ret_sq_sum += r * r;
+
+        if (r < 0.0) {
+            acc->down_sq_sum += r * r;
+            acc->down_count++;
+        }
+
+        if (prices[i] > peak)
+            peak = prices[i];
+
+        double drawdown = (prices[i] - peak) / peak;
+        if (drawdown < acc->max_drawdown)
+            acc->max_drawdown = drawdown;
+    }
+}
+
+
+#ifdef HAVE_X86_KERNELS
+
+// ------------------------------------------------------------
+// SSE2 (2 lanes)
+// ------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static void kernel_sse2(const double *prices,
+                        size_t count,
+                        struct metrics_sums *out)
+{
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d neg_inf = _mm_set1_pd(-INFINITY);
+
+    __m128d sum = zero, sq = zero, down_sq = zero, min_dd = zero;
+    __m128d peak = _mm_set1_pd(prices[0]);
+    size_t down_count = 0;
+
+    size_t i = 1;
+    for (; i + 2 <= count; i += 2) {
+        __m128d p = _mm_loadu_pd(prices + i);
+        __m128d prev = _mm_loadu_pd(prices + i - 1);
+
+        __m128d r = _mm_sub_pd(_mm_div_pd(p, prev), one);
+        __m128d r2 = _mm_mul_pd(r, r);
+        sum = _mm_add_pd(sum, r);
+        sq = _mm_add_pd(sq, r2);
+
+        __m128d neg = _mm_cmplt_pd(r, zero);
+        down_sq = _mm_add_pd(down_sq, _mm_and_pd(neg, r2));
+        down_count += (size_t)__builtin_popcount(_mm_movemask_pd(neg));
+
+        // Running peak: in-register prefix max, then the carried peak
+        __m128d shifted = _mm_unpacklo_pd(neg_inf, p);
+        __m128d run = _mm_max_pd(_mm_max_pd(p, shifted), peak);
+        peak = _mm_unpackhi_pd(run, run);
+
+        __m128d dd = _mm_div_pd(_mm_sub_pd(p, run), run);
+        min_dd = _mm_min_pd(min_dd, dd);
+    }
+
+    double lanes[2];
+
+    _mm_storeu_pd(lanes, sum);
+    out->ret_sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, sq);
+    out->ret_sq_sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, down_sq);
+    out->down_sq_sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, min_dd);
+    out->max_drawdown = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    out->down_count = down_count;
+
+    _mm_storeu_pd(lanes, peak);
+    scalar_tail(prices, i, count, lanes[0], out);
+}
+
+
+// ------------------------------------------------------------
+// AVX2 (4 lanes)
+// ------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static double hsum256(__m256d v)
+{
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2")))
+static double hmin256(__m256d v)
+{
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_min_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_min_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2")))
+static void kernel_avx2(const double *prices,
+                        size_t count,
+                        struct metrics_sums *out)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d neg_inf = _mm256_set1_pd(-INFINITY);
+
+    __m256d sum = zero, sq = zero, down_sq = zero, min_dd = zero;
+    __m256d peak = _mm256_set1_pd(prices[0]);
+    size_t down_count = 0;
+
+    size_t i = 1;
+    for (; i + 4 <= count; i += 4) {
+        __m256d p = _mm256_loadu_pd(prices + i);
+        __m256d prev = _mm256_loadu_pd(prices + i - 1);
+
+        __m256d r = _mm256_sub_pd(_mm256_div_pd(p, prev), one);
+        __m256d r2 = _mm256_mul_pd(r, r);
+        sum = _mm256_add_pd(sum, r);
+        sq = _mm256_add_pd(sq, r2);
+
+        __m256d neg = _mm256_cmp_pd(r, zero, _CMP_LT_OQ);
+        down_sq = _mm256_add_pd(down_sq, _mm256_and_pd(neg, r2));
+        down_count += (size_t)__builtin_popcount(_mm256_movemask_pd(neg));
+
+        // Running peak: log-step prefix max across lanes, then the
+        // peak carried from the previous block
+        __m256d run = p;
+        __m256d s1 = _mm256_blend_pd(
+            _mm256_permute4x64_pd(run, _MM_SHUFFLE(2, 1, 0, 0)), neg_inf, 0x1);
+        run = _mm256_max_pd(run, s1);
+        __m256d s2 = _mm256_blend_pd(
+            _mm256_permute4x64_pd(run, _MM_SHUFFLE(1, 0, 0, 0)), neg_inf, 0x3);
+        run = _mm256_max_pd(_mm256_max_pd(run, s2), peak);
+        peak = _mm256_permute4x64_pd(run, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m256d dd = _mm256_div_pd(_mm256_sub_pd(p, run), run);
+        min_dd = _mm256_min_pd(min_dd, dd);
+    }
+
+    out->ret_sum = hsum256(sum);
+    out->ret_sq_sum = hsum256(sq);
+    out->down_sq_sum = hsum256(down_sq);
+    out->down_count = down_count;
+    out->max_drawdown = hmin256(min_dd);
+
+    scalar_tail(prices, i, count,
+                _mm256_cvtsd_f64(peak), out);
+}
+
+#endif  /* HAVE_X86_KERNELS */
+
+
+// ------------------------------------------------------------
+// Dispatch
+// ------------------------------------------------------------
+
+static void select_kernel(void)
+{
+    const char *want = getenv("STOCKC_METRICS_KERNEL");
+
+    selected_kernel = kernel_scalar;
+    selected_name = "scalar";
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+
+    int sse2 = __builtin_cpu_supports("sse2");
+    int avx2 = __builtin_cpu_supports("avx2");
+
+    if (want && strcmp(want, "scalar") == 0)
+        return;
+
+    if (avx2 && !(want && strcmp(want, "sse2") == 0)) {
+        selected_kernel = kernel_avx2;
+        selected_name = "avx2";
+    } else if (sse2) {
+        selected_kernel = kernel_sse2;
+        selected_name = "sse2";
+    }
+#else
+    (void)want;
+#endif
+}
+
+metrics_kernel_fn metrics_kernel_get(void)
+{
+    pthread_once(&select_once, select_kernel);
+    return selected_kernel;
+}
+
+const char *metrics_kernel_name(void)
+{
+    pthread_once(&select_once, select_kernel);
+    return selected_name;
+}
@@ -0,0 +1,45 @@
+#ifndef STOCKC_MARKET_METRICS_KERNEL_H
+#define STOCKC_MARKET_METRICS_KERNEL_H
+
+#include <stddef.h>
+
+/*
+ * Single-pass accumulation kernels behind market_calculate_metrics.
+ *
+ * Each kernel walks a chronological price array once and produces the
+ * raw sums the metrics are derived from. Scalar, SSE2 and AVX2 builds
+ * are compiled into the same binary (x86 only for the vector ones) and
+ * one is chosen at first use from the CPU's features.
+ *
+ * Vector kernels keep per-lane partial sums, so return sums may differ
+ * from the scalar kernel in the last few ulps; the drawdown is exact.
+ *
+ * Configuration (read once, on first use):
+ *   STOCKC_METRICS_KERNEL  force "scalar", "sse2" or "avx2" (ignored
+ *                          when the CPU lacks it)
+ */
+
+struct metrics_sums {
+    double ret_sum;         // sum of simple returns
+    double ret_sq_sum;      // sum of squared returns
+    double down_sq_sum;     // sum of squared negative returns
+    size_t down_count;      // number of negative returns
+    double max_drawdown;    // most negative (price - peak) / peak, <= 0
+};
+
+typedef void (*metrics_kernel_fn)(const double *prices,
+                                  size_t count,
+                                  struct metrics_sums *out);
+
+/*
+ * The kernel for this CPU. count must be >= 2.
+ */
+metrics_kernel_fn metrics_kernel_get(void);
+
+/*
+ * Name of the kernel metrics_kernel_get returns ("scalar", "sse2",
+ * "avx2").
+ */
+const char *metrics_kernel_name(void);
+
+#endif
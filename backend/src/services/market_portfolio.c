@@ -0,0 +1,62 @@
+#include "stockc/market_portfolio.h"
+#include "stockc/market_align.h"
+
+#include <stdlib.h>
+
+struct market_series *market_portfolio_series(
+    const char *name,
+    const struct market_series *const *series,
+    const double *weights,
+    size_t n,
+    size_t days
+)
+{
+    if (!series || !weights || n == 0)
+        return NULL;
+
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++)
+        total += weights[i];
+
+    if (!(total > 0.0))
+        return NULL;
+
+    struct market_align align;
+    if (market_align_init(&align, series, n, days) != 0)
+        return NULL;
+
+    struct market_series *out = market_series_create(name, align.count);
+
+    // Units held per position: weight / starting price
+    double *units = malloc(n * sizeof(*units));
+
+    if (!out || !units) {
+        market_series_release(out);
+        free(units);
+        market_align_free(&align);
+        return NULL;
+    }
+
+    size_t t = 0;
+
+    while (market_align_next(&align)) {
+        double value = 0.0;
+
+        for (size_t i = 0; i < n; i++) {
+            double p = series[i]->prices[align.pos[i]];
+            if (t == 0)
+                units[i] = (weights[i] / total) / p;
+            value += units[i] * p;
+        }
+
+        out->dates[t] = align.date;
+        out->prices[t] = value;
+        t++;
+    }
+
+    out->count = t;
+
+    free(units);
+    market_align_free(&align);
+    return out;
+}
@@ -0,0 +1,116 @@
+#include "stockc/market_rolling.h"
+#include "stockc/market_metrics.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "market_metrics_kernel.h"
+#include "../memory/arena.h"
+
+// As in the metrics index: windows this short are cheaper to
+// recompute than to trust to sliding sums
+#define ROLLING_DIRECT_MAX_POINTS 64
+
+long market_calculate_rolling(
+    const double *prices,
+    size_t count,
+    size_t window,
+    double *vol,
+    double *sharpe,
+    double *drawdown
+)
+{
+    if (!prices || window < 2 || window > count)
+        return -1;
+
+    // Ring of indices with strictly decreasing prices; the front is
+    // the peak of the current window. Scratch only: rewound on return
+    struct arena_mark mark = arena_mark();
+    size_t *deque = NULL;
+    if (drawdown) {
+        deque = arena_alloc(window * sizeof(*deque));
+        if (!deque)
+            return -1;
+    }
+
+    size_t head = 0, len = 0;
+    double sum = 0.0, sq = 0.0;
+    double sq_added = 0.0, sq_removed = 0.0;
+    double n_returns = (double)(window - 1);
+    double annualize = sqrt(TRADING_DAYS_PER_YEAR);
+    int direct = window <= ROLLING_DIRECT_MAX_POINTS;
+    metrics_kernel_fn kernel = metrics_kernel_get();
+
+    for (size_t t = 0; t < count; t++) {
+        if (t >= 1 && !direct) {
+            double r = (prices[t] / prices[t - 1]) - 1.0;
+            sum += r;
+            sq += r * r;
+            sq_added += r * r;
+        }
+
+        // Return t - window + 1 just left the window
+        if (t >= window && !direct) {
+            size_t o = t - window + 1;
+            double r = (prices[o] / prices[o - 1]) - 1.0;
+            sum -= r;
+            sq -= r * r;
+            sq_removed += r * r;
+        }
+
+        if (deque) {
+            if (len > 0 && deque[head] + window <= t) {
+                head = (head + 1) % window;
+                len--;
+            }
+
+            while (len > 0 &&
+                   prices[deque[(head + len - 1) % window]] <= prices[t])
+                len--;
+            deque[(head + len) % window] = t;
+            len++;
+        }
+
+        if (t + 1 < window)
+            continue;
+
+        size_t k = t + 1 - window;
+
+        double mean, variance;
+
+        if (direct) {
+            // Same sums, in the same order, as market_calculate_metrics
+            struct metrics_sums sums;
+            kernel(prices + k, window, &sums);
+            mean = sums.ret_sum / n_returns;
+            variance = (sums.ret_sq_sum / n_returns) - (mean * mean);
+        } else {
+            mean = sum / n_returns;
+            variance = (sq / n_returns) - (mean * mean);
+
+            // Sliding sums carry rounding noise proportional to
+            // everything that passed through them, not to this
+            // window: anything below that bound is no variance at all
+            double noise = (sq_added + sq_removed)
+                         * (double)t * DBL_EPSILON / n_returns;
+            if (variance <= noise)
+                variance = 0.0;
+        }
+
+        double stddev = variance > 0.0 ? sqrt(variance) : 0.0;
+
+        if (vol)
+            vol[k] = stddev * annualize;
+
+        if (sharpe)
+            sharpe[k] = stddev > 0.0 ? (mean / stddev) * annualize : 0.0;
+
+        if (drawdown) {
+            double peak = prices[deque[head]];
+            drawdown[k] = (prices[t] - peak) / peak;
+        }
+    }
+
+    arena_rewind(mark);
+    return (long)(count - window + 1);
+}
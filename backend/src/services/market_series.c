@@ -0,0 +1,159 @@
+#include "stockc/market_series.h"
+#include "stockc/market_metrics.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ------------------------------------------------------------
+// Lifetime
+// ------------------------------------------------------------
+
+struct market_series *market_series_create(const char *symbol, size_t count)
+{
+    // Header, then prices (8-byte aligned), then dates
+    size_t bytes = sizeof(struct market_series)
+                 + count * sizeof(double)
+                 + count * sizeof(int32_t);
+
+    struct market_series *s = malloc(bytes);
+    if (!s)
+        return NULL;
+
+    memset(s, 0, sizeof(*s));
+    if (symbol)
+        strncpy(s->symbol, symbol, sizeof(s->symbol) - 1);
+
+    s->count = count;
+    s->prices = (double *)(s + 1);
+    s->dates = (int32_t *)(s->prices + count);
+    atomic_init(&s->refs, 1);
+
+    return s;
+}
+
+struct market_series *market_series_retain(struct market_series *series)
+{
+    if (series)
+        atomic_fetch_add_explicit(&series->refs, 1, memory_order_relaxed);
+    return series;
+}
+
+void market_series_release(struct market_series *series)
+{
+    if (!series)
+        return;
+
+    if (atomic_fetch_sub_explicit(&series->refs, 1,
+                                  memory_order_acq_rel) == 1) {
+        market_metrics_index_free(series->index);
+        free(series);
+    }
+}
+
+int market_series_build_index(struct market_series *series)
+{
+    if (!series)
+        return -1;
+
+    if (series->index || series->count < 2)
+        return 0;
+
+    series->index = market_metrics_index_build(series->prices, series->count);
+    return series->index ? 0 : -1;
+}
+
+size_t market_series_bytes(const struct market_series *series)
+{
+    if (!series)
+        return 0;
+
+    return sizeof(*series)
+         + series->count * (sizeof(double) + sizeof(int32_t))
+         + market_metrics_index_bytes(series->index);
+}
+
+int market_series_quote(const struct market_series *series,
+                        struct stock_quote *out)
+{
+    if (!series || !out || series->count < 2)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->symbol, series->symbol, sizeof(out->symbol));
+
+    double latest = series->prices[series->count - 1];
+    double previous = series->prices[series->count - 2];
+
+    out->price = latest;
+    out->change = latest - previous;
+    out->change_percent = (out->change / previous) * 100.0;
+
+    return 0;
+}
+
+
+// ------------------------------------------------------------
+// Dates (proleptic Gregorian <-> days since 1970-01-01)
+// ------------------------------------------------------------
+
+static int32_t days_from_civil(int y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int32_t)(era * 146097 + (int)doe - 719468);
+}
+
+static int parse_digits(const char *s, int n)
+{
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (s[i] < '0' || s[i] > '9')
+            return -1;
+        v = v * 10 + (s[i] - '0');
+    }
+    return v;
+}
+
+int market_date_parse(const char *s, int32_t *out_day)
+{
+    if (!s || !out_day || strlen(s) < 10 || s[4] != '-' || s[7] != '-')
+        return -1;
+
+    int y = parse_digits(s, 4);
+    int m = parse_digits(s + 5, 2);
+    int d = parse_digits(s + 8, 2);
+
+    if (y < 0 || m < 1 || m > 12 || d < 1 || d > 31)
+        return -1;
+
+    *out_day = days_from_civil(y, (unsigned)m, (unsigned)d);
+    return 0;
+}
+
+void market_date_format(int32_t day, char buf[11])
+{
+    int z = day + 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    int y = (int)yoe + era * 400 + (m <= 2);
+
+    buf[0] = (char)('0' + (y / 1000) % 10);
+    buf[1] = (char)('0' + (y / 100) % 10);
+    buf[2] = (char)('0' + (y / 10) % 10);
+    buf[3] = (char)('0' + y % 10);
+    buf[4] = '-';
+    buf[5] = (char)('0' + m / 10);
+    buf[6] = (char)('0' + m % 10);
+    buf[7] = '-';
+    buf[8] = (char)('0' + d / 10);
+    buf[9] = (char)('0' + d % 10);
+    buf[10] = '\0';
+}
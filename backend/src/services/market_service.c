@@ -2,116 +2,387 @@
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "market_service.h"
 #include "stockc/market.h"
 #include "stockc/market_metrics.h"
 #include "stockc/market_history_json.h"
 #include "stockc/market_demo_data.h"
+#include "stockc/alpha_vantage.h"
 #include "../cache/history_cache.h"
-
-#include "yyjson.h"
+#include "../cache/negative_cache.h"
+#include "../memory/arena.h"
+#include "single_flight.h"
+#include "history_refresher.h"
+#include "../telemetry/telemetry.h"
 
 // ============================================================
 // Internal helpers
 // ============================================================
 
-static int extract_latest_quote(const char *history_json,
-                                struct stock_quote *out)
+static void record_source(enum market_data_source source, int expired)
+{
+    switch (source) {
+    case MARKET_SOURCE_CACHE:
+        telemetry_data_source(expired ? TELEMETRY_DATA_STALE
+                                      : TELEMETRY_DATA_CACHE);
+        break;
+    case MARKET_SOURCE_LIVE:
+        telemetry_data_source(TELEMETRY_DATA_LIVE);
+        break;
+    case MARKET_SOURCE_DEMO:
+        telemetry_data_source(TELEMETRY_DATA_DEMO);
+        break;
+    }
+}
+
+/*
+ * Upstream fetch run by the single-flight leader for a symbol.
+ * Concurrent misses for the same symbol wait on this instead of
+ * issuing their own Alpha Vantage call.
+ */
+static int fetch_history_into_cache(void *ctx)
+{
+    const char *symbol = ctx;
+
+    // Another flight may have filled the cache after our miss
+    if (history_cache_is_valid(symbol))
+        return 0;
+
+    // Failed recently: answer from the negative cache, not upstream
+    int rc = 0;
+    if (negative_cache_check(symbol, &rc))
+        return rc;
+
+    struct market_series *series = NULL;
+    rc = alpha_vantage_get_daily_history(
+        symbol, UPSTREAM_PRIORITY_INTERACTIVE, &series);
+
+    negative_cache_record(symbol, rc);
+
+    if (rc == 0) {
+        history_cache_set(symbol, series);
+        market_series_release(series);
+    }
+
+    return rc;
+}
+
+/*
+ * Shared state for one batch of parallel upstream fetches. The
+ * waiting thread owns it; engine callbacks only count down.
+ */
+struct fetch_batch {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    size_t pending;
+};
+
+struct fetch_slot {
+    struct fetch_batch *batch;
+    const char *symbol;
+    struct single_flight_call *flight;
+    int following;      // flight is another caller's: wait, don't finish
+    int rc;
+};
+
+static void on_batch_fetched(int rc, struct market_series *series, void *user)
+{
+    struct fetch_slot *slot = user;
+
+    negative_cache_record(slot->symbol, rc);
+
+    if (rc == 0) {
+        history_cache_set(slot->symbol, series);
+        market_series_release(series);
+    }
+
+    // Cache first, so callers woken here find the series
+    single_flight_finish(slot->flight, rc);
+
+    struct fetch_batch *batch = slot->batch;
+
+    pthread_mutex_lock(&batch->lock);
+    slot->rc = rc;
+    if (--batch->pending == 0)
+        pthread_cond_signal(&batch->done);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/*
+ * Lead the flight for slot's symbol: answer from the caches if they
+ * can, else hand the fetch to the upstream engine. Returns 1 if the
+ * engine took it (its callback finishes the flight); otherwise sets
+ * slot->rc, finishes the flight and returns 0.
+ */
+static int lead_batch_fetch(struct fetch_slot *slot)
 {
-    const char *p = strstr(history_json, "\"price\":");
-    if (!p) return -1;
+    // Filled between our miss and joining the flight
+    if (history_cache_is_valid(slot->symbol)) {
+        slot->rc = 0;
+        single_flight_finish(slot->flight, 0);
+        return 0;
+    }
 
-    double latest = atof(p + 8);
+    int rc = 0;
+    int known_bad = negative_cache_check(slot->symbol, &rc);
 
-    const char *p2 = strstr(p + 8, "\"price\":");
-    if (!p2) return -1;
+    if (!known_bad)
+        rc = alpha_vantage_get_daily_history_async(
+            slot->symbol, UPSTREAM_PRIORITY_INTERACTIVE,
+            on_batch_fetched, slot);
 
-    double previous = atof(p2 + 8);
+    if (rc == 0)
+        return 1;
 
-    out->price = latest;
-    out->change = latest - previous;
-    out->change_percent =
-        (out->change / previous) * 100.0;
+    // Refused by the governor: a blocking retry would be too
+    if (!known_bad && rc != -7)
+        rc = fetch_history_into_cache((void *)slot->symbol);
 
+    slot->rc = rc;
+    single_flight_finish(slot->flight, rc);
     return 0;
 }
 
+/*
+ * Fetch every symbol in `slots` through the upstream engine at once
+ * and wait for all of them. Each fetch joins the symbol's single
+ * flight, so a symbol already being fetched (by another request or
+ * earlier in this batch) is waited on rather than fetched again.
+ * Symbols that failed recently are answered from the negative cache;
+ * symbols the engine cannot take are fetched on this thread instead,
+ * unless the governor refused them. Upstream requests time out, so
+ * every callback arrives.
+ */
+static void fetch_all_into_cache(struct fetch_slot *slots, size_t count)
+{
+    struct fetch_batch batch;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.done, NULL);
+    batch.pending = count;
+
+    for (size_t i = 0; i < count; i++) {
+        slots[i].batch = &batch;
+        slots[i].rc = -1;
+
+        int leader = 1;
+        slots[i].flight = single_flight_begin(slots[i].symbol, &leader);
+        slots[i].following = !leader;
+
+        // Followers are collected after every lead has been submitted
+        if (!leader || !lead_batch_fetch(&slots[i])) {
+            pthread_mutex_lock(&batch.lock);
+            batch.pending--;
+            pthread_mutex_unlock(&batch.lock);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].following)
+            slots[i].rc = single_flight_wait(slots[i].flight);
+    }
+
+    pthread_mutex_lock(&batch.lock);
+    while (batch.pending > 0)
+        pthread_cond_wait(&batch.done, &batch.lock);
+    pthread_mutex_unlock(&batch.lock);
+
+    pthread_cond_destroy(&batch.done);
+    pthread_mutex_destroy(&batch.lock);
+}
+
 
 // ============================================================
 // Service API
 // ============================================================
 
-struct market_history_result
-market_service_get_history(const char *symbol, int days)
+struct market_series *
+market_service_acquire_history(const char *symbol,
+                               enum market_data_source *source,
+                               time_t *fetched_at)
 {
-    struct market_history_result result;
-    result.json = NULL;
-    result.source = MARKET_SOURCE_DEMO;
-    result.fetched_at = 0;
+    enum market_data_source src = MARKET_SOURCE_DEMO;
+    time_t at = 0;
 
-    const char *raw = NULL;
+    // 1) Cache hit, fresh or stale
+    int expired = 0;
+    struct market_series *series =
+        history_cache_get_stale(symbol, &at, &expired);
 
-    // 1) Cache hit
-    const char *cached = history_cache_get(symbol);
-    if (cached) {
-        raw = cached;
-        result.source = MARKET_SOURCE_CACHE;
-        result.fetched_at = history_cache_get_fetched_at(symbol);
+    if (series) {
+        // Stale entries are served as-is while a worker revalidates
+        src = MARKET_SOURCE_CACHE;
+        if (expired)
+            history_refresher_enqueue(symbol);
     } else {
-        // 2) Try live fetch
-        char json[65536]; // large enough buffer for 252 trading days + meta data
-        int rc = alpha_vantage_get_daily_history_json(
-            symbol, json, sizeof(json)
+        // 2) Try live fetch (coalesced with concurrent misses)
+        int rc = single_flight_do(
+            symbol, fetch_history_into_cache, (void *)symbol, NULL
         );
 
         if (rc == 0) {
-            history_cache_set(symbol, json);
-            raw = history_cache_get(symbol);
-            result.source = MARKET_SOURCE_LIVE;
-            result.fetched_at = history_cache_get_fetched_at(symbol);
+            series = history_cache_get(symbol, &at);
+            src = MARKET_SOURCE_LIVE;
         }
     }
 
-    // 3) Stale cache fallback
-    if (!raw) {
-        const char *stale = history_cache_get(symbol);
-        if (stale) {
-            raw = stale;
-            result.source = MARKET_SOURCE_CACHE;
-            result.fetched_at = history_cache_get_fetched_at(symbol);
+    // 3) Dev fallback
+    if (!series) {
+        series = market_demo_history_series();
+        src = MARKET_SOURCE_DEMO;
+        at = time(NULL);
+    }
+
+    record_source(src, expired);
+
+    if (source)
+        *source = src;
+    if (fetched_at)
+        *fetched_at = at;
+
+    return series;
+}
+
+
+void market_service_acquire_histories(const char *const *symbols,
+                                      size_t count,
+                                      struct market_series **series,
+                                      enum market_data_source *sources,
+                                      time_t *fetched_at)
+{
+    // Engine callbacks write into the slots; the wait below outlives them
+    struct fetch_slot *slots = arena_calloc(count ? count : 1, sizeof(*slots));
+    size_t *slot_of = arena_calloc(count ? count : 1, sizeof(*slot_of));
+    size_t misses = 0;
+
+    // 1) Cache hits, fresh or stale, resolved inline
+    for (size_t i = 0; i < count; i++) {
+        int expired = 0;
+        series[i] = history_cache_get_stale(symbols[i], &fetched_at[i],
+                                            &expired);
+        sources[i] = MARKET_SOURCE_CACHE;
+
+        if (series[i]) {
+            record_source(MARKET_SOURCE_CACHE, expired);
+            if (expired)
+                history_refresher_enqueue(symbols[i]);
+        } else if (slots && slot_of) {
+            slot_of[misses] = i;
+            slots[misses].symbol = symbols[i];
+            misses++;
         }
     }
 
-    // 4) Dev fallback
-    if (!raw) {
-        raw = market_demo_history_json();
-        result.source = MARKET_SOURCE_DEMO;
-        result.fetched_at = time(NULL);
+    // 2) All misses fetched in parallel
+    if (misses > 0)
+        fetch_all_into_cache(slots, misses);
+
+    for (size_t m = 0; m < misses; m++) {
+        size_t i = slot_of[m];
+        if (slots[m].rc == 0) {
+            series[i] = history_cache_get(symbols[i], &fetched_at[i]);
+            sources[i] = MARKET_SOURCE_LIVE;
+        }
+        if (series[i])
+            record_source(MARKET_SOURCE_LIVE, 0);
     }
 
-    result.json = market_build_history_with_metrics(raw, days);
-    return result;
+    // 3) Dev fallback
+    for (size_t i = 0; i < count; i++) {
+        if (!series[i]) {
+            series[i] = market_demo_history_series();
+            sources[i] = MARKET_SOURCE_DEMO;
+            fetched_at[i] = time(NULL);
+            record_source(MARKET_SOURCE_DEMO, 0);
+        }
+    }
 }
 
 
-int market_service_get_quote(const char *symbol,
-                             struct stock_quote *out)
+int market_service_refresh_history(const char *symbol)
 {
-    if (!out)
+    if (!symbol)
         return -1;
 
-    struct market_history_result res =
-        market_service_get_history(symbol, 0); /* days==0 ensures full window is used */
+    return single_flight_do(
+        symbol, fetch_history_into_cache, (void *)symbol, NULL
+    );
+}
 
-    if (!res.json)
-        return -1;
 
-    memset(out, 0, sizeof(*out));
-    strncpy(out->symbol, symbol, sizeof(out->symbol) - 1);
+struct market_history_result
+market_service_get_history(const char *symbol, int days)
+{
+    struct market_history_result result;
+    result.json = NULL;
+    result.source = MARKET_SOURCE_DEMO;
+    result.fetched_at = 0;
+
+    struct market_series *series = market_service_acquire_history(
+        symbol, &result.source, &result.fetched_at);
 
-    if (extract_latest_quote(res.json, out) != 0)
+    result.json = market_build_history_with_metrics(series, days);
+    market_series_release(series);
+    return result;
+}
+
+
+int market_service_quote_from_series(const struct market_series *series,
+                                     const char *symbol,
+                                     struct stock_quote *out)
+{
+    if (market_series_quote(series, out) != 0)
         return -1;
 
+    // The demo series answers for every symbol
+    if (symbol) {
+        memset(out->symbol, 0, sizeof(out->symbol));
+        strncpy(out->symbol, symbol, sizeof(out->symbol) - 1);
+    }
+
     return 0;
 }
+
+
+int market_service_acquire_quote(const char *symbol,
+                                 struct stock_quote *out,
+                                 enum market_data_source *source,
+                                 time_t *fetched_at)
+{
+    if (!out)
+        return -1;
+
+    // 1) Quote record kept alongside the cached series
+    int expired = 0;
+    if (history_cache_get_quote(symbol, out, fetched_at, &expired)) {
+        record_source(MARKET_SOURCE_CACHE, expired);
+        if (expired)
+            history_refresher_enqueue(symbol);
+        if (source)
+            *source = MARKET_SOURCE_CACHE;
+        return 0;
+    }
+
+    // 2) Miss: same resolution as history, then derive
+    struct market_series *series =
+        market_service_acquire_history(symbol, source, fetched_at);
+
+    int rc = market_service_quote_from_series(series, symbol, out);
+    market_series_release(series);
+
+    if (rc != 0) {
+        memset(out, 0, sizeof(*out));
+        if (symbol)
+            strncpy(out->symbol, symbol, sizeof(out->symbol) - 1);
+    }
+
+    return rc;
+}
+
+
+int market_service_get_quote(const char *symbol,
+                             struct stock_quote *out)
+{
+    return market_service_acquire_quote(symbol, out, NULL, NULL);
+}
@@ -1,8 +1,10 @@
 #ifndef STOCKC_MARKET_SERVICE_H
 #define STOCKC_MARKET_SERVICE_H
 
+#include <stddef.h>
 #include <time.h>
 #include "stockc/market.h"
+#include "stockc/market_series.h"
 
 /*
  * Where the history data came from
@@ -17,17 +19,66 @@ enum market_data_source {
  * Result object returned by the history service
  */
 struct market_history_result {
-    const char *json;           // history JSON payload
+    char *json;                 // history JSON payload (request arena)
     enum market_data_source source;
     time_t fetched_at;          // when the data was originally fetched
 };
 
+/*
+ * Resolve the series for `symbol`: cache (an expired entry is served
+ * and queued for background refresh), live fetch, then demo data.
+ * Never returns NULL unless the demo series failed to parse.
+ * Returns a new reference (release with market_series_release).
+ */
+struct market_series *
+market_service_acquire_history(const char *symbol,
+                               enum market_data_source *source,
+                               time_t *fetched_at);
+
+/*
+ * Batch form of market_service_acquire_history. Cache hits are
+ * resolved inline; all misses are fetched from upstream in parallel
+ * and waited on together. Fills series[i] (a new reference each),
+ * sources[i] and fetched_at[i] for every symbol.
+ */
+void market_service_acquire_histories(const char *const *symbols,
+                                      size_t count,
+                                      struct market_series **series,
+                                      enum market_data_source *sources,
+                                      time_t *fetched_at);
+
+/*
+ * Fetch `symbol` from upstream into the history cache, coalesced with
+ * any fetch already running for it. Blocks the calling thread.
+ * Returns 0 on success, the upstream error code otherwise.
+ */
+int market_service_refresh_history(const char *symbol);
+
 /*
  * Returns history + metadata
  */
 struct market_history_result
 market_service_get_history(const char *symbol, int days);
 
+/*
+ * Latest close and day-over-day change from a series.
+ * Returns 0 on success, -1 if the series has fewer than two points.
+ */
+int market_service_quote_from_series(const struct market_series *series,
+                                     const char *symbol,
+                                     struct stock_quote *out);
+
+/*
+ * Resolve a quote for `symbol` without touching the series data when
+ * the cache holds a quote record for it; misses resolve like
+ * market_service_acquire_history. *out is always filled (zeros when
+ * no quote could be derived). Returns 0 on success, -1 otherwise.
+ */
+int market_service_acquire_quote(const char *symbol,
+                                 struct stock_quote *out,
+                                 enum market_data_source *source,
+                                 time_t *fetched_at);
+
 /*
  * Quote logic stays the same externally
  */
@@ -0,0 +1,181 @@
+#include "single_flight.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct single_flight_call {
+    struct single_flight_call *next;
+    char key[32];
+    pthread_cond_t done_cond;
+    int done;
+    int rc;
+    int refs;       // leader + waiters still holding the call
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct single_flight_call *in_flight = NULL;
+static struct single_flight_stats stats = {0};
+
+
+// ------------------------------------------------------------
+// Helpers (caller holds lock)
+// ------------------------------------------------------------
+
+static struct single_flight_call *find_call(const char *key)
+{
+    for (struct single_flight_call *c = in_flight; c; c = c->next) {
+        if (strcmp(c->key, key) == 0)
+            return c;
+    }
+    return NULL;
+}
+
+static void unlink_call(struct single_flight_call *call)
+{
+    struct single_flight_call **pp = &in_flight;
+    while (*pp && *pp != call)
+        pp = &(*pp)->next;
+    if (*pp)
+        *pp = call->next;
+}
+
+/*
+ * Register a new flight for `key`, led by the caller. NULL if out of
+ * memory.
+ */
+static struct single_flight_call *start_call(const char *key)
+{
+    struct single_flight_call *call = calloc(1, sizeof(*call));
+    if (!call)
+        return NULL;
+
+    strncpy(call->key, key, sizeof(call->key) - 1);
+    pthread_cond_init(&call->done_cond, NULL);
+    call->refs = 1;
+    call->next = in_flight;
+    in_flight = call;
+    stats.flights++;
+    return call;
+}
+
+static void release_call(struct single_flight_call *call)
+{
+    if (--call->refs > 0)
+        return;
+
+    pthread_cond_destroy(&call->done_cond);
+    free(call);
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+struct single_flight_call *single_flight_begin(const char *key,
+                                               int *leader)
+{
+    *leader = 1;
+
+    pthread_mutex_lock(&lock);
+
+    struct single_flight_call *call = find_call(key);
+    if (call) {
+        // Follower: holds a reference until single_flight_wait
+        call->refs++;
+        stats.coalesced++;
+        pthread_mutex_unlock(&lock);
+
+        *leader = 0;
+        return call;
+    }
+
+    call = start_call(key);
+
+    pthread_mutex_unlock(&lock);
+    return call;
+}
+
+int single_flight_try_begin(const char *key,
+                            struct single_flight_call **call)
+{
+    *call = NULL;
+
+    pthread_mutex_lock(&lock);
+
+    if (find_call(key)) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    *call = start_call(key);
+
+    pthread_mutex_unlock(&lock);
+    return 1;
+}
+
+void single_flight_finish(struct single_flight_call *call, int rc)
+{
+    if (!call)
+        return;
+
+    pthread_mutex_lock(&lock);
+    call->rc = rc;
+    call->done = 1;
+    unlink_call(call);
+    pthread_cond_broadcast(&call->done_cond);
+    release_call(call);
+    pthread_mutex_unlock(&lock);
+}
+
+int single_flight_wait(struct single_flight_call *call)
+{
+    pthread_mutex_lock(&lock);
+
+    while (!call->done)
+        pthread_cond_wait(&call->done_cond, &lock);
+
+    int rc = call->rc;
+    release_call(call);
+    pthread_mutex_unlock(&lock);
+
+    return rc;
+}
+
+int single_flight_do(const char *key,
+                     int (*fn)(void *ctx),
+                     void *ctx,
+                     int *shared)
+{
+    if (shared)
+        *shared = 0;
+
+    if (!key || !fn)
+        return -1;
+
+    int leader = 0;
+    struct single_flight_call *call = single_flight_begin(key, &leader);
+
+    if (!leader) {
+        if (shared)
+            *shared = 1;
+        return single_flight_wait(call);
+    }
+
+    // Leader: do the work without holding the table lock
+    int rc = fn(ctx);
+    single_flight_finish(call, rc);
+
+    return rc;
+}
+
+void single_flight_get_stats(struct single_flight_stats *out)
+{
+    if (!out)
+        return;
+
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
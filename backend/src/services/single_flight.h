@@ -0,0 +1,61 @@
+#ifndef STOCKC_SINGLE_FLIGHT_H
+#define STOCKC_SINGLE_FLIGHT_H
+
+/*
+ * Single-flight call coalescing.
+ *
+ * The first caller for a key runs `fn`; callers arriving with the same
+ * key while it is running block until it finishes and receive its
+ * return code instead of running `fn` themselves.
+ */
+
+struct single_flight_stats {
+    unsigned long long flights;     // calls that ran fn
+    unsigned long long coalesced;   // calls that waited on another caller
+};
+
+/*
+ * Run `fn(ctx)` at most once concurrently per `key`.
+ * Sets *shared (if non-NULL) to 1 when the result came from another
+ * caller's run, 0 when this caller ran `fn`.
+ * Returns fn's return code.
+ */
+int single_flight_do(const char *key,
+                     int (*fn)(void *ctx),
+                     void *ctx,
+                     int *shared);
+
+/*
+ * Split form of single_flight_do, for leaders whose work completes
+ * asynchronously (e.g. in an upstream engine callback).
+ *
+ * single_flight_begin joins the flight for `key`. When *leader is set
+ * the caller runs the work and must pass its result to
+ * single_flight_finish, from any thread; otherwise it collects the
+ * leader's result with single_flight_wait. Returns NULL (with *leader
+ * set) only if the flight could not be registered; finishing NULL is a
+ * no-op.
+ */
+struct single_flight_call;
+
+struct single_flight_call *single_flight_begin(const char *key,
+                                               int *leader);
+
+/*
+ * single_flight_begin for callers that never wait: returns 1 with
+ * *call set (NULL if the flight could not be registered) when the
+ * caller now leads `key`, 0 when a flight for it is already running.
+ */
+int single_flight_try_begin(const char *key,
+                            struct single_flight_call **call);
+
+void single_flight_finish(struct single_flight_call *call, int rc);
+
+/*
+ * Block until the leader of `call` finishes; returns its result.
+ */
+int single_flight_wait(struct single_flight_call *call);
+
+void single_flight_get_stats(struct single_flight_stats *out);
+
+#endif
@@ -0,0 +1,404 @@
+#include "telemetry.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum telemetry_route {
+    ROUTE_QUOTE,
+    ROUTE_QUOTES,
+    ROUTE_HISTORY,
+    ROUTE_ROLLING,
+    ROUTE_CORRELATION,
+    ROUTE_PORTFOLIO,
+    ROUTE_HEALTH,
+    ROUTE_METRICS,
+    ROUTE_OTHER,
+    ROUTE_COUNT
+};
+
+static const char *const route_paths[ROUTE_COUNT] = {
+    "/api/market/quote",
+    "/api/market/quotes",
+    "/api/market/history",
+    "/api/market/rolling",
+    "/api/market/correlation",
+    "/api/market/portfolio",
+    "/health",
+    "/metrics",
+    "other",
+};
+
+#define STATUS_CLASSES 5    // 1xx .. 5xx
+
+static const char *const data_names[TELEMETRY_DATA_COUNT] = {
+    "cache", "stale", "live", "demo",
+};
+
+static const char *const upstream_names[TELEMETRY_UPSTREAM_COUNT] = {
+    "GLOBAL_QUOTE", "TIME_SERIES_DAILY",
+};
+
+// Return codes from alpha_vantage.c, plus a catch-all
+static const int upstream_codes[] = { 0, -1, -2, -3, -4, -5, -6, -7, -100, -101 };
+#define UPSTREAM_CODE_COUNT (sizeof(upstream_codes) / sizeof(upstream_codes[0]) + 1)
+
+// Histogram upper bounds, seconds
+static const double bucket_bounds[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+    0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0,
+};
+#define BUCKET_COUNT (sizeof(bucket_bounds) / sizeof(bucket_bounds[0]))
+
+typedef _Atomic uint64_t counter;
+
+struct histogram {
+    counter buckets[BUCKET_COUNT + 1];      // last is +Inf
+    counter sum_ns;
+    counter count;
+};
+
+struct telemetry_slot {
+    struct telemetry_slot *next;
+
+    counter requests[ROUTE_COUNT][STATUS_CLASSES];
+    counter bytes[ROUTE_COUNT];
+    struct histogram latency[ROUTE_COUNT];
+
+    counter data[TELEMETRY_DATA_COUNT];
+
+    counter upstream_calls[TELEMETRY_UPSTREAM_COUNT][UPSTREAM_CODE_COUNT];
+    struct histogram upstream_latency[TELEMETRY_UPSTREAM_COUNT];
+
+    // Request in progress on this thread (owner only)
+    uint64_t request_start_ns;
+    uint64_t request_bytes;
+    int request_status;
+};
+
+static _Atomic(struct telemetry_slot *) slots = NULL;
+static _Thread_local struct telemetry_slot *local_slot = NULL;
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+/*
+ * Single-writer increment: only the owning thread stores, so a
+ * relaxed load/store pair is enough and needs no lock prefix.
+ */
+static void bump(counter *c, uint64_t v)
+{
+    atomic_store_explicit(c,
+        atomic_load_explicit(c, memory_order_relaxed) + v,
+        memory_order_relaxed);
+}
+
+static uint64_t read_counter(const counter *c)
+{
+    return atomic_load_explicit((counter *)c, memory_order_relaxed);
+}
+
+static struct telemetry_slot *slot(void)
+{
+    if (local_slot)
+        return local_slot;
+
+    struct telemetry_slot *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+
+    // Lock-free push; slots live for the life of the process
+    struct telemetry_slot *head = atomic_load(&slots);
+    do {
+        s->next = head;
+    } while (!atomic_compare_exchange_weak(&slots, &head, s));
+
+    local_slot = s;
+    return s;
+}
+
+static void observe(struct histogram *h, uint64_t ns)
+{
+    double seconds = (double)ns / 1e9;
+    size_t b = 0;
+    while (b < BUCKET_COUNT && seconds > bucket_bounds[b])
+        b++;
+
+    bump(&h->buckets[b], 1);
+    bump(&h->sum_ns, ns);
+    bump(&h->count, 1);
+}
+
+static enum telemetry_route route_for(const char *uri)
+{
+    if (!uri)
+        return ROUTE_OTHER;
+
+    for (size_t r = 0; r < ROUTE_OTHER; r++) {
+        if (strcmp(uri, route_paths[r]) == 0)
+            return (enum telemetry_route)r;
+    }
+
+    return ROUTE_OTHER;
+}
+
+static size_t upstream_code_index(int rc)
+{
+    for (size_t i = 0; i < UPSTREAM_CODE_COUNT - 1; i++) {
+        if (upstream_codes[i] == rc)
+            return i;
+    }
+    return UPSTREAM_CODE_COUNT - 1;
+}
+
+
+// ------------------------------------------------------------
+// Recording
+// ------------------------------------------------------------
+
+uint64_t telemetry_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void telemetry_request_begin(void)
+{
+    struct telemetry_slot *s = slot();
+    if (!s)
+        return;
+
+    s->request_start_ns = telemetry_now_ns();
+    s->request_bytes = 0;
+    s->request_status = 0;
+}
+
+void telemetry_request_end(const char *uri, int status)
+{
+    struct telemetry_slot *s = slot();
+    if (!s || s->request_start_ns == 0)
+        return;
+
+    enum telemetry_route r = route_for(uri);
+
+    if (s->request_status)
+        status = s->request_status;
+
+    int cls = status / 100 - 1;
+    if (cls < 0 || cls >= STATUS_CLASSES)
+        cls = STATUS_CLASSES - 1;
+
+    bump(&s->requests[r][cls], 1);
+    bump(&s->bytes[r], s->request_bytes);
+    observe(&s->latency[r], telemetry_now_ns() - s->request_start_ns);
+
+    s->request_start_ns = 0;
+}
+
+void telemetry_set_status(int status)
+{
+    struct telemetry_slot *s = slot();
+    if (s)
+        s->request_status = status;
+}
+
+void telemetry_add_bytes(size_t bytes)
+{
+    struct telemetry_slot *s = slot();
+    if (s)
+        s->request_bytes += bytes;
+}
+
+void telemetry_data_source(enum telemetry_data data)
+{
+    struct telemetry_slot *s = slot();
+    if (s && data < TELEMETRY_DATA_COUNT)
+        bump(&s->data[data], 1);
+}
+
+void telemetry_upstream(enum telemetry_upstream fn, int rc, uint64_t elapsed_ns)
+{
+    struct telemetry_slot *s = slot();
+    if (!s || fn >= TELEMETRY_UPSTREAM_COUNT)
+        return;
+
+    bump(&s->upstream_calls[fn][upstream_code_index(rc)], 1);
+    observe(&s->upstream_latency[fn], elapsed_ns);
+}
+
+
+// ------------------------------------------------------------
+// Rendering
+// ------------------------------------------------------------
+
+int telemetry_appendf(struct telemetry_text *t, const char *fmt, ...)
+{
+    for (;;) {
+        size_t avail = t->cap - t->len;
+
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(t->data ? t->data + t->len : NULL, avail, fmt, ap);
+        va_end(ap);
+
+        if (n < 0)
+            return -1;
+
+        if ((size_t)n < avail) {
+            t->len += (size_t)n;
+            return 0;
+        }
+
+        size_t new_cap = t->cap ? t->cap * 2 : 4096;
+        while (new_cap < t->len + (size_t)n + 1)
+            new_cap *= 2;
+
+        char *grown = realloc(t->data, new_cap);
+        if (!grown)
+            return -1;
+
+        t->data = grown;
+        t->cap = new_cap;
+    }
+}
+
+static void sum_histogram(struct histogram *acc, const struct histogram *h)
+{
+    for (size_t b = 0; b <= BUCKET_COUNT; b++)
+        acc->buckets[b] += read_counter(&h->buckets[b]);
+    acc->sum_ns += read_counter(&h->sum_ns);
+    acc->count += read_counter(&h->count);
+}
+
+static void render_histogram(struct telemetry_text *t,
+                             const char *name,
+                             const char *label,
+                             const char *value,
+                             const struct histogram *h)
+{
+    uint64_t cumulative = 0;
+
+    for (size_t b = 0; b < BUCKET_COUNT; b++) {
+        cumulative += h->buckets[b];
+        telemetry_appendf(t, "%s_bucket{%s=\"%s\",le=\"%g\"} %llu\n",
+                          name, label, value, bucket_bounds[b],
+                          (unsigned long long)cumulative);
+    }
+
+    cumulative += h->buckets[BUCKET_COUNT];
+    telemetry_appendf(t, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n",
+                      name, label, value, (unsigned long long)cumulative);
+    telemetry_appendf(t, "%s_sum{%s=\"%s\"} %.9f\n",
+                      name, label, value, (double)h->sum_ns / 1e9);
+    telemetry_appendf(t, "%s_count{%s=\"%s\"} %llu\n",
+                      name, label, value, (unsigned long long)h->count);
+}
+
+void telemetry_render(struct telemetry_text *t)
+{
+    // Merge every thread's slot into a private total. Slots are read
+    // with relaxed loads while their threads keep counting; `acc` has
+    // the same atomic fields, but only this call ever sees it
+    struct telemetry_slot *acc = calloc(1, sizeof(*acc));
+    if (!acc)
+        return;
+
+    for (struct telemetry_slot *s = atomic_load(&slots); s; s = s->next) {
+        for (size_t r = 0; r < ROUTE_COUNT; r++) {
+            for (size_t c = 0; c < STATUS_CLASSES; c++)
+                acc->requests[r][c] += read_counter(&s->requests[r][c]);
+            acc->bytes[r] += read_counter(&s->bytes[r]);
+            sum_histogram(&acc->latency[r], &s->latency[r]);
+        }
+
+        for (size_t d = 0; d < TELEMETRY_DATA_COUNT; d++)
+            acc->data[d] += read_counter(&s->data[d]);
+
+        for (size_t f = 0; f < TELEMETRY_UPSTREAM_COUNT; f++) {
+            for (size_t c = 0; c < UPSTREAM_CODE_COUNT; c++)
+                acc->upstream_calls[f][c] += read_counter(&s->upstream_calls[f][c]);
+            sum_histogram(&acc->upstream_latency[f], &s->upstream_latency[f]);
+        }
+    }
+
+    telemetry_appendf(t,
+        "# HELP stockc_http_requests_total HTTP requests by route and status class.\n"
+        "# TYPE stockc_http_requests_total counter\n");
+    for (size_t r = 0; r < ROUTE_COUNT; r++) {
+        for (size_t c = 0; c < STATUS_CLASSES; c++) {
+            if (acc->requests[r][c] == 0)
+                continue;
+            telemetry_appendf(t,
+                "stockc_http_requests_total{route=\"%s\",status=\"%zuxx\"} %llu\n",
+                route_paths[r], c + 1,
+                (unsigned long long)acc->requests[r][c]);
+        }
+    }
+
+    telemetry_appendf(t,
+        "# HELP stockc_http_response_bytes_total Response body bytes by route.\n"
+        "# TYPE stockc_http_response_bytes_total counter\n");
+    for (size_t r = 0; r < ROUTE_COUNT; r++) {
+        telemetry_appendf(t,
+            "stockc_http_response_bytes_total{route=\"%s\"} %llu\n",
+            route_paths[r], (unsigned long long)acc->bytes[r]);
+    }
+
+    telemetry_appendf(t,
+        "# HELP stockc_http_request_duration_seconds Request latency by route.\n"
+        "# TYPE stockc_http_request_duration_seconds histogram\n");
+    for (size_t r = 0; r < ROUTE_COUNT; r++) {
+        if (acc->latency[r].count == 0)
+            continue;
+        render_histogram(t, "stockc_http_request_duration_seconds",
+                         "route", route_paths[r], &acc->latency[r]);
+    }
+
+    telemetry_appendf(t,
+        "# HELP stockc_market_data_total Market data lookups by where the answer came from.\n"
+        "# TYPE stockc_market_data_total counter\n");
+    for (size_t d = 0; d < TELEMETRY_DATA_COUNT; d++) {
+        telemetry_appendf(t, "stockc_market_data_total{source=\"%s\"} %llu\n",
+                          data_names[d], (unsigned long long)acc->data[d]);
+    }
+
+    telemetry_appendf(t,
+        "# HELP stockc_upstream_calls_total Upstream calls by function and result code.\n"
+        "# TYPE stockc_upstream_calls_total counter\n");
+    for (size_t f = 0; f < TELEMETRY_UPSTREAM_COUNT; f++) {
+        for (size_t c = 0; c < UPSTREAM_CODE_COUNT; c++) {
+            if (acc->upstream_calls[f][c] == 0)
+                continue;
+
+            char code[16];
+            if (c < UPSTREAM_CODE_COUNT - 1)
+                snprintf(code, sizeof(code), "%d", upstream_codes[c]);
+            else
+                snprintf(code, sizeof(code), "other");
+
+            telemetry_appendf(t,
+                "stockc_upstream_calls_total{function=\"%s\",code=\"%s\"} %llu\n",
+                upstream_names[f], code,
+                (unsigned long long)acc->upstream_calls[f][c]);
+        }
+    }
+
+    telemetry_appendf(t,
+        "# HELP stockc_upstream_duration_seconds Upstream call latency by function.\n"
+        "# TYPE stockc_upstream_duration_seconds histogram\n");
+    for (size_t f = 0; f < TELEMETRY_UPSTREAM_COUNT; f++) {
+        if (acc->upstream_latency[f].count == 0)
+            continue;
+        render_histogram(t, "stockc_upstream_duration_seconds",
+                         "function", upstream_names[f],
+                         &acc->upstream_latency[f]);
+    }
+
+    free(acc);
+}
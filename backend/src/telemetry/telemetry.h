@@ -0,0 +1,78 @@
+#ifndef STOCKC_TELEMETRY_H
+#define STOCKC_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Process telemetry for the /metrics endpoint.
+ *
+ * Every thread that records something gets its own counter slot on
+ * first use; only the owning thread writes it (plain relaxed
+ * load/store, no locked instructions), and a scrape sums all slots.
+ * Instrumenting the hot path therefore never contends across CivetWeb
+ * workers. A scrape may see a slot mid-update; each counter is read
+ * atomically, so totals are at most one event behind.
+ */
+
+enum telemetry_data {
+    TELEMETRY_DATA_CACHE,       // fresh cache hit
+    TELEMETRY_DATA_STALE,       // expired entry served while refreshing
+    TELEMETRY_DATA_LIVE,        // miss answered by upstream
+    TELEMETRY_DATA_DEMO,        // miss answered by demo data
+    TELEMETRY_DATA_COUNT
+};
+
+enum telemetry_upstream {
+    TELEMETRY_UPSTREAM_QUOTE,           // GLOBAL_QUOTE
+    TELEMETRY_UPSTREAM_DAILY,           // TIME_SERIES_DAILY
+    TELEMETRY_UPSTREAM_COUNT
+};
+
+/*
+ * Growable text buffer the scrape is rendered into.
+ */
+struct telemetry_text {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+uint64_t telemetry_now_ns(void);
+
+/*
+ * Request lifecycle, called from the server's begin/end callbacks on
+ * the thread handling the request.
+ */
+void telemetry_request_begin(void);
+void telemetry_request_end(const char *uri, int status);
+
+/*
+ * Status line and body bytes written for the current request. CivetWeb
+ * only reports the handler's return value, so the response helpers
+ * record the real status; it falls back to CivetWeb's code when unset.
+ */
+void telemetry_set_status(int status);
+void telemetry_add_bytes(size_t bytes);
+
+void telemetry_data_source(enum telemetry_data data);
+
+/*
+ * One upstream call: its return code (0, or the alpha_vantage error
+ * code such as -100 for a rate-limit note) and how long it took.
+ */
+void telemetry_upstream(enum telemetry_upstream fn, int rc, uint64_t elapsed_ns);
+
+/*
+ * Append printf-style text. Returns 0 on success, -1 on allocation
+ * failure (the buffer keeps what it had).
+ */
+int telemetry_appendf(struct telemetry_text *t, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/*
+ * Append all telemetry counters in Prometheus text format.
+ */
+void telemetry_render(struct telemetry_text *t);
+
+#endif
@@ -0,0 +1,477 @@
+#include "stockc/upstream_engine.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define USE_EPOLL 1
+#endif
+
+#define UPSTREAM_MAX_INFLIGHT 32
+#define EPOLL_BATCH 64
+
+struct upstream_job {
+    struct upstream_job *next;
+    char *url;
+    long timeout_ms;
+    upstream_callback cb;
+    void *user;
+    CURL *easy;
+    struct http_body body;
+};
+
+struct upstream_future {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    int rc;
+    struct http_response res;
+};
+
+static CURLM *multi = NULL;
+static int started = 0;
+static long max_inflight = UPSTREAM_MAX_INFLIGHT;
+
+// Submission queue, guarded by queue_lock
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct upstream_job *queue_head = NULL;
+static struct upstream_job *queue_tail = NULL;
+
+static struct upstream_engine_stats stats = {0};   // guarded by queue_lock
+
+// Engine-thread state
+static long in_flight = 0;
+static CURL *idle_handles = NULL;   // one spare handle kept for reuse
+
+#ifdef USE_EPOLL
+static int epfd = -1;
+static int wakefd = -1;
+static long long timer_deadline = -1;   // monotonic ms, -1 = none
+#endif
+
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static long env_long(const char *name, long fallback)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    long n = strtol(v, NULL, 10);
+    return n > 0 ? n : fallback;
+}
+
+static void wake_engine(void)
+{
+#ifdef USE_EPOLL
+    uint64_t one = 1;
+    ssize_t w = write(wakefd, &one, sizeof(one));
+    (void)w;
+#else
+    curl_multi_wakeup(multi);
+#endif
+}
+
+static void job_free(struct upstream_job *job)
+{
+    free(job->url);
+    free(job->body.ptr);
+    free(job);
+}
+
+static CURL *take_handle(void)
+{
+    if (idle_handles) {
+        CURL *h = idle_handles;
+        idle_handles = NULL;
+        curl_easy_reset(h);
+        return h;
+    }
+    return curl_easy_init();
+}
+
+static void return_handle(CURL *h)
+{
+    if (!idle_handles)
+        idle_handles = h;
+    else
+        curl_easy_cleanup(h);
+}
+
+/*
+ * Move queued jobs into the multi handle while there are free slots.
+ */
+static void start_queued_jobs(void)
+{
+    while (in_flight < max_inflight) {
+        pthread_mutex_lock(&queue_lock);
+        struct upstream_job *job = queue_head;
+        if (job) {
+            queue_head = job->next;
+            if (!queue_head)
+                queue_tail = NULL;
+            stats.queued--;
+            stats.in_flight++;
+        }
+        pthread_mutex_unlock(&queue_lock);
+
+        if (!job)
+            return;
+
+        job->easy = take_handle();
+        if (!job->easy) {
+            pthread_mutex_lock(&queue_lock);
+            stats.in_flight--;
+            stats.failed++;
+            pthread_mutex_unlock(&queue_lock);
+            job->cb(3, NULL, job->user);
+            job_free(job);
+            continue;
+        }
+
+        curl_easy_setopt(job->easy, CURLOPT_URL, job->url);
+        curl_easy_setopt(job->easy, CURLOPT_WRITEFUNCTION, http_client_write_body);
+        curl_easy_setopt(job->easy, CURLOPT_WRITEDATA, &job->body);
+        curl_easy_setopt(job->easy, CURLOPT_TIMEOUT_MS, job->timeout_ms);
+        curl_easy_setopt(job->easy, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(job->easy, CURLOPT_USERAGENT, "stockc/1.0");
+        curl_easy_setopt(job->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(job->easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(job->easy, CURLOPT_PRIVATE, job);
+
+        curl_multi_add_handle(multi, job->easy);
+        in_flight++;
+    }
+}
+
+/*
+ * Deliver finished transfers to their callbacks.
+ */
+static void reap_completed(void)
+{
+    CURLMsg *msg;
+    int left;
+
+    while ((msg = curl_multi_info_read(multi, &left))) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        CURL *easy = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        struct upstream_job *job = NULL;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&job);
+
+        long status = 0;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+
+        long connects = 0;
+        curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+        http_client_record_transfer(result == CURLE_OK, connects);
+
+        curl_multi_remove_handle(multi, easy);
+        return_handle(easy);
+        in_flight--;
+
+        pthread_mutex_lock(&queue_lock);
+        stats.in_flight--;
+        stats.completed++;
+        if (result != CURLE_OK)
+            stats.failed++;
+        pthread_mutex_unlock(&queue_lock);
+
+        if (result != CURLE_OK) {
+            job->cb(4, NULL, job->user);
+        } else {
+            struct http_response res;
+            res.status = status;
+            res.body = job->body.ptr;
+            res.size = job->body.len;
+            job->body.ptr = NULL;   // ownership moves to the callback
+            job->cb(0, &res, job->user);
+        }
+
+        job_free(job);
+    }
+}
+
+
+// ------------------------------------------------------------
+// Event loop
+// ------------------------------------------------------------
+
+#ifdef USE_EPOLL
+
+static long long monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int socket_cb(CURL *easy, curl_socket_t s, int what,
+                     void *userp, void *socketp)
+{
+    (void)easy; (void)userp; (void)socketp;
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, s, NULL);
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.data.fd = s;
+    if (what & CURL_POLL_IN)  ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, s, &ev) != 0)
+        epoll_ctl(epfd, EPOLL_CTL_ADD, s, &ev);
+
+    return 0;
+}
+
+static int timer_cb(CURLM *m, long timeout_ms, void *userp)
+{
+    (void)m; (void)userp;
+    timer_deadline = timeout_ms < 0 ? -1 : monotonic_ms() + timeout_ms;
+    return 0;
+}
+
+static void *engine_loop(void *arg)
+{
+    (void)arg;
+    struct epoll_event events[EPOLL_BATCH];
+    int running = 0;
+
+    for (;;) {
+        int wait_ms = -1;
+        if (timer_deadline >= 0) {
+            long long left = timer_deadline - monotonic_ms();
+            wait_ms = left > 0 ? (int)left : 0;
+        }
+
+        int n = epoll_wait(epfd, events, EPOLL_BATCH, wait_ms);
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == wakefd) {
+                uint64_t drained;
+                ssize_t r = read(wakefd, &drained, sizeof(drained));
+                (void)r;
+                continue;
+            }
+
+            int flags = 0;
+            if (events[i].events & EPOLLIN)  flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                flags |= CURL_CSELECT_ERR;
+
+            curl_multi_socket_action(multi, fd, flags, &running);
+        }
+
+        if (timer_deadline >= 0 && monotonic_ms() >= timer_deadline) {
+            timer_deadline = -1;
+            curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+
+        reap_completed();
+        start_queued_jobs();
+    }
+
+    return NULL;
+}
+
+static int init_loop(void)
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd < 0 || wakefd < 0)
+        return -1;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = wakefd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) != 0)
+        return -1;
+
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socket_cb);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timer_cb);
+    return 0;
+}
+
+#else   // portable fallback: curl's own poll loop
+
+static void *engine_loop(void *arg)
+{
+    (void)arg;
+    int running = 0;
+
+    for (;;) {
+        curl_multi_perform(multi, &running);
+        reap_completed();
+        start_queued_jobs();
+        curl_multi_poll(multi, NULL, 0, 1000, NULL);
+    }
+
+    return NULL;
+}
+
+static int init_loop(void)
+{
+    return 0;
+}
+
+#endif
+
+
+// ------------------------------------------------------------
+// Futures
+// ------------------------------------------------------------
+
+static void future_complete(int rc, struct http_response *res, void *user)
+{
+    struct upstream_future *f = user;
+
+    pthread_mutex_lock(&f->lock);
+    f->rc = rc;
+    if (res)
+        f->res = *res;
+    f->done = 1;
+    pthread_cond_signal(&f->cond);
+    pthread_mutex_unlock(&f->lock);
+}
+
+
+// ------------------------------------------------------------
+// Engine API
+// ------------------------------------------------------------
+
+int upstream_engine_start(void)
+{
+    if (started)
+        return 0;
+
+    if (http_client_global_init() != 0)
+        return -1;
+
+    multi = curl_multi_init();
+    if (!multi)
+        return -1;
+
+    max_inflight = env_long("UPSTREAM_MAX_INFLIGHT", UPSTREAM_MAX_INFLIGHT);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, max_inflight);
+
+    if (init_loop() != 0) {
+        fprintf(stderr, "[upstream] failed to set up event loop\n");
+        return -1;
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, engine_loop, NULL) != 0)
+        return -1;
+
+    pthread_detach(tid);
+    started = 1;
+    return 0;
+}
+
+int upstream_engine_submit(const char *url,
+                           long timeout_ms,
+                           upstream_callback cb,
+                           void *user)
+{
+    if (!started || !url || !cb)
+        return -1;
+
+    struct upstream_job *job = calloc(1, sizeof(*job));
+    if (!job)
+        return -1;
+
+    job->url = strdup(url);
+    if (!job->url) {
+        free(job);
+        return -1;
+    }
+
+    job->timeout_ms = timeout_ms;
+    job->cb = cb;
+    job->user = user;
+
+    pthread_mutex_lock(&queue_lock);
+    if (queue_tail) queue_tail->next = job;
+    else            queue_head = job;
+    queue_tail = job;
+    stats.submitted++;
+    stats.queued++;
+    pthread_mutex_unlock(&queue_lock);
+
+    wake_engine();
+    return 0;
+}
+
+struct upstream_future *upstream_engine_submit_future(const char *url,
+                                                      long timeout_ms)
+{
+    struct upstream_future *f = calloc(1, sizeof(*f));
+    if (!f)
+        return NULL;
+
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->cond, NULL);
+
+    if (upstream_engine_submit(url, timeout_ms, future_complete, f) != 0) {
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->lock);
+        free(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+int upstream_future_wait(struct upstream_future *future,
+                         struct http_response *out)
+{
+    if (!future)
+        return 1;
+
+    pthread_mutex_lock(&future->lock);
+    while (!future->done)
+        pthread_cond_wait(&future->cond, &future->lock);
+    pthread_mutex_unlock(&future->lock);
+
+    int rc = future->rc;
+    if (out)
+        *out = future->res;
+    else
+        free(future->res.body);
+
+    pthread_cond_destroy(&future->cond);
+    pthread_mutex_destroy(&future->lock);
+    free(future);
+
+    return rc;
+}
+
+void upstream_engine_get_stats(struct upstream_engine_stats *out)
+{
+    if (!out)
+        return;
+
+    pthread_mutex_lock(&queue_lock);
+    *out = stats;
+    pthread_mutex_unlock(&queue_lock);
+}
@@ -0,0 +1,561 @@
+#include "stockc/upstream_governor.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define UPSTREAM_QUEUE_WAIT_MS 2000
+#define UPSTREAM_QUEUE_MAX 1024
+
+#define BACKGROUND_RESERVE 0.2          // bucket share kept for interactive calls
+#define LIMIT_PAUSE_NS (60LL * 1000000000LL)
+#define DAILY_LIMIT_PAUSE_NS (3600LL * 1000000000LL)
+#define RECOVERY_STEP_NS (60LL * 1000000000LL)
+#define WINDOW_SECONDS 60
+
+struct grant_request {
+    struct grant_request *next;
+    upstream_grant_fn fn;
+    void *user;
+    int64_t deadline_ns;        // 0 = none
+    int granted;
+};
+
+struct grant_queue {
+    struct grant_request *head;
+    struct grant_request *tail;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake;
+static int started = 0;
+
+// Configuration
+static long per_minute = 0;             // 0 = unlimited
+static long per_day = 0;                // 0 = unlimited
+static long queue_wait_ms = UPSTREAM_QUEUE_WAIT_MS;
+static long queue_max = UPSTREAM_QUEUE_MAX;
+
+// Buckets
+static double minute_tokens = 0.0;
+static double day_tokens = 0.0;
+static int64_t last_refill_ns = 0;
+
+// Learned from Note/Information responses
+static double learned_rate = 0.0;       // per minute; 0 = nothing learned
+static int64_t pause_until_ns = 0;
+static int64_t last_limit_ns = 0;
+static int64_t last_increase_ns = 0;
+
+// Grants per second over the trailing minute
+static unsigned window_counts[WINDOW_SECONDS];
+static int64_t window_seconds[WINDOW_SECONDS];
+
+static struct grant_queue queues[UPSTREAM_PRIORITY_COUNT];
+static struct grant_request *evicted = NULL;    // refused, not yet told
+static long waiting = 0;
+
+static struct upstream_governor_stats stats = {0};
+
+
+// ------------------------------------------------------------
+// Helpers (caller holds lock unless noted)
+// ------------------------------------------------------------
+
+static long env_long(const char *name, long fallback)
+{
+    const char *v = getenv(name);
+    if (!v || strlen(v) == 0)
+        return fallback;
+
+    long n = strtol(v, NULL, 10);
+    return n > 0 ? n : fallback;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Per-minute rate in force: the configured one, lowered by what the
+ * upstream has taught us. 0 means unlimited.
+ */
+static double effective_rate(void)
+{
+    if (learned_rate > 0.0 && (per_minute == 0 || learned_rate < per_minute))
+        return learned_rate;
+    return (double)per_minute;
+}
+
+static double reserve(enum upstream_priority priority, double capacity)
+{
+    return priority == UPSTREAM_PRIORITY_INTERACTIVE
+        ? 0.0
+        : capacity * BACKGROUND_RESERVE;
+}
+
+static void refill(int64_t now)
+{
+    double seconds = (double)(now - last_refill_ns) / 1e9;
+    last_refill_ns = now;
+
+    // Additive recovery: one call per minute without a limit
+    if (learned_rate > 0.0 && now - last_limit_ns >= RECOVERY_STEP_NS) {
+        int64_t steps = (now - last_increase_ns) / RECOVERY_STEP_NS;
+        if (steps > 0) {
+            learned_rate += (double)steps;
+            last_increase_ns += steps * RECOVERY_STEP_NS;
+            if (per_minute > 0 && learned_rate >= per_minute)
+                learned_rate = 0.0;
+        }
+    }
+
+    double rate = effective_rate();
+    if (rate > 0.0) {
+        minute_tokens += seconds * rate / 60.0;
+        if (minute_tokens > rate)
+            minute_tokens = rate;
+    }
+
+    if (per_day > 0) {
+        day_tokens += seconds * (double)per_day / 86400.0;
+        if (day_tokens > per_day)
+            day_tokens = (double)per_day;
+    }
+}
+
+/*
+ * Nanoseconds until a call at `priority` could be granted (0 = now).
+ */
+static int64_t ready_in(enum upstream_priority priority, int64_t now)
+{
+    int64_t wait = pause_until_ns > now ? pause_until_ns - now : 0;
+
+    double rate = effective_rate();
+    if (rate > 0.0) {
+        double need = 1.0 + reserve(priority, rate) - minute_tokens;
+        if (need > 0.0) {
+            int64_t ns = (int64_t)(need * 60.0 / rate * 1e9) + 1;
+            if (ns > wait)
+                wait = ns;
+        }
+    }
+
+    if (per_day > 0) {
+        double need = 1.0 + reserve(priority, (double)per_day) - day_tokens;
+        if (need > 0.0) {
+            int64_t ns = (int64_t)(need * 86400.0 / (double)per_day * 1e9) + 1;
+            if (ns > wait)
+                wait = ns;
+        }
+    }
+
+    return wait;
+}
+
+static void spend(int64_t now)
+{
+    if (effective_rate() > 0.0)
+        minute_tokens -= 1.0;
+    if (per_day > 0)
+        day_tokens -= 1.0;
+
+    int64_t second = now / 1000000000LL;
+    size_t slot = (size_t)(second % WINDOW_SECONDS);
+    if (window_seconds[slot] != second) {
+        window_seconds[slot] = second;
+        window_counts[slot] = 0;
+    }
+    window_counts[slot]++;
+
+    stats.granted++;
+}
+
+static unsigned grants_last_minute(int64_t now)
+{
+    int64_t second = now / 1000000000LL;
+    unsigned total = 0;
+
+    for (size_t i = 0; i < WINDOW_SECONDS; i++) {
+        if (window_seconds[i] > second - WINDOW_SECONDS)
+            total += window_counts[i];
+    }
+    return total;
+}
+
+/*
+ * Whether anything at `priority` or more urgent is already waiting.
+ */
+static int queued_ahead(enum upstream_priority priority)
+{
+    for (int p = 0; p <= (int)priority; p++) {
+        if (queues[p].head)
+            return 1;
+    }
+    return 0;
+}
+
+static void push(struct grant_queue *q, struct grant_request *r)
+{
+    r->next = NULL;
+    if (q->tail)
+        q->tail->next = r;
+    else
+        q->head = r;
+    q->tail = r;
+}
+
+static struct grant_request *pop(struct grant_queue *q)
+{
+    struct grant_request *r = q->head;
+    if (r) {
+        q->head = r->next;
+        if (!q->head)
+            q->tail = NULL;
+        r->next = NULL;
+    }
+    return r;
+}
+
+/*
+ * Remove the newest request of the least urgent priority below
+ * `priority`, to make room. Returns it, or NULL if there is none.
+ */
+static struct grant_request *evict_below(enum upstream_priority priority)
+{
+    for (int p = UPSTREAM_PRIORITY_COUNT - 1; p > (int)priority; p--) {
+        struct grant_queue *q = &queues[p];
+        if (!q->head)
+            continue;
+
+        struct grant_request *victim = q->tail;
+        if (q->head == victim) {
+            q->head = q->tail = NULL;
+        } else {
+            struct grant_request *r = q->head;
+            while (r->next != victim)
+                r = r->next;
+            r->next = NULL;
+            q->tail = r;
+        }
+        return victim;
+    }
+    return NULL;
+}
+
+
+// ------------------------------------------------------------
+// Governor thread
+// ------------------------------------------------------------
+
+/*
+ * Grants queued requests as tokens allow, strictly by priority, and
+ * refuses ones whose deadline passed. Decisions are delivered with
+ * the lock released.
+ */
+static void *governor_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+
+    for (;;) {
+        int64_t now = now_ns();
+        refill(now);
+
+        struct grant_queue done = { NULL, NULL };
+
+        while (evicted) {
+            struct grant_request *r = evicted;
+            evicted = r->next;
+            r->granted = 0;
+            push(&done, r);
+        }
+
+        // Only interactive requests carry deadlines, in FIFO order
+        struct grant_queue *iq = &queues[UPSTREAM_PRIORITY_INTERACTIVE];
+        while (iq->head && iq->head->deadline_ns &&
+               iq->head->deadline_ns <= now) {
+            struct grant_request *r = pop(iq);
+            r->granted = 0;
+            stats.refused++;
+            waiting--;
+            push(&done, r);
+        }
+
+        int64_t next_wake = -1;
+
+        for (int p = 0; p < UPSTREAM_PRIORITY_COUNT; p++) {
+            struct grant_queue *q = &queues[p];
+
+            while (q->head && ready_in((enum upstream_priority)p, now) == 0) {
+                struct grant_request *r = pop(q);
+                spend(now);
+                r->granted = 1;
+                waiting--;
+                push(&done, r);
+            }
+
+            if (q->head) {
+                next_wake = now + ready_in((enum upstream_priority)p, now);
+                break;      // less urgent work waits behind this
+            }
+        }
+
+        if (done.head) {
+            pthread_mutex_unlock(&lock);
+
+            struct grant_request *r;
+            while ((r = pop(&done))) {
+                r->fn(r->granted, r->user);
+                free(r);
+            }
+
+            pthread_mutex_lock(&lock);
+            continue;
+        }
+
+        if (iq->head && iq->head->deadline_ns &&
+            (next_wake < 0 || iq->head->deadline_ns < next_wake))
+            next_wake = iq->head->deadline_ns;
+
+        if (next_wake < 0) {
+            pthread_cond_wait(&wake, &lock);
+        } else {
+            struct timespec until;
+            until.tv_sec = (time_t)(next_wake / 1000000000LL);
+            until.tv_nsec = (long)(next_wake % 1000000000LL);
+            pthread_cond_timedwait(&wake, &lock, &until);
+        }
+    }
+
+    return NULL;
+}
+
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+int upstream_governor_start(void)
+{
+    pthread_mutex_lock(&lock);
+
+    if (started) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    per_minute = env_long("UPSTREAM_RATE_PER_MINUTE", 0);
+    per_day = env_long("UPSTREAM_RATE_PER_DAY", 0);
+    queue_wait_ms = env_long("UPSTREAM_QUEUE_WAIT_MS", UPSTREAM_QUEUE_WAIT_MS);
+    queue_max = env_long("UPSTREAM_QUEUE_MAX", UPSTREAM_QUEUE_MAX);
+
+    minute_tokens = (double)per_minute;
+    day_tokens = (double)per_day;
+    last_refill_ns = now_ns();
+
+    // Deadlines are monotonic
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, governor_main, NULL) == 0) {
+        pthread_detach(tid);
+        started = 1;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return started ? 0 : -1;
+}
+
+int upstream_governor_request(enum upstream_priority priority,
+                              upstream_grant_fn fn,
+                              void *user)
+{
+    if (priority >= UPSTREAM_PRIORITY_COUNT)
+        priority = UPSTREAM_PRIORITY_WARMUP;
+
+    pthread_mutex_lock(&lock);
+
+    if (!started) {
+        stats.granted++;
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    int64_t now = now_ns();
+    refill(now);
+
+    int64_t wait = ready_in(priority, now);
+
+    if (wait == 0 && !queued_ahead(priority)) {
+        spend(now);
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    int64_t deadline = 0;
+    if (priority == UPSTREAM_PRIORITY_INTERACTIVE) {
+        deadline = now + (int64_t)queue_wait_ms * 1000000LL;
+
+        // Each interactive call already waiting takes a token first
+        double rate = effective_rate();
+        if (rate > 0.0) {
+            long ahead = 0;
+            for (struct grant_request *q = queues[priority].head; q; q = q->next)
+                ahead++;
+            wait += (int64_t)((double)ahead * 60.0 / rate * 1e9);
+        }
+
+        // No token in time: fail fast rather than wait to be refused
+        if (now + wait > deadline) {
+            stats.refused++;
+            pthread_mutex_unlock(&lock);
+            return -1;
+        }
+    }
+
+    if (waiting >= queue_max) {
+        struct grant_request *victim = evict_below(priority);
+        if (!victim) {
+            stats.refused++;
+            pthread_mutex_unlock(&lock);
+            return -1;
+        }
+
+        victim->next = evicted;
+        evicted = victim;
+        stats.refused++;
+        waiting--;
+    }
+
+    struct grant_request *r = calloc(1, sizeof(*r));
+    if (!r) {
+        stats.refused++;
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    r->fn = fn;
+    r->user = user;
+    r->deadline_ns = deadline;
+    push(&queues[priority], r);
+    waiting++;
+    stats.queued++;
+
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+    return 1;
+}
+
+struct grant_waiter {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    int granted;
+};
+
+static void on_waiter_granted(int granted, void *user)
+{
+    struct grant_waiter *w = user;
+
+    pthread_mutex_lock(&w->lock);
+    w->granted = granted;
+    w->done = 1;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+int upstream_governor_acquire(enum upstream_priority priority)
+{
+    struct grant_waiter w;
+    pthread_mutex_init(&w.lock, NULL);
+    pthread_cond_init(&w.cond, NULL);
+    w.done = 0;
+    w.granted = 0;
+
+    int rc = upstream_governor_request(priority, on_waiter_granted, &w);
+
+    if (rc == 1) {
+        pthread_mutex_lock(&w.lock);
+        while (!w.done)
+            pthread_cond_wait(&w.cond, &w.lock);
+        pthread_mutex_unlock(&w.lock);
+        rc = w.granted ? 0 : -1;
+    }
+
+    pthread_cond_destroy(&w.cond);
+    pthread_mutex_destroy(&w.lock);
+    return rc;
+}
+
+void upstream_governor_report(enum upstream_outcome outcome)
+{
+    if (outcome == UPSTREAM_OUTCOME_OK)
+        return;
+
+    pthread_mutex_lock(&lock);
+
+    int64_t now = now_ns();
+    refill(now);
+
+    // Calls already in flight when the first limit hit report too;
+    // only the first one in a pause teaches anything
+    int fresh = now >= pause_until_ns;
+
+    if (outcome == UPSTREAM_OUTCOME_LIMITED) {
+        stats.limited++;
+
+        if (fresh) {
+            // Multiplicative decrease from what actually got through
+            double observed = (double)grants_last_minute(now);
+            double current = effective_rate();
+            double base = current > 0.0 && current < observed ? current : observed;
+
+            learned_rate = base / 2.0 < 1.0 ? 1.0 : (double)(long)(base / 2.0);
+            minute_tokens = 0.0;
+            pause_until_ns = now + LIMIT_PAUSE_NS;
+            last_limit_ns = now;
+            last_increase_ns = now;
+
+            fprintf(stderr,
+                "[governor] upstream rate limit; pausing 60s, then %.0f calls/min\n",
+                learned_rate);
+        }
+    } else {
+        stats.limited_daily++;
+        day_tokens = 0.0;
+
+        // Re-arm at most every half hour of the pause
+        if (pause_until_ns < now + DAILY_LIMIT_PAUSE_NS / 2) {
+            pause_until_ns = now + DAILY_LIMIT_PAUSE_NS;
+            fprintf(stderr,
+                "[governor] upstream daily limit; pausing calls for an hour\n");
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+void upstream_governor_get_stats(struct upstream_governor_stats *out)
+{
+    if (!out)
+        return;
+
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    out->waiting = (unsigned long long)waiting;
+    out->rate_per_minute = effective_rate();
+    pthread_mutex_unlock(&lock);
+}